@@ -31,6 +31,7 @@ limitations under the License.
 #include "midend/complexComparison.h"
 #include "midend/convertEnums.h"
 #include "midend/copyStructures.h"
+#include "midend/eliminateCommonSubexpressions.h"
 #include "midend/eliminateInvalidHeaders.h"
 #include "midend/eliminateTuples.h"
 #include "midend/eliminateNewtype.h"
@@ -149,6 +150,7 @@ PsaSwitchMidEnd::PsaSwitchMidEnd(CompilerOptions& options, std::ostream* outStre
             new P4::LocalCopyPropagation(&refMap, &typeMap, nullptr, policy),
             new P4::ConstantFolding(&refMap, &typeMap),
             new P4::StrengthReduction(&refMap, &typeMap),
+            new P4::EliminateCommonSubexpressions(&refMap, &typeMap),
             new P4::MoveDeclarations(),
             new P4::ValidateTableProperties({ "psa_implementation",
                                               "psa_direct_counter",
@@ -21,6 +21,7 @@ limitations under the License.
 #include "ir/ir.h"
 #include "control-plane/p4RuntimeSerializer.h"
 #include "frontends/common/applyOptionsPragmas.h"
+#include "frontends/common/batch.h"
 #include "frontends/common/parseInput.h"
 #include "frontends/p4/frontend.h"
 #include "lib/error.h"
@@ -36,9 +37,7 @@ limitations under the License.
 #include "ir/json_loader.h"
 #include "fstream"
 
-int main(int argc, char *const argv[]) {
-    setup_gc_logging();
-
+static int compile(int argc, char *const argv[]) {
     AutoCompileContext autoBMV2Context(new BMV2::SimpleSwitchContext);
     auto& options = BMV2::SimpleSwitchContext::get().options();
     options.langVersion = CompilerOptions::FrontendVersion::P4_16;
@@ -138,3 +137,9 @@ int main(int argc, char *const argv[]) {
 
     return ::errorCount() > 0;
 }
+
+int main(int argc, char *const argv[]) {
+    setup_gc_logging();
+
+    return P4::runCompilations(argc, argv, compile);
+}
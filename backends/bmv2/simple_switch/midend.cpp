@@ -32,6 +32,7 @@ limitations under the License.
 #include "midend/complexComparison.h"
 #include "midend/convertEnums.h"
 #include "midend/copyStructures.h"
+#include "midend/eliminateCommonSubexpressions.h"
 #include "midend/eliminateInvalidHeaders.h"
 #include "midend/eliminateTuples.h"
 #include "midend/eliminateNewtype.h"
@@ -44,6 +45,7 @@ limitations under the License.
 #include "midend/local_copyprop.h"
 #include "midend/nestedStructs.h"
 #include "midend/parserUnroll.h"
+#include "midend/perBlockPasses.h"
 #include "midend/removeLeftSlices.h"
 #include "midend/removeMiss.h"
 #include "midend/removeUnusedParameters.h"
@@ -102,23 +104,30 @@ SimpleSwitchMidEnd::SimpleSwitchMidEnd(CompilerOptions& options, std::ostream* o
             new P4::FlattenHeaders(&refMap, &typeMap),
             new P4::FlattenInterfaceStructs(&refMap, &typeMap),
             new P4::ReplaceSelectRange(&refMap, &typeMap),
-            new P4::Predication(&refMap),
-            new P4::MoveDeclarations(),  // more may have been introduced
-            new P4::ConstantFolding(&refMap, &typeMap),
-            new P4::LocalCopyPropagation(&refMap, &typeMap),
-            new P4::ConstantFolding(&refMap, &typeMap),
-            new P4::StrengthReduction(&refMap, &typeMap),
-            new P4::SimplifyKey(&refMap, &typeMap,
-                                new P4::OrPolicy(
-                                    new P4::IsValid(&refMap, &typeMap),
-                                    new P4::IsMask())),
-            new P4::MoveDeclarations(),
-            new P4::ValidateTableProperties({ "implementation",
-                                              "size",
-                                              "counters",
-                                              "meters",
-                                              "support_timeout" }),
-            new P4::SimplifyControlFlow(&refMap, &typeMap),
+            // these only change one control or parser at a time, so they can
+            // run concurrently on each of them
+            new P4::PerBlockPasses(&refMap, &typeMap,
+                                   [](P4::ReferenceMap *refMap, P4::TypeMap *typeMap) {
+                return std::vector<Visitor *>{
+                    new P4::Predication(refMap),
+                    new P4::MoveDeclarations(),  // more may have been introduced
+                    new P4::ConstantFolding(refMap, typeMap),
+                    new P4::LocalCopyPropagation(refMap, typeMap),
+                    new P4::ConstantFolding(refMap, typeMap),
+                    new P4::StrengthReduction(refMap, typeMap),
+                    new P4::EliminateCommonSubexpressions(refMap, typeMap),
+                    new P4::SimplifyKey(refMap, typeMap,
+                                        new P4::OrPolicy(
+                                            new P4::IsValid(refMap, typeMap),
+                                            new P4::IsMask())),
+                    new P4::MoveDeclarations(),
+                    new P4::ValidateTableProperties({ "implementation",
+                                                      "size",
+                                                      "counters",
+                                                      "meters",
+                                                      "support_timeout" }),
+                    new P4::SimplifyControlFlow(refMap, typeMap),
+                }; }),
             new P4::EliminateTypedef(&refMap, &typeMap),
             new P4::CompileTimeOperations(),
             new P4::TableHit(&refMap, &typeMap),
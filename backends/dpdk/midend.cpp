@@ -35,6 +35,7 @@ limitations under the License.
 #include "midend/convertEnums.h"
 #include "midend/convertErrors.h"
 #include "midend/copyStructures.h"
+#include "midend/eliminateCommonSubexpressions.h"
 #include "midend/eliminateInvalidHeaders.h"
 #include "midend/eliminateNewtype.h"
 #include "midend/eliminateSerEnums.h"
@@ -55,6 +56,7 @@ limitations under the License.
 #include "midend/orderArguments.h"
 #include "midend/predication.h"
 #include "midend/parserUnroll.h"
+#include "midend/perBlockPasses.h"
 #include "midend/removeAssertAssume.h"
 #include "midend/removeLeftSlices.h"
 #include "midend/removeExits.h"
@@ -118,41 +120,44 @@ DpdkMidEnd::DpdkMidEnd(CompilerOptions &options,
     auto convertErrors =
         new P4::ConvertErrors(&refMap, &typeMap, new ErrorWidth(16));
     auto evaluator = new P4::EvaluatorPass(&refMap, &typeMap);
-    std::function<bool(const Context *, const IR::Expression *)> policy =
-        [=](const Context *ctx, const IR::Expression *) -> bool {
-        if (auto mce = findContext<IR::MethodCallExpression>(ctx)) {
-            auto mi = P4::MethodInstance::resolve(mce, &refMap, &typeMap);
-            if (auto em = mi->to<P4::ExternMethod>()) {
-                cstring externType = em->originalExternType->getName().name;
-                cstring externMethod = em->method->getName().name;
+    // makes the copy propagation policy for the given maps
+    auto policy = [this](P4::ReferenceMap *refMap, P4::TypeMap *typeMap)
+            -> std::function<bool(const Context *, const IR::Expression *)> {
+        return [this, refMap, typeMap](const Context *ctx, const IR::Expression *) -> bool {
+            if (auto mce = findContext<IR::MethodCallExpression>(ctx)) {
+                auto mi = P4::MethodInstance::resolve(mce, refMap, typeMap);
+                if (auto em = mi->to<P4::ExternMethod>()) {
+                    cstring externType = em->originalExternType->getName().name;
+                    cstring externMethod = em->method->getName().name;
 
-                std::vector<std::pair<cstring, cstring>> doNotCopyPropList = {
-                    {"Checksum", "update"},
-                    {"Hash", "get_hash"},
-                    {"InternetChecksum", "add"},
-                    {"InternetChecksum", "subtract"},
-                    {"InternetChecksum", "set_state"},
-                    {"Register", "read"},
-                    {"Register", "write"},
-                    {"Counter", "count"},
-                    {"Meter", "execute"},
-                    {"Digest", "pack"},
-                };
-                for (auto f : doNotCopyPropList) {
-                    if (externType == f.first && externMethod == f.second) {
-                        return false; } }
-            } else if (auto ef = mi->to<P4::ExternFunction>()) {
-                cstring externFuncName = ef->method->getName().name;
-                std::vector<cstring> doNotCopyPropList = {
-                    "verify",
-                };
-                for (auto f : doNotCopyPropList) {
-                    if (externFuncName == f)
-                        return false;
+                    std::vector<std::pair<cstring, cstring>> doNotCopyPropList = {
+                        {"Checksum", "update"},
+                        {"Hash", "get_hash"},
+                        {"InternetChecksum", "add"},
+                        {"InternetChecksum", "subtract"},
+                        {"InternetChecksum", "set_state"},
+                        {"Register", "read"},
+                        {"Register", "write"},
+                        {"Counter", "count"},
+                        {"Meter", "execute"},
+                        {"Digest", "pack"},
+                    };
+                    for (auto f : doNotCopyPropList) {
+                        if (externType == f.first && externMethod == f.second) {
+                            return false; } }
+                } else if (auto ef = mi->to<P4::ExternFunction>()) {
+                    cstring externFuncName = ef->method->getName().name;
+                    std::vector<cstring> doNotCopyPropList = {
+                        "verify",
+                    };
+                    for (auto f : doNotCopyPropList) {
+                        if (externFuncName == f)
+                            return false;
+                    }
                 }
             }
-        }
-        return true;
+            return true;
+        };
     };
 
     std::function<Inspector*(cstring)> validateTableProperties =
@@ -212,20 +217,29 @@ DpdkMidEnd::DpdkMidEnd(CompilerOptions &options,
             new P4::EliminateTypedef(&refMap, &typeMap),
             new P4::FlattenHeaderUnion(&refMap, &typeMap),
             new P4::SimplifyControlFlow(&refMap, &typeMap),
-            new P4::HSIndexSimplifier(&refMap, &typeMap),
-            new P4::ParsersUnroll(true, &refMap, &typeMap),
-            new P4::ReplaceSelectRange(&refMap, &typeMap),
-            new P4::MoveDeclarations(),  // more may have been introduced
-            new P4::ConstantFolding(&refMap, &typeMap),
-            new P4::LocalCopyPropagation(&refMap, &typeMap, nullptr, policy),
-            new P4::ConstantFolding(&refMap, &typeMap),
-            new P4::MoveDeclarations(),
-            validateTableProperties(options.arch),
-            new P4::SimplifyControlFlow(&refMap, &typeMap),
-            new P4::SimplifySwitch(&refMap, &typeMap),
-            new P4::CompileTimeOperations(),
-            new P4::TableHit(&refMap, &typeMap),
-            new P4::RemoveLeftSlices(&refMap, &typeMap),
+            // these only change one control or parser at a time, so they can
+            // run concurrently on each of them
+            new P4::PerBlockPasses(&refMap, &typeMap,
+                    [policy, validateTableProperties, arch = options.arch](
+                            P4::ReferenceMap *refMap, P4::TypeMap *typeMap) {
+                return std::vector<Visitor *>{
+                    new P4::HSIndexSimplifier(refMap, typeMap),
+                    new P4::ParsersUnroll(true, refMap, typeMap),
+                    new P4::ReplaceSelectRange(refMap, typeMap),
+                    new P4::MoveDeclarations(),  // more may have been introduced
+                    new P4::ConstantFolding(refMap, typeMap),
+                    new P4::LocalCopyPropagation(refMap, typeMap, nullptr,
+                                                 policy(refMap, typeMap)),
+                    new P4::ConstantFolding(refMap, typeMap),
+                    new P4::EliminateCommonSubexpressions(refMap, typeMap),
+                    new P4::MoveDeclarations(),
+                    validateTableProperties(arch),
+                    new P4::SimplifyControlFlow(refMap, typeMap),
+                    new P4::SimplifySwitch(refMap, typeMap),
+                    new P4::CompileTimeOperations(),
+                    new P4::TableHit(refMap, typeMap),
+                    new P4::RemoveLeftSlices(refMap, typeMap),
+                }; }),
             new P4::TypeChecking(&refMap, &typeMap),
             convertErrors,
             new P4::EliminateSerEnums(&refMap, &typeMap),
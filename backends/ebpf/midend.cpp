@@ -30,6 +30,7 @@ limitations under the License.
 #include "midend/complexComparison.h"
 #include "midend/copyStructures.h"
 #include "midend/convertEnums.h"
+#include "midend/eliminateCommonSubexpressions.h"
 #include "midend/eliminateInvalidHeaders.h"
 #include "midend/eliminateNewtype.h"
 #include "midend/eliminateTuples.h"
@@ -98,6 +99,7 @@ const IR::ToplevelBlock* MidEnd::run(EbpfOptions& options,
             new P4::SimplifyComparisons(&refMap, &typeMap),
             new P4::EliminateTuples(&refMap, &typeMap),
             new P4::SimplifySelectList(&refMap, &typeMap),
+            new P4::EliminateCommonSubexpressions(&refMap, &typeMap),
             new P4::MoveDeclarations(),  // more may have been introduced
             new P4::RemoveSelectBooleans(&refMap, &typeMap),
             new P4::SingleArgumentSelect(&refMap, &typeMap),
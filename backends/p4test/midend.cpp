@@ -30,6 +30,7 @@ limitations under the License.
 #include "midend/compileTimeOps.h"
 #include "midend/complexComparison.h"
 #include "midend/copyStructures.h"
+#include "midend/eliminateCommonSubexpressions.h"
 #include "midend/eliminateInvalidHeaders.h"
 #include "midend/eliminateTuples.h"
 #include "midend/eliminateNewtype.h"
@@ -119,6 +120,7 @@ MidEnd::MidEnd(CompilerOptions& options, std::ostream* outStream) {
             new P4::ConstantFolding(&refMap, &typeMap),
         }),
         new P4::StrengthReduction(&refMap, &typeMap),
+        new P4::EliminateCommonSubexpressions(&refMap, &typeMap),
         new P4::MoveDeclarations(),  // more may have been introduced
         new P4::SimplifyControlFlow(&refMap, &typeMap),
         new P4::CompileTimeOperations(),
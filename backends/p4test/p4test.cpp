@@ -28,6 +28,7 @@ limitations under the License.
 #include "lib/crash.h"
 #include "lib/nullstream.h"
 #include "frontends/common/applyOptionsPragmas.h"
+#include "frontends/common/batch.h"
 #include "frontends/common/parseInput.h"
 #include "frontends/p4/evaluator/evaluator.h"
 #include "frontends/p4/frontend.h"
@@ -83,10 +84,7 @@ static void log_dump(const IR::Node *node, const char *head) {
             std::cout << *node << std::endl; }
 }
 
-int main(int argc, char *const argv[]) {
-    setup_gc_logging();
-    setup_signals();
-
+static int compile(int argc, char *const argv[]) {
     AutoCompileContext autoP4TestContext(new P4TestContext);
     auto& options = P4TestContext::get().options();
     options.langVersion = CompilerOptions::FrontendVersion::P4_16;
@@ -188,3 +186,10 @@ int main(int argc, char *const argv[]) {
         std::cerr << "Done." << std::endl;
     return ::errorCount() > 0;
 }
+
+int main(int argc, char *const argv[]) {
+    setup_gc_logging();
+    setup_signals();
+
+    return P4::runCompilations(argc, argv, compile);
+}
@@ -31,6 +31,7 @@ limitations under the License.
 #include "midend/complexComparison.h"
 #include "midend/copyStructures.h"
 #include "midend/convertEnums.h"
+#include "midend/eliminateCommonSubexpressions.h"
 #include "midend/eliminateInvalidHeaders.h"
 #include "midend/eliminateNewtype.h"
 #include "midend/eliminateTuples.h"
@@ -96,6 +97,7 @@ MidEnd::run(EbpfOptions& options, const IR::P4Program* program, std::ostream* ou
                 new P4::CopyStructures(&refMap, &typeMap),
                 new P4::LocalCopyPropagation(&refMap, &typeMap),
                 new P4::SimplifySelectList(&refMap, &typeMap),
+                new P4::EliminateCommonSubexpressions(&refMap, &typeMap),
                 new P4::MoveDeclarations(),  // more may have been introduced
                 new P4::RemoveSelectBooleans(&refMap, &typeMap),
                 new P4::SingleArgumentSelect(&refMap, &typeMap),
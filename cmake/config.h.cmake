@@ -22,6 +22,9 @@
 /* Define to 1 if you have the GC_print_stats function. */
 #cmakedefine HAVE_GC_PRINT_STATS 1
 
+/* Define to 1 if you have the GC_set_on_collection_event function. */
+#cmakedefine HAVE_GC_SET_ON_COLLECTION_EVENT 1
+
 /* Define if you have simple switch installed */
 #cmakedefine HAVE_SIMPLE_SWITCH 1
 
@@ -0,0 +1,116 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "batch.h"
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ir/ir.h"
+#include "lib/compile_context.h"
+
+namespace P4 {
+
+namespace {
+
+/// Splits the command line @line into words, removing the quotes.
+std::vector<std::string> splitWords(const std::string& line) {
+    std::vector<std::string> words;
+    std::string word;
+    bool inWord = false, quoted = false;
+    for (char c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+            inWord = true;
+        } else if (!quoted && std::isspace(static_cast<unsigned char>(c))) {
+            if (inWord) words.push_back(word);
+            word.clear();
+            inWord = false;
+        } else {
+            word += c;
+            inWord = true;
+        }
+    }
+    if (inWord) words.push_back(word);
+    return words;
+}
+
+int runJob(const std::vector<std::string>& args, CompileFunction compile) {
+    std::vector<char*> argv;
+    for (auto& arg : args)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+    try {
+        return compile(static_cast<int>(args.size()), argv.data());
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
+
+}  // namespace
+
+int runCompilations(int argc, char* const argv[], CompileFunction compile) {
+    const char* manifest = nullptr;
+    std::vector<std::string> common;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            manifest = argv[++i];
+        else
+            common.push_back(argv[i]);
+    }
+    if (!manifest)
+        return compile(argc, argv);
+
+    std::ifstream in(manifest);
+    if (!in) {
+        std::cerr << manifest << ": No such file or directory." << std::endl;
+        return 1;
+    }
+    bool hadContext = !CompileContextStack::isEmpty();
+    unsigned jobs = 0, failed = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        auto words = splitWords(line);
+        if (words.empty() || words[0][0] == '#')
+            continue;
+        auto args = common;
+        args.insert(args.end(), words.begin(), words.end());
+
+        ++jobs;
+        int status = runJob(args, compile);
+        if (status != 0) {
+            std::cerr << "batch: `" << line << "' failed with status " << status << std::endl;
+            ++failed;
+        }
+        if (!hadContext && !CompileContextStack::isEmpty()) {
+            // the remaining jobs would run in the context left by this one
+            std::cerr << "batch: `" << line << "' did not restore the compilation context"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (failed)
+        std::cerr << "batch: " << failed << " of " << jobs << " compilations failed"
+                  << std::endl;
+    return failed ? 1 : 0;
+}
+
+}  // namespace P4
@@ -0,0 +1,51 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef FRONTENDS_COMMON_BATCH_H_
+#define FRONTENDS_COMMON_BATCH_H_
+
+#include <functional>
+
+namespace P4 {
+
+/// The body of a compiler's main function, compiling the program given by
+/// the command line @argc/@argv in a compilation context of its own, and
+/// returning the exit status.
+using CompileFunction = std::function<int(int argc, char* const argv[])>;
+
+/**
+ * Runs @compile once on the command line @argc/@argv, unless it contains a
+ * `--batch manifest` option.  In that case @compile runs once for each line
+ * of the manifest file, in this process, on the command line made of the
+ * other options followed by the words of the line (empty lines and lines
+ * starting with # are skipped).  This saves the start-up costs of a process
+ * per program; with --cache-system-includes as well, the system include
+ * files are parsed once for all the programs (see
+ * ParserOptions::cacheSystemIncludes).
+ *
+ * Every compilation gets a new compilation context, and so a new
+ * ErrorReporter.  The IR node ids are not restarted, as the nodes cached by
+ * earlier compilations are still in use.  The failed compilations are listed
+ * on stderr.
+ *
+ * @returns the result of @compile, or in batch mode 0 if all compilations
+ * succeeded and 1 otherwise.
+ */
+int runCompilations(int argc, char* const argv[], CompileFunction compile);
+
+}  // namespace P4
+
+#endif /* FRONTENDS_COMMON_BATCH_H_ */
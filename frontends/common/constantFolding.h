@@ -43,7 +43,7 @@ namespace P4 {
  *      `IR::Declaration_Constant` nodes are initialized with
  *      compile-time known constants.
  */
-class DoConstantFolding : public Transform {
+class DoConstantFolding : public Transform, public DeclarationLocal {
  protected:
     /// Used to resolve IR nodes to declarations.
     /// If `nullptr`, then `const` values cannot be resolved.
@@ -108,6 +108,7 @@ class DoConstantFolding : public Transform {
         visitDagOnce = true; setName("DoConstantFolding");
         assignmentTarget = false;
     }
+    DoConstantFolding *clone() const override { return new DoConstantFolding(*this); }
 
     const IR::Node* postorder(IR::Declaration_Constant* d) override;
     const IR::Node* postorder(IR::PathExpression* e) override;
@@ -18,6 +18,7 @@ limitations under the License.
 #define _FRONTENDS_COMMON_PARSEINPUT_H_
 
 #include "frontends/common/options.h"
+#include "frontends/common/preprocessor.h"
 #include "frontends/parsers/parserDriver.h"
 #include "frontends/p4/fromv1.0/converters.h"
 #include "frontends/p4/frontend.h"
@@ -56,6 +57,18 @@ parseV1Program(Input& stream, const char* sourceFile, unsigned sourceLine,
     return v1->to<IR::P4Program>();
 }
 
+/// Parses the preprocessed program read from @in, as parseP4File does.
+template <typename C, typename Input>
+static const IR::P4Program* parseP4Input(ParserOptions& options, Input& in) {
+    return options.isv1()
+         ? parseV1Program<Input, C>(in, options.file, 1, options.getDebugHook())
+         : options.parseIncludeUnits
+         ? P4ParserDriver::parseIncludeUnits(in, options.file)
+         : options.cacheSystemIncludes
+         ? P4ParserDriver::parseWithIncludeCache(in, options.file)
+         : P4ParserDriver::parse(in, options.file);
+}
+
 /**
  * Parse P4 source from a file. The filename and language version are specified
  * by @options. If the language version is not P4-16, then the program is
@@ -69,25 +82,30 @@ const IR::P4Program* parseP4File(ParserOptions& options) {
     BUG_CHECK(&options == &P4CContext::get().options(),
               "Parsing using options that don't match the current "
               "compiler context");
-    FILE* in = nullptr;
-    if (options.doNotPreprocess) {
-        in = fopen(options.file, "r");
-        if (in == nullptr) {
-            ::error(ErrorType::ERR_NOT_FOUND,
-                    "%1%: No such file or directory.", options.file);
+    const IR::P4Program* result = nullptr;
+    if (options.useBuiltinPreprocessor()) {
+        auto preprocessor = options.preprocessBuiltin();
+        if (::errorCount() > 0 || preprocessor == nullptr)
             return nullptr;
-        }
+        result = parseP4Input<C>(options, preprocessor->stream());
     } else {
-        in = options.preprocess();
-        if (::errorCount() > 0 || in == nullptr)
-            return nullptr;
+        FILE* in = nullptr;
+        if (options.doNotPreprocess) {
+            in = fopen(options.file, "r");
+            if (in == nullptr) {
+                ::error(ErrorType::ERR_NOT_FOUND,
+                        "%1%: No such file or directory.", options.file);
+                return nullptr;
+            }
+        } else {
+            in = options.preprocess();
+            if (::errorCount() > 0 || in == nullptr)
+                return nullptr;
+        }
+        result = parseP4Input<C>(options, in);
+        options.closeInput(in);
     }
 
-    auto result = options.isv1()
-                ? parseV1Program<FILE*, C>(in, options.file, 1, options.getDebugHook())
-                : P4ParserDriver::parse(in, options.file);
-    options.closeInput(in);
-
     if (::errorCount() > 0) {
         ::error(ErrorType::ERR_OVERLIMIT,
                 "%1% errors encountered, aborting compilation", ::errorCount());
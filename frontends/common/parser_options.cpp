@@ -24,12 +24,16 @@ limitations under the License.
 
 #include "frontends/p4/toP4/toP4.h"
 #include "ir/json_generator.h"
+#include "ir/pass_profile.h"
 #include "lib/exceptions.h"
 #include "lib/exename.h"
+#include "lib/gc.h"
 #include "lib/log.h"
 #include "lib/nullstream.h"
+#include "lib/parallel.h"
 #include "lib/path.h"
 #include "parser_options.h"
+#include "preprocessor.h"
 
 /* CONFIG_PKGDATADIR is defined by cmake at compile time to be the same as
  * CMAKE_INSTALL_PREFIX This is only valid when the compiler is built and
@@ -176,6 +180,40 @@ ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
             return true;
         },
         "Skip preprocess, assume input file is already preprocessed.");
+    registerOption(
+        "--batch", "manifest",
+        [](const char* ) {
+            // compilers supporting it handle it before processing the options
+            ::error(ErrorType::ERR_UNSUPPORTED, "--batch is not supported by this compiler");
+            return false;
+        },
+        "Compile the programs given by the lines of the manifest file in this process;\n"
+        "each line holds the options for one program, which are appended to the\n"
+        "others on the command line.");
+    registerOption(
+        "--cache-system-includes", nullptr,
+        [this](const char* ) {
+            cacheSystemIncludes = true;
+            return true;
+        },
+        "Reuse the declarations parsed from system include files by earlier\n"
+        "compilations in this process (with --batch).");
+    registerOption(
+        "--builtin-preprocessor", nullptr,
+        [this](const char* ) {
+            builtinPreprocessor = true;
+            return true;
+        },
+        "Preprocess with the compiler's built-in preprocessor rather than cpp\n"
+        "(cpp is still used for the -M options).");
+    registerOption(
+        "--parallel-parse", nullptr,
+        [this](const char* ) {
+            parseIncludeUnits = true;
+            return true;
+        },
+        "Parse the files included by the main program file concurrently, on up\n"
+        "to the number of threads given by --threads.");
     registerOption(
         "--disable-annotations", "annotations",
         [this](const char* arg) {
@@ -274,6 +312,64 @@ ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
             return true;
         },
         "[Compiler debugging] Folder where P4 programs are dumped\n");
+    registerOption(
+        "--pass-profile", "file",
+        [](const char* arg) {
+            PassProfile::enable(arg);
+            return true;
+        },
+        "[Compiler debugging] Write a per-pass profile (time, memory and\n"
+        "IR nodes created/visited/changed by each pass) to `file' as JSON\n");
+    registerOption(
+        "--gc-stats", nullptr,
+        [](const char*) {
+            PassProfile::enableGCStats();
+            return true;
+        },
+        "[Compiler debugging] Report garbage collections, pause time, bytes\n"
+        "reclaimed and peak heap size for each pass on stderr\n");
+    registerOption(
+        "--gc-mode", "mode",
+        [](const char* arg) {
+            if (!strcmp(arg, "full")) {
+                gc_set_mode(gc_mode::full);
+            } else if (!strcmp(arg, "incremental")) {
+                gc_set_mode(gc_mode::incremental);
+            } else if (!strcmp(arg, "generational")) {
+                gc_set_mode(gc_mode::generational);
+            } else {
+                ::error(ErrorType::ERR_INVALID, "Illegal GC mode %1%", arg);
+                return false; }
+            return true;
+        },
+        "Garbage collection mode: full (the default), incremental, or\n"
+        "generational (mostly collect recently allocated memory, without\n"
+        "splitting collections into time-limited increments)\n");
+    registerOption(
+        "--gc-free-space-divisor", "n",
+        [](const char* arg) {
+            auto divisor = strtoul(arg, nullptr, 10);
+            if (divisor == 0) {
+                ::error(ErrorType::ERR_INVALID, "Illegal GC free space divisor %1%", arg);
+                return false; }
+            gc_set_free_space_divisor(divisor);
+            return true;
+        },
+        "Grow the heap when less than 1/n of it is free after a collection\n"
+        "(default 3); larger values trade more collections for a smaller heap\n");
+    registerOption(
+        "--threads", "n",
+        [](const char* arg) {
+            auto threads = strtoul(arg, nullptr, 10);
+            Util::setParallelism(threads);
+            if (threads != 1 && Util::parallelism() == 1)
+                ::warning(ErrorType::WARN_UNSUPPORTED,
+                          "%1%: compiler built without multithreading support", "--threads");
+            return true;
+        },
+        "Use up to n threads to run passes that can be applied to each control,\n"
+        "parser, action and function of the program separately (0 means one per\n"
+        "core; the default is 1).  Requires a compiler built with ENABLE_MULTITHREAD.\n");
     registerOption(
         "--parser-inline-opt", nullptr,
         [this](const char*) {
@@ -448,6 +544,32 @@ void ParserOptions::closeInput(FILE* inputStream) const {
     }
 }
 
+bool ParserOptions::useBuiltinPreprocessor() const {
+    // the built-in preprocessor does not write dependency rules, and stdin is
+    // not preprocessed at all
+    return builtinPreprocessor && !doNotPreprocess && file != "-" &&
+           preprocessor_options.find(" -M") == nullptr;
+}
+
+std::unique_ptr<P4::Preprocessor> ParserOptions::preprocessBuiltin() {
+    auto preprocessor = std::make_unique<P4::Preprocessor>();
+    preprocessor->addOptions(preprocessor_options);
+    preprocessor->addOptions(getIncludePath());
+    if (Log::verbose())
+        std::cerr << "Preprocessing " << file << " with" << preprocessor_options
+                  << getIncludePath() << std::endl;
+    if (!preprocessor->open(file))
+        return nullptr;
+
+    if (doNotCompile) {
+        std::string line;
+        while (preprocessor->getLine(line))
+            printf("%s", line.c_str());
+        return nullptr;
+    }
+    return preprocessor;
+}
+
 // From (folder, file.ext, suffix)  returns
 // folder/file-suffix.ext
 static cstring makeFileName(cstring folder, cstring name, cstring baseSuffix) {
@@ -19,6 +19,7 @@ limitations under the License.
 #ifndef FRONTENDS_COMMON_PARSER_OPTIONS_H_
 #define FRONTENDS_COMMON_PARSER_OPTIONS_H_
 
+#include <memory>
 #include <set>
 #include <unordered_map>
 
@@ -28,6 +29,10 @@ limitations under the License.
 #include "lib/cstring.h"
 #include "lib/options.h"
 
+namespace P4 {
+class Preprocessor;
+}  // namespace P4
+
 // Standard include paths for .p4 header files. The values are determined by
 // `configure`.
 extern const char* p4includePath;
@@ -74,6 +79,13 @@ class ParserOptions : public Util::Options {
     cstring dumpFolder = ".";
     // If false, optimization of callee parsers (subparsers) inlining is disabled.
     bool optimizeParserInlining = false;
+    // If true, reuse the declarations parsed from system include files by
+    // earlier compilations in this process.
+    bool cacheSystemIncludes = false;
+    // If true, preprocess with the built-in preprocessor rather than cpp.
+    bool builtinPreprocessor = false;
+    // If true, parse the files included by the main file concurrently.
+    bool parseIncludeUnits = false;
     // Expect that the only remaining argument is the input file.
     void setInputFile();
     // Return target specific include path.
@@ -82,6 +94,12 @@ class ParserOptions : public Util::Options {
     FILE* preprocess();
     // Closes the input stream returned by preprocess.
     void closeInput(FILE* input) const;
+    // True if the input is to be preprocessed by the built-in preprocessor
+    // rather than by preprocess(): it is selected and can handle the options.
+    bool useBuiltinPreprocessor() const;
+    // Returns the built-in preprocessor, reading the input file.  Its output
+    // is printed, and null returned, if only preprocessing.
+    std::unique_ptr<P4::Preprocessor> preprocessBuiltin();
     // True if we are compiling a P4 v1.0 or v1.1 program
     bool isv1() const;
     // Get a debug hook function suitable for insertion
@@ -0,0 +1,1004 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "preprocessor.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
+#include "lib/error.h"
+
+namespace P4 {
+
+struct Preprocessor::Token {
+    /// Paste is a ## of a macro body, which is only seen while substituting.
+    enum Kind { Identifier, Number, String, Punct, Paste } kind;
+    std::string text;
+    std::string space;  // whitespace and comments before the token
+
+    Token(Kind kind, std::string text, std::string space = "")
+        : kind(kind), text(std::move(text)), space(std::move(space)) {}
+};
+
+struct Preprocessor::Macro {
+    bool functionLike = false;
+    bool variadic = false;  // the last parameter is __VA_ARGS__
+    std::vector<std::string> params;
+    std::vector<Token> body;
+};
+
+struct Preprocessor::Conditional {
+    bool enclosing;  // the enclosing text is output
+    bool active;     // the current branch is output
+    bool taken;      // some branch has been chosen
+    bool sawElse;
+};
+
+struct Preprocessor::Source {
+    cstring name;  // path used to open the file
+    std::shared_ptr<const std::string> text;
+    size_t pos = 0;
+    unsigned line = 0;  // lines read so far
+    // file name and line number offset set by #line
+    cstring presumedName;
+    int lineDelta = 0;
+    bool inComment = false;  // in a /* comment */ spanning lines
+    std::vector<Conditional> conditionals;
+};
+
+namespace {
+
+/// Contents of the files read by all preprocessors, validated by their
+/// modification time and size.
+struct CachedFile {
+    std::shared_ptr<const std::string> text;
+    time_t mtime;
+    off_t size;
+};
+
+std::map<std::string, CachedFile>& fileCache() {
+    static std::map<std::string, CachedFile> cache;
+    return cache;
+}
+
+#ifdef MULTITHREAD
+std::mutex& fileCacheLock() {
+    static std::mutex lock;
+    return lock;
+}
+#endif  // MULTITHREAD
+
+bool isRegularFile(const std::string& path, struct stat* st) {
+    return stat(path.c_str(), st) == 0 && S_ISREG(st->st_mode);
+}
+
+std::shared_ptr<const std::string> readFile(const std::string& path) {
+    struct stat st;
+    if (!isRegularFile(path, &st))
+        return nullptr;
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(fileCacheLock());
+#endif  // MULTITHREAD
+    auto& cached = fileCache()[path];
+    if (cached.text && cached.mtime == st.st_mtime && cached.size == st.st_size)
+        return cached.text;
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return nullptr;
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    cached = { std::make_shared<const std::string>(contents.str()), st.st_mtime, st.st_size };
+    return cached.text;
+}
+
+bool isWordChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isDirective(const std::string& line, bool inComment) {
+    size_t first = line.find_first_not_of(" \t");
+    return !inComment && first != std::string::npos && line[first] == '#';
+}
+
+}  // namespace
+
+Preprocessor::Preprocessor() : buffer(*this), out(&buffer) {}
+
+Preprocessor::~Preprocessor() = default;
+
+void Preprocessor::clearFileCache() {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(fileCacheLock());
+#endif  // MULTITHREAD
+    fileCache().clear();
+}
+
+Preprocessor::OutputBuffer::int_type Preprocessor::OutputBuffer::underflow() {
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+    if (!self.getLine(line))
+        return traits_type::eof();
+    setg(&line[0], &line[0], &line[0] + line.size());
+    return traits_type::to_int_type(*gptr());
+}
+
+/// Splits @text into tokens; @inComment tracks /* comments */ spanning
+/// lines.  Comments are kept in the spacing of the token that follows them,
+/// and the spacing after the last token is stored in @trailing.
+std::vector<Preprocessor::Token>
+Preprocessor::tokenize(const std::string& text, bool& inComment, std::string* trailing) {
+    static const char* const multiChar[] = {
+        "...", "##", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||" };
+    std::vector<Token> tokens;
+    std::string space;
+    size_t i = 0, n = text.size();
+    while (i < n) {
+        if (inComment) {
+            size_t end = text.find("*/", i);
+            if (end == std::string::npos) {
+                space.append(text, i, std::string::npos);
+                break;
+            }
+            space.append(text, i, end + 2 - i);
+            i = end + 2;
+            inComment = false;
+            continue;
+        }
+        char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            space += c;
+            ++i;
+            continue;
+        }
+        if (c == '/' && i + 1 < n && text[i + 1] == '*') {
+            inComment = true;
+            space += "/*";
+            i += 2;
+            continue;
+        }
+        if (c == '/' && i + 1 < n && text[i + 1] == '/') {
+            space.append(text, i, std::string::npos);
+            break;
+        }
+
+        size_t start = i;
+        Token::Kind kind;
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            while (i < n && isWordChar(text[i])) ++i;
+            kind = Token::Identifier;
+        } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                   (c == '.' && i + 1 < n &&
+                    std::isdigit(static_cast<unsigned char>(text[i + 1])))) {
+            // a preprocessing number, which also covers P4 constants like 8w0xFF
+            for (++i; i < n; ++i) {
+                char d = text[i];
+                if ((d == '+' || d == '-') && strchr("eEpP", text[i - 1])) continue;
+                if (!isWordChar(d) && d != '.') break;
+            }
+            kind = Token::Number;
+        } else if (c == '"') {
+            for (++i; i < n && text[i] != '"'; ++i)
+                if (text[i] == '\\' && i + 1 < n) ++i;
+            if (i < n) ++i;
+            kind = Token::String;
+        } else {
+            size_t len = 1;
+            for (auto op : multiChar) {
+                if (text.compare(i, strlen(op), op) == 0) {
+                    len = strlen(op);
+                    break;
+                }
+            }
+            i += len;
+            kind = Token::Punct;
+        }
+        tokens.emplace_back(kind, text.substr(start, i - start), std::move(space));
+        space.clear();
+    }
+    if (trailing)
+        *trailing = std::move(space);
+    return tokens;
+}
+
+std::string Preprocessor::spell(const std::vector<Token>& tokens) {
+    std::string result;
+    for (auto& t : tokens) {
+        result += t.space;
+        result += t.text;
+    }
+    return result;
+}
+
+void Preprocessor::addOptions(cstring options) {
+    // split the command line into words, removing the quotes
+    std::vector<std::string> words;
+    std::string word;
+    bool inWord = false, quoted = false;
+    for (const char* p = options.c_str(); p && *p; ++p) {
+        if (*p == '"') {
+            quoted = !quoted;
+            inWord = true;
+        } else if (!quoted && std::isspace(static_cast<unsigned char>(*p))) {
+            if (inWord) words.push_back(word);
+            word.clear();
+            inWord = false;
+        } else {
+            word += *p;
+            inWord = true;
+        }
+    }
+    if (inWord) words.push_back(word);
+
+    for (size_t i = 0; i < words.size(); ++i) {
+        const std::string& w = words[i];
+        if (w.size() < 2 || w[0] != '-' || !strchr("IDU", w[1]))
+            continue;
+        std::string arg = w.substr(2);
+        if (arg.empty() && i + 1 < words.size())
+            arg = words[++i];
+        if (w[1] == 'I')
+            addIncludeDir(arg);
+        else if (w[1] == 'D')
+            define(arg);
+        else
+            undefine(arg);
+    }
+}
+
+void Preprocessor::addIncludeDir(cstring dir) {
+    includeDirs.push_back(dir);
+}
+
+void Preprocessor::define(cstring definition) {
+    std::string text = definition.c_str();
+    auto eq = text.find('=');
+    if (eq == std::string::npos)
+        text += " 1";
+    else
+        text[eq] = ' ';
+    bool inComment = false;
+    auto tokens = tokenize(text, inComment, nullptr);
+    defineDirective(tokens, 0);
+}
+
+void Preprocessor::undefine(cstring name) {
+    macros.erase(name.c_str());
+}
+
+bool Preprocessor::open(cstring file) {
+    auto text = readFile(file.c_str());
+    if (!text) {
+        ::error(ErrorType::ERR_NOT_FOUND, "%1%: No such file or directory.", file);
+        return false;
+    }
+    push(file, text, false);
+    return true;
+}
+
+void Preprocessor::openText(cstring file, const std::string& text) {
+    push(file, std::make_shared<const std::string>(text), false);
+}
+
+bool Preprocessor::getLine(std::string& line) {
+    while (pendingNext == pending.size()) {
+        pending.clear();
+        pendingNext = 0;
+        if (sources.empty())
+            return false;
+        std::string text;
+        unsigned lines;
+        if (readLine(text, lines))
+            processLine(std::move(text), lines);
+        else
+            pop();
+    }
+    line = std::move(pending[pendingNext++]);
+    return true;
+}
+
+void Preprocessor::emit(std::string line) {
+    pending.push_back(std::move(line));
+}
+
+void Preprocessor::emitBlank(unsigned lines) {
+    for (unsigned i = 0; i < lines; ++i)
+        pending.push_back("\n");
+}
+
+void Preprocessor::marker(unsigned line, const Source& src, const char* flag) {
+    emit("# " + std::to_string(int(line) + src.lineDelta) + " \"" +
+         src.presumedName.c_str() + "\"" + flag + "\n");
+}
+
+void Preprocessor::report(bool isError, const std::string& message) {
+    cstring file = sources.empty() ? cstring("<command-line>") : sources.back()->presumedName;
+    int line = sources.empty() ? 0 : int(currentLine) + sources.back()->lineDelta;
+    if (isError)
+        ::error(ErrorType::ERR_INVALID, "%1%(%2%): %3%", file, line, message);
+    else
+        ::warning(ErrorType::WARN_INVALID, "%1%(%2%): %3%", file, line, message);
+}
+
+void Preprocessor::push(cstring file, std::shared_ptr<const std::string> text, bool included) {
+    auto src = std::make_unique<Source>();
+    src->name = src->presumedName = file;
+    src->text = std::move(text);
+    sources.push_back(std::move(src));
+    marker(1, *sources.back(), included ? " 1" : "");
+}
+
+void Preprocessor::pop() {
+    auto& src = *sources.back();
+    currentLine = src.line;
+    if (!src.conditionals.empty())
+        report(true, "unterminated conditional directive");
+    if (src.inComment)
+        report(true, "unterminated comment");
+    sources.pop_back();
+    if (!sources.empty())
+        marker(sources.back()->line + 1, *sources.back(), " 2");
+}
+
+bool Preprocessor::active() const {
+    auto& conditionals = sources.back()->conditionals;
+    return conditionals.empty() || conditionals.back().active;
+}
+
+/// Reads the next line of the current file into @line, joining the lines
+/// continued with a backslash; @lines is set to the number of lines read.
+bool Preprocessor::readLine(std::string& line, unsigned& lines) {
+    auto& src = *sources.back();
+    const std::string& text = *src.text;
+    if (src.pos >= text.size())
+        return false;
+    line.clear();
+    lines = 0;
+    while (src.pos < text.size()) {
+        size_t end = text.find('\n', src.pos);
+        if (end == std::string::npos)
+            end = text.size();
+        size_t len = end - src.pos;
+        if (len > 0 && text[src.pos + len - 1] == '\r')
+            --len;
+        line.append(text, src.pos, len);
+        src.pos = end + 1;
+        ++src.line;
+        ++lines;
+        if (line.empty() || line.back() != '\\')
+            break;
+        line.pop_back();
+    }
+    return true;
+}
+
+void Preprocessor::processLine(std::string text, unsigned lines) {
+    auto& src = *sources.back();
+    currentLine = src.line - lines + 1;
+    if (isDirective(text, src.inComment)) {
+        directive(text, lines);
+        return;
+    }
+    if (!active()) {
+        tokenize(text, src.inComment, nullptr);
+        emitBlank(lines);
+        return;
+    }
+
+    std::string trailing;
+    auto tokens = tokenize(text, src.inComment, &trailing);
+    std::vector<Token> result;
+    while (true) {
+        argsIncomplete = false;
+        result = expand(tokens, {}, true);
+        if (!argsIncomplete)
+            break;
+        // The arguments of a macro continue on the next line, so join it to
+        // this one, as cpp does, with blank lines after to keep the count.
+        size_t pos = src.pos;
+        unsigned line = src.line;
+        std::string next;
+        unsigned more;
+        if (!readLine(next, more) || isDirective(next, src.inComment)) {
+            src.pos = pos;
+            src.line = line;
+            result = expand(tokens, {}, false);
+            break;
+        }
+        auto nextTokens = tokenize(next, src.inComment, &trailing);
+        if (!nextTokens.empty())
+            nextTokens.front().space = " ";
+        tokens.insert(tokens.end(), nextTokens.begin(), nextTokens.end());
+        lines += more;
+    }
+    emit(spell(result) + trailing + "\n");
+    emitBlank(lines - 1);
+}
+
+void Preprocessor::directive(const std::string& text, unsigned lines) {
+    auto& src = *sources.back();
+    auto tokens = tokenize(text, src.inComment, nullptr);
+    std::string name;
+    if (tokens.size() > 1 && tokens[1].kind == Token::Identifier)
+        name = tokens[1].text;
+
+    if (name == "if" || name == "ifdef" || name == "ifndef" || name == "elif" ||
+        name == "else" || name == "endif") {
+        conditional(name, tokens, 2);
+        emitBlank(lines);
+        return;
+    }
+    if (!active() || tokens.size() == 1) {
+        emitBlank(lines);
+        return;
+    }
+
+    if (tokens[1].kind == Token::Number) {
+        // a line marker in the input; the marker output instead of it sets
+        // the number of the next line
+        lineDirective(tokens, 1);
+    } else if (name == "line") {
+        lineDirective(tokens, 2);
+    } else if (name == "include") {
+        size_t at = text.find("include") + strlen("include");
+        if (!includeDirective(text.substr(at), tokens, 2))
+            emitBlank(lines);
+    } else if (name == "define") {
+        defineDirective(tokens, 2);
+        emitBlank(lines);
+    } else if (name == "undef") {
+        if (tokens.size() < 3 || tokens[2].kind != Token::Identifier)
+            report(true, "no macro name given in #undef directive");
+        else
+            macros.erase(tokens[2].text);
+        emitBlank(lines);
+    } else if (name == "error" || name == "warning") {
+        size_t at = text.find(name) + name.size();
+        size_t start = text.find_first_not_of(" \t", at);
+        report(name == "error",
+               "#" + name + " " + (start == std::string::npos ? "" : text.substr(start)));
+        emitBlank(lines);
+    } else if (name == "pragma") {
+        // other pragmas are dropped, as cpp does
+        if (tokens.size() > 2 && tokens[2].text == "once")
+            includedOnce.insert(src.name.c_str());
+        emitBlank(lines);
+    } else {
+        // unknown directives are output as text, as cpp does for
+        // assembler-with-cpp
+        emit(spell(expand(tokens, {}, false)) + "\n");
+        emitBlank(lines - 1);
+    }
+}
+
+bool Preprocessor::isDefined(const std::string& name) const {
+    return macros.count(name) || name == "__FILE__" || name == "__LINE__";
+}
+
+void Preprocessor::conditional(const std::string& name, const std::vector<Token>& tokens,
+                               size_t start) {
+    auto& conditionals = sources.back()->conditionals;
+    if (name == "if" || name == "ifdef" || name == "ifndef") {
+        bool enclosing = active();
+        bool value = false;
+        if (enclosing) {
+            if (name == "if") {
+                value = evaluate(tokens, start);
+            } else if (start >= tokens.size() || tokens[start].kind != Token::Identifier) {
+                report(true, "no macro name given in #" + name + " directive");
+            } else {
+                value = isDefined(tokens[start].text) == (name == "ifdef");
+            }
+        }
+        conditionals.push_back({ enclosing, enclosing && value, value, false });
+        return;
+    }
+
+    if (conditionals.empty()) {
+        report(true, "#" + name + " without #if");
+        return;
+    }
+    auto& c = conditionals.back();
+    if (name == "endif") {
+        conditionals.pop_back();
+    } else if (c.sawElse) {
+        report(true, "#" + name + " after #else");
+    } else if (name == "else") {
+        c.sawElse = true;
+        c.active = c.enclosing && !c.taken;
+        c.taken = true;
+    } else if (c.enclosing && !c.taken) {
+        c.active = c.taken = evaluate(tokens, start);
+    } else {
+        c.active = false;
+    }
+}
+
+void Preprocessor::defineDirective(const std::vector<Token>& tokens, size_t start) {
+    if (start >= tokens.size() || tokens[start].kind != Token::Identifier) {
+        report(true, "macro names must be identifiers");
+        return;
+    }
+    const std::string& name = tokens[start].text;
+    if (name == "defined") {
+        report(true, "\"defined\" cannot be used as a macro name");
+        return;
+    }
+
+    auto macro = std::make_unique<Macro>();
+    size_t i = start + 1, n = tokens.size();
+    if (i < n && tokens[i].text == "(" && tokens[i].space.empty()) {
+        macro->functionLike = true;
+        ++i;
+        if (i < n && tokens[i].text == ")") {
+            ++i;
+        } else {
+            while (true) {
+                if (i < n && tokens[i].kind == Token::Identifier) {
+                    macro->params.push_back(tokens[i].text);
+                } else if (i < n && tokens[i].text == "...") {
+                    macro->params.push_back("__VA_ARGS__");
+                    macro->variadic = true;
+                } else {
+                    report(true, "expected parameter name in macro \"" + name + "\"");
+                    return;
+                }
+                ++i;
+                if (i < n && tokens[i].text == ")") {
+                    ++i;
+                    break;
+                }
+                if (i >= n || tokens[i].text != "," || macro->variadic) {
+                    report(true, "expected ',' or ')' in parameters of macro \"" + name + "\"");
+                    return;
+                }
+                ++i;
+            }
+        }
+    }
+    for (; i < n; ++i) {
+        macro->body.push_back(tokens[i]);
+        auto& t = macro->body.back();
+        // comments in the body become plain spaces
+        t.space = macro->body.size() == 1 || t.space.empty() ? "" : " ";
+        if (t.text == "##")
+            t.kind = Token::Paste;
+    }
+    macros[name] = std::move(macro);
+}
+
+/// Handles the #include of the text @rest after the directive name, which is
+/// also split into @tokens from @start.  Returns true if the file is entered.
+bool Preprocessor::includeDirective(std::string rest, const std::vector<Token>& tokens,
+                                    size_t start) {
+    rest.erase(0, rest.find_first_not_of(" \t"));
+    if (rest.empty() || (rest[0] != '"' && rest[0] != '<')) {
+        // #include MACRO
+        std::vector<Token> operand(tokens.begin() + start, tokens.end());
+        rest = spell(expand(operand, {}, false));
+        rest.erase(0, rest.find_first_not_of(" \t"));
+    }
+    size_t end = rest.empty() ? std::string::npos : rest.find(rest[0] == '<' ? '>' : '"', 1);
+    if (end == std::string::npos || (rest[0] != '"' && rest[0] != '<')) {
+        report(true, "#include expects \"FILENAME\" or <FILENAME>");
+        return false;
+    }
+    std::string name = rest.substr(1, end - 1);
+    cstring path = findInclude(name, rest[0] == '"');
+    if (path.isNull()) {
+        report(true, name + ": No such file or directory");
+        return false;
+    }
+    if (includedOnce.count(path.c_str()))
+        return false;
+    if (sources.size() >= 200) {
+        report(true, "#include nested depth 200 exceeds maximum");
+        return false;
+    }
+    auto text = readFile(path.c_str());
+    if (!text) {
+        report(true, name + ": cannot be read");
+        return false;
+    }
+    push(path, text, true);
+    return true;
+}
+
+cstring Preprocessor::findInclude(const std::string& name, bool quoted) {
+    struct stat st;
+    if (!name.empty() && name[0] == '/')
+        return isRegularFile(name, &st) ? cstring(name) : cstring();
+    if (quoted) {
+        // first look next to the file including it
+        std::string current = sources.back()->name.c_str();
+        auto slash = current.rfind('/');
+        std::string path = slash == std::string::npos ? name : current.substr(0, slash + 1) + name;
+        if (isRegularFile(path, &st))
+            return path;
+    }
+    for (auto dir : includeDirs) {
+        std::string path = dir.c_str();
+        if (!path.empty() && path.back() != '/')
+            path += '/';
+        path += name;
+        if (isRegularFile(path, &st))
+            return path;
+    }
+    return cstring();
+}
+
+void Preprocessor::lineDirective(const std::vector<Token>& tokens, size_t start) {
+    std::vector<Token> operand(tokens.begin() + start, tokens.end());
+    auto expanded = expand(operand, {}, false);
+    if (expanded.empty() || expanded[0].kind != Token::Number ||
+        expanded[0].text.find_first_not_of("0123456789") != std::string::npos) {
+        report(true, "#line directive requires a positive integer argument");
+        return;
+    }
+    auto& src = *sources.back();
+    // the next line has the given number
+    src.lineDelta = std::atoi(expanded[0].text.c_str()) - int(src.line + 1);
+    if (expanded.size() > 1 && expanded[1].kind == Token::String) {
+        auto& file = expanded[1].text;
+        src.presumedName = file.substr(1, file.size() - 2);
+    }
+    marker(src.line + 1, src, "");
+}
+
+/// Evaluates the constant expressions of #if and #elif.
+class Preprocessor::Evaluator {
+    Preprocessor& pp;
+    const std::vector<Token>& tokens;
+    size_t pos = 0;
+    bool failed = false;
+
+    const std::string& peek() const {
+        static const std::string end;
+        return pos < tokens.size() ? tokens[pos].text : end;
+    }
+    void fail(const std::string& message) {
+        if (!failed)
+            pp.report(true, message);
+        failed = true;
+    }
+    static int precedence(const std::string& op) {
+        static const std::map<std::string, int> table = {
+            { "*", 10 }, { "/", 10 }, { "%", 10 }, { "+", 9 }, { "-", 9 },
+            { "<<", 8 }, { ">>", 8 }, { "<", 7 }, { ">", 7 }, { "<=", 7 }, { ">=", 7 },
+            { "==", 6 }, { "!=", 6 }, { "&", 5 }, { "^", 4 }, { "|", 3 },
+            { "&&", 2 }, { "||", 1 } };
+        auto it = table.find(op);
+        return it == table.end() ? 0 : it->second;
+    }
+    int64_t number(const std::string& text) {
+        std::string digits = text;
+        while (!digits.empty() && strchr("uUlL", digits.back()))
+            digits.pop_back();
+        char* end = nullptr;
+        auto value = strtoull(digits.c_str(), &end, 0);
+        if (digits.empty() || *end != '\0')
+            fail("invalid integer constant \"" + text + "\" in #if");
+        return static_cast<int64_t>(value);
+    }
+    int64_t primary() {
+        if (pos >= tokens.size()) {
+            fail("missing expression in #if");
+            return 0;
+        }
+        const Token& t = tokens[pos++];
+        if (t.kind == Token::Number) return number(t.text);
+        // identifiers that are not macros are 0
+        if (t.kind == Token::Identifier) return 0;
+        if (t.text == "(") {
+            auto value = conditional();
+            if (peek() == ")")
+                ++pos;
+            else
+                fail("missing ')' in #if expression");
+            return value;
+        }
+        if (t.text == "-") return -primary();
+        if (t.text == "+") return primary();
+        if (t.text == "!") return !primary();
+        if (t.text == "~") return ~primary();
+        fail("token \"" + t.text + "\" is not valid in #if expressions");
+        return 0;
+    }
+    int64_t apply(const std::string& op, int64_t a, int64_t b) {
+        auto ua = static_cast<uint64_t>(a);
+        if ((op == "/" || op == "%") && b == 0) {
+            fail("division by zero in #if");
+            return 0;
+        }
+        if (op == "*") return static_cast<int64_t>(ua * static_cast<uint64_t>(b));
+        if (op == "/") return a / b;
+        if (op == "%") return a % b;
+        if (op == "+") return static_cast<int64_t>(ua + static_cast<uint64_t>(b));
+        if (op == "-") return static_cast<int64_t>(ua - static_cast<uint64_t>(b));
+        if (op == "<<") return b < 0 || b > 63 ? 0 : static_cast<int64_t>(ua << b);
+        if (op == ">>") return b < 0 || b > 63 ? (a < 0 ? -1 : 0) : a >> b;
+        if (op == "<") return a < b;
+        if (op == ">") return a > b;
+        if (op == "<=") return a <= b;
+        if (op == ">=") return a >= b;
+        if (op == "==") return a == b;
+        if (op == "!=") return a != b;
+        if (op == "&") return a & b;
+        if (op == "^") return a ^ b;
+        if (op == "|") return a | b;
+        if (op == "&&") return a && b;
+        return a || b;
+    }
+    int64_t binary(int minPrecedence) {
+        auto left = primary();
+        while (true) {
+            std::string op = peek();
+            int prec = precedence(op);
+            if (prec == 0 || prec < minPrecedence)
+                return left;
+            ++pos;
+            auto right = binary(prec + 1);
+            left = apply(op, left, right);
+        }
+    }
+    int64_t conditional() {
+        auto cond = binary(1);
+        if (peek() != "?")
+            return cond;
+        ++pos;
+        auto ifTrue = conditional();
+        if (peek() == ":")
+            ++pos;
+        else
+            fail("expected ':' in #if expression");
+        auto ifFalse = conditional();
+        return cond ? ifTrue : ifFalse;
+    }
+
+ public:
+    Evaluator(Preprocessor& pp, const std::vector<Token>& tokens) : pp(pp), tokens(tokens) {}
+    bool run() {
+        if (tokens.empty()) {
+            fail("#if with no expression");
+            return false;
+        }
+        auto value = conditional();
+        if (pos < tokens.size())
+            fail("missing binary operator before token \"" + tokens[pos].text + "\"");
+        return !failed && value != 0;
+    }
+};
+
+bool Preprocessor::evaluate(const std::vector<Token>& tokens, size_t start) {
+    // replace defined(NAME) before expanding the macros
+    std::vector<Token> expr;
+    for (size_t i = start; i < tokens.size(); ++i) {
+        if (tokens[i].text != "defined") {
+            expr.push_back(tokens[i]);
+            continue;
+        }
+        size_t j = i + 1;
+        bool paren = j < tokens.size() && tokens[j].text == "(";
+        if (paren) ++j;
+        if (j >= tokens.size() || tokens[j].kind != Token::Identifier ||
+            (paren && (j + 1 >= tokens.size() || tokens[j + 1].text != ")"))) {
+            report(true, "operator \"defined\" requires an identifier");
+            return false;
+        }
+        expr.emplace_back(Token::Number, isDefined(tokens[j].text) ? "1" : "0",
+                          tokens[i].space);
+        i = paren ? j + 1 : j;
+    }
+    auto expanded = expand(expr, {}, false);
+    return Evaluator(*this, expanded).run();
+}
+
+/// True if @a and @b would lex as other tokens when written without a space
+/// between them.
+static bool runTogether(const std::string& a, const std::string& b) {
+    if (a.empty() || b.empty())
+        return false;
+    char x = a.back(), y = b.front();
+    if (isWordChar(x) || x == '.')
+        return isWordChar(y) || y == '.';
+    // an operator, and a character that could extend it to another operator
+    return strchr("+-*/%<>=!&|^:#", x) && strchr("+-*/<>=&|:#", y);
+}
+
+/// Expands the macros in @tokens, except those in @disabled, which are being
+/// expanded already.  If @moreLines, @tokens is a line of the input, and the
+/// arguments of a macro at its end may continue on the next line; this is
+/// flagged by setting argsIncomplete.
+std::vector<Preprocessor::Token>
+Preprocessor::expand(const std::vector<Token>& tokens, const std::set<std::string>& disabled,
+                     bool moreLines) {
+    std::vector<Token> result;
+    size_t expansionEnd = 0;  // end of the last expansion in result
+    auto append = [&](Token t) {
+        if (t.space.empty() && !result.empty() && result.size() == expansionEnd &&
+            runTogether(result.back().text, t.text))
+            t.space = " ";
+        result.push_back(std::move(t));
+    };
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const Token& t = tokens[i];
+        if (t.kind != Token::Identifier || disabled.count(t.text)) {
+            append(t);
+            continue;
+        }
+        if (t.text == "__LINE__") {
+            int line = int(currentLine) + sources.back()->lineDelta;
+            append(Token(Token::Number, std::to_string(line), t.space));
+            continue;
+        }
+        if (t.text == "__FILE__") {
+            append(Token(Token::String,
+                         std::string("\"") + sources.back()->presumedName.c_str() + "\"",
+                         t.space));
+            continue;
+        }
+        auto it = macros.find(t.text);
+        if (it == macros.end()) {
+            append(t);
+            continue;
+        }
+
+        const Macro& macro = *it->second;
+        std::vector<Token> body;
+        if (!macro.functionLike) {
+            body = substitute(macro, {}, disabled);
+        } else {
+            // a function-like macro name not followed by ( is not expanded
+            if (i + 1 >= tokens.size() || tokens[i + 1].text != "(") {
+                append(t);
+                continue;
+            }
+            std::vector<std::vector<Token>> args(1);
+            int depth = 0;
+            size_t j = i + 2;
+            for (; j < tokens.size(); ++j) {
+                auto& a = tokens[j];
+                if (a.text == ")" && depth == 0)
+                    break;
+                if (a.text == "(") {
+                    ++depth;
+                } else if (a.text == ")") {
+                    --depth;
+                } else if (a.text == "," && depth == 0 &&
+                           !(macro.variadic && args.size() == macro.params.size())) {
+                    args.emplace_back();
+                    continue;
+                }
+                args.back().push_back(a);
+            }
+            if (j == tokens.size()) {
+                if (moreLines)
+                    argsIncomplete = true;
+                else
+                    report(true, "unterminated argument list invoking macro \"" + t.text + "\"");
+                result.insert(result.end(), tokens.begin() + i, tokens.end());
+                break;
+            }
+            if (macro.params.empty() && args.size() == 1 && args[0].empty())
+                args.clear();
+            if (macro.variadic && args.size() + 1 == macro.params.size())
+                args.emplace_back();
+            if (args.size() != macro.params.size()) {
+                report(true, "macro \"" + t.text + "\" passed " + std::to_string(args.size()) +
+                       " arguments, but takes " + std::to_string(macro.params.size()));
+                append(t);
+                continue;
+            }
+            body = substitute(macro, args, disabled);
+            i = j;
+        }
+
+        auto inner = disabled;
+        inner.insert(t.text);
+        auto expanded = expand(body, inner, false);
+        if (expanded.empty())
+            continue;
+        expanded.front().space = t.space;
+        if (t.space.empty() && !result.empty() &&
+            runTogether(result.back().text, expanded.front().text))
+            expanded.front().space = " ";
+        result.insert(result.end(), expanded.begin(), expanded.end());
+        expansionEnd = result.size();
+    }
+    return result;
+}
+
+/// Returns the body of @macro with the parameters replaced by @args, and the
+/// # and ## operators applied.
+std::vector<Preprocessor::Token>
+Preprocessor::substitute(const Macro& macro, const std::vector<std::vector<Token>>& args,
+                         const std::set<std::string>& disabled) {
+    auto param = [&](const Token& t) -> int {
+        if (!macro.functionLike || t.kind != Token::Identifier) return -1;
+        auto it = std::find(macro.params.begin(), macro.params.end(), t.text);
+        return it == macro.params.end() ? -1 : int(it - macro.params.begin());
+    };
+
+    std::vector<Token> out;
+    const auto& body = macro.body;
+    for (size_t k = 0; k < body.size(); ++k) {
+        const Token& t = body[k];
+        if (t.text == "#" && k + 1 < body.size() && param(body[k + 1]) >= 0) {
+            std::string text = "\"";
+            bool first = true;
+            for (auto& a : args[param(body[k + 1])]) {
+                if (!first && !a.space.empty()) text += ' ';
+                first = false;
+                for (char c : a.text) {
+                    if (a.kind == Token::String && (c == '"' || c == '\\')) text += '\\';
+                    text += c;
+                }
+            }
+            out.emplace_back(Token::String, text + "\"", t.space);
+            ++k;
+            continue;
+        }
+        int p = param(t);
+        if (p < 0) {
+            out.push_back(t);
+            continue;
+        }
+        bool pasted = (k > 0 && body[k - 1].kind == Token::Paste) ||
+                      (k + 1 < body.size() && body[k + 1].kind == Token::Paste);
+        auto arg = pasted ? args[p] : expand(args[p], disabled, false);
+        if (arg.empty()) {
+            if (pasted)  // a placemarker
+                out.emplace_back(Token::Punct, "", t.space);
+            continue;
+        }
+        arg.front().space = t.space;
+        out.insert(out.end(), arg.begin(), arg.end());
+    }
+
+    std::vector<Token> result;
+    for (size_t k = 0; k < out.size(); ++k) {
+        if (out[k].kind == Token::Paste) {
+            if (!result.empty() && k + 1 < out.size()) {
+                auto& left = result.back();
+                left.text += out[++k].text;
+                bool inComment = false;
+                auto retokenized = tokenize(left.text, inComment, nullptr);
+                if (retokenized.size() == 1)
+                    left.kind = retokenized[0].kind;
+            }
+            continue;
+        }
+        result.push_back(out[k]);
+    }
+    result.erase(std::remove_if(result.begin(), result.end(),
+                                [](const Token& t) { return t.text.empty(); }),
+                 result.end());
+    return result;
+}
+
+}  // namespace P4
@@ -0,0 +1,139 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef FRONTENDS_COMMON_PREPROCESSOR_H_
+#define FRONTENDS_COMMON_PREPROCESSOR_H_
+
+#include <istream>
+#include <map>
+#include <memory>
+#include <set>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "lib/cstring.h"
+
+namespace P4 {
+
+/**
+ * A C preprocessor built into the compiler, used instead of running
+ * `cpp -C -undef -nostdinc -x assembler-with-cpp` in a separate process.
+ * It implements what P4 programs use: #include, object-like and
+ * function-like macros (with #, ## and __VA_ARGS__), __FILE__ and __LINE__,
+ * #if/#ifdef/#ifndef/#elif/#else/#endif, #line, #error, #warning and
+ * #pragma once.  As cpp does for assembler-with-cpp input, other directives
+ * are passed through to the output.
+ *
+ * The output is the same kind of text cpp produces: comments are kept,
+ * included files are bracketed by line markers, and every other input line
+ * produces exactly one output line.  It is produced one line at a time, as
+ * it is read through `stream()`, so the lexer runs while the input is being
+ * preprocessed.  The contents of the files read are cached across
+ * preprocessors in the same process, so the standard include files are read
+ * from disk only once.
+ */
+class Preprocessor {
+ public:
+    Preprocessor();
+    ~Preprocessor();
+    Preprocessor(const Preprocessor&) = delete;
+    Preprocessor& operator=(const Preprocessor&) = delete;
+
+    /// Adds the -I, -D and -U options found in the preprocessor command-line
+    /// @options; other options are ignored.
+    void addOptions(cstring options);
+    /// Adds @dir at the end of the directories searched for included files.
+    void addIncludeDir(cstring dir);
+    /// Defines a macro from a -D option argument: `NAME`, `NAME=body` or
+    /// `NAME(params)=body`.
+    void define(cstring definition);
+    void undefine(cstring name);
+
+    /// Starts preprocessing @file; reports an error and returns false if it
+    /// cannot be read.
+    bool open(cstring file);
+    /// Starts preprocessing @text, read from the (possibly fictitious) file
+    /// @file, which is only used in line markers and for quoted includes.
+    void openText(cstring file, const std::string& text);
+    /// Sets @line to the next line of output, including its newline.
+    /// @returns false at the end of the output.
+    bool getLine(std::string& line);
+    /// A stream reading the rest of the output.
+    std::istream& stream() { return out; }
+
+    /// Forgets the contents of all the files read so far, by all the
+    /// preprocessors in this process.
+    static void clearFileCache();
+
+ private:
+    struct Token;
+    struct Macro;
+    struct Source;
+    struct Conditional;
+    class Evaluator;
+    class OutputBuffer : public std::streambuf {
+        Preprocessor& self;
+        std::string line;
+
+     protected:
+        int_type underflow() override;
+
+     public:
+        explicit OutputBuffer(Preprocessor& self) : self(self) {}
+    };
+
+    std::vector<cstring> includeDirs;
+    std::map<std::string, std::unique_ptr<Macro>> macros;
+    std::vector<std::unique_ptr<Source>> sources;  // stack of open files
+    std::set<std::string> includedOnce;            // files with #pragma once
+    std::vector<std::string> pending;              // output lines not yet read
+    size_t pendingNext = 0;
+    unsigned currentLine = 0;     // line of the current file being processed
+    bool argsIncomplete = false;  // see expand
+    OutputBuffer buffer;
+    std::istream out;
+
+    static std::vector<Token> tokenize(const std::string& text, bool& inComment,
+                                       std::string* trailing);
+    static std::string spell(const std::vector<Token>& tokens);
+    void push(cstring file, std::shared_ptr<const std::string> text, bool included);
+    void pop();
+    bool active() const;
+    bool isDefined(const std::string& name) const;
+    bool readLine(std::string& line, unsigned& lines);
+    void processLine(std::string text, unsigned lines);
+    void directive(const std::string& text, unsigned lines);
+    void conditional(const std::string& name, const std::vector<Token>& tokens, size_t start);
+    void defineDirective(const std::vector<Token>& tokens, size_t start);
+    bool includeDirective(std::string rest, const std::vector<Token>& tokens, size_t start);
+    cstring findInclude(const std::string& name, bool quoted);
+    void lineDirective(const std::vector<Token>& tokens, size_t start);
+    bool evaluate(const std::vector<Token>& tokens, size_t start);
+    std::vector<Token> expand(const std::vector<Token>& tokens,
+                              const std::set<std::string>& disabled, bool moreLines);
+    std::vector<Token> substitute(const Macro& macro,
+                                  const std::vector<std::vector<Token>>& args,
+                                  const std::set<std::string>& disabled);
+    void emit(std::string line);
+    void emitBlank(unsigned lines);
+    void marker(unsigned line, const Source& src, const char* flag);
+    void report(bool isError, const std::string& message);
+};
+
+}  // namespace P4
+
+#endif /* FRONTENDS_COMMON_PREPROCESSOR_H_ */
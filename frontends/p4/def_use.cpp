@@ -14,11 +14,17 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
 #include <boost/functional/hash.hpp>
 #include "def_use.h"
 #include "frontends/p4/methodInstance.h"
 #include "frontends/p4/tableApply.h"
 #include "parserCallGraph.h"
+#include "ir/pass_profile.h"
 #include "lib/ordered_set.h"
 
 namespace P4 {
@@ -31,7 +37,41 @@ ProgramPoint ProgramPoint::beforeStart;
 
 unsigned StorageLocation::crtid = 0;
 
-StorageLocation* StorageFactory::create(const IR::Type* type, cstring name) const {
+StorageLocation* StorageFactory::create(const IR::Type* type, cstring name) {
+    auto result = createLocation(type, name);
+    if (result != nullptr)
+        number(result);
+    return result;
+}
+
+// Numbers the location and its components after they have all been created,
+// since header unions replace the valid fields of their components.
+void StorageFactory::number(StorageLocation* location) {
+    if (location->factory != nullptr)
+        return;  // shared valid field of a header union
+    if (auto wfl = location->to<WithFieldsLocation>()) {
+        for (auto f : wfl->fields()) {
+            auto field = const_cast<StorageLocation*>(f);
+            number(field);
+            location->canonical |= field->canonical;
+        }
+    } else if (auto il = location->to<IndexedLocation>()) {
+        for (auto e : *il) {
+            auto element = const_cast<StorageLocation*>(e);
+            number(element);
+            location->canonical |= element->canonical;
+        }
+        if (auto al = location->to<ArrayLocation>())
+            number(const_cast<StorageLocation*>(al->getLastIndexField()));
+    }
+    location->factory = this;
+    location->index = locations.size();
+    locations.push_back(location);
+    if (location->is<BaseLocation>())
+        location->canonical.setbit(location->index);
+}
+
+StorageLocation* StorageFactory::createLocation(const IR::Type* type, cstring name) {
     if (type->is<IR::Type_Bits>() ||
         type->is<IR::Type_Boolean>() ||
         type->is<IR::Type_Varbits>() ||
@@ -61,7 +101,7 @@ StorageLocation* StorageFactory::create(const IR::Type* type, cstring name) cons
         size_t index = 0;
         for (auto t : bl->components) {
             cstring fieldName = name + "[" + Util::toString(index) + "]";
-            auto sl = create(t, fieldName);
+            auto sl = createLocation(t, fieldName);
             result->createElement(index, sl);
             index++;
         }
@@ -79,25 +119,25 @@ StorageLocation* StorageFactory::create(const IR::Type* type, cstring name) cons
         // other ones.
         StorageLocation* globalValid = nullptr;
         if (type->is<IR::Type_HeaderUnion>())
-            globalValid = create(IR::Type_Boolean::get(), name + "." + validFieldName);
+            globalValid = createLocation(IR::Type_Boolean::get(), name + "." + validFieldName);
 
         for (auto f : st->fields) {
             cstring fieldName = name + "." + f->name;
-            auto sl = create(f->type, fieldName);
+            auto sl = createLocation(f->type, fieldName);
             if (globalValid != nullptr)
                 dynamic_cast<StructLocation*>(sl)->replaceField(
                     fieldName + "." + validFieldName, globalValid);
             result->createField(f->name.name, sl);
         }
         if (st->is<IR::Type_Header>()) {
-            auto valid = create(IR::Type_Boolean::get(), name + "." + validFieldName);
+            auto valid = createLocation(IR::Type_Boolean::get(), name + "." + validFieldName);
             result->createField(validFieldName, valid);
         }
         return result;
     } else if (auto st = type->to<IR::Type_Stack>()) {
         auto result = new ArrayLocation(st, name);
         for (unsigned i = 0; i < st->getSize(); i++) {
-            auto sl = create(st->elementType, name + "[" + Util::toString(i) + "]");
+            auto sl = createLocation(st->elementType, name + "[" + Util::toString(i) + "]");
             result->createElement(i, sl);
         }
         result->setLastIndexField(create(IR::Type_Bits::get(32), name + "." + indexFieldName));
@@ -174,19 +214,17 @@ const LocationSet* StorageLocation::getLastIndexField() const {
 
 const LocationSet* LocationSet::join(const LocationSet* other) const {
     CHECK_NULL(other);
-    if (this == LocationSet::empty)
-        return other;
-    if (other == LocationSet::empty)
+    if (other->isEmpty())
         return this;
-    auto result = new LocationSet(locations);
-    for (auto e : other->locations)
-        result->add(e);
-    return result;
+    if (isEmpty() || locations == other->locations)
+        return other;
+    checkFactory(other->factory);
+    return new LocationSet(other->factory, locations | other->locations);
 }
 
 const LocationSet* LocationSet::getArrayLastIndex() const {
     auto result = new LocationSet();
-    for (auto l : locations) {
+    for (auto l : *this) {
         if (l->is<ArrayLocation>()) {
             auto array = l->to<ArrayLocation>();
             result->add(array->getLastIndexField());
@@ -198,7 +236,7 @@ const LocationSet* LocationSet::getArrayLastIndex() const {
 
 const LocationSet* LocationSet::getField(cstring field) const {
     auto result = new LocationSet();
-    for (auto l : locations) {
+    for (auto l : *this) {
         if (auto strct = l->to<StructLocation>()) {
             if (field == StorageFactory::validFieldName && strct->isHeaderUnion()) {
                 // special handling for union.isValid()
@@ -227,7 +265,7 @@ const LocationSet* LocationSet::getValidField() const
 
 const LocationSet* LocationSet::getIndex(unsigned index) const {
     auto result = new LocationSet();
-    for (auto l : locations) {
+    for (auto l : *this) {
         auto array = l->to<IndexedLocation>();
         array->addElement(index, result);
     }
@@ -236,7 +274,7 @@ const LocationSet* LocationSet::getIndex(unsigned index) const {
 
 const LocationSet* LocationSet::allElements() const {
     auto result = new LocationSet();
-    for (auto l : locations) {
+    for (auto l : *this) {
         auto array = l->to<ArrayLocation>();
         for (auto e : *array)
             result->add(e);
@@ -245,92 +283,81 @@ const LocationSet* LocationSet::allElements() const {
 }
 
 const LocationSet* LocationSet::canonicalize() const {
-    LocationSet* result = new LocationSet();
-    for (auto e : locations)
-        result->addCanonical(e);
-    return result;
+    bitvec canonical;
+    for (auto e : *this)
+        canonical |= e->canonical;
+    if (canonical == locations)
+        return this;
+    return new LocationSet(factory, canonical);
 }
 
 void LocationSet::addCanonical(const StorageLocation* location) {
-    if (location->is<BaseLocation>()) {
-        add(location);
-    } else if (auto wfl = location->to<WithFieldsLocation>()) {
-        for (auto f : wfl->fields())
-            addCanonical(f);
-    } else if (auto a = location->to<IndexedLocation>()) {
-        for (auto e : *a)
-            addCanonical(e);
-    } else {
-        BUG("unexpected location");
-    }
+    CHECK_NULL(location);
+    checkFactory(location->factory);
+    factory = location->factory;
+    locations |= location->canonical;
 }
 
-bool LocationSet::overlaps(const LocationSet* other) const {
-    for (auto s : locations) {
-        if (other->locations.find(s) != other->locations.end())
-            return true;
-    }
-    return false;
+ProgramPoint ProgramPointTrie::push(const ProgramPoint& context, const IR::Node* node) {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    auto &child = children[std::make_pair(context.entry, node)];
+    if (child == nullptr)
+        child = new ProgramPoint::Entry{ context.entry, node, unsigned(children.size()) };
+    return ProgramPoint(this, child);
 }
 
-const ProgramPoints* ProgramPoints::merge(const ProgramPoints* with) const {
-    auto result = new ProgramPoints(points);
-    for (auto p : with->points)
-        result->points.emplace(p);
-    return result;
+ProgramPoint::ProgramPoint(const ProgramPoint& context, const IR::Node* node) {
+    BUG_CHECK(context.trie != nullptr, "Program point outside an analysis");
+    *this = context.trie->push(context, node);
 }
 
-ProgramPoint::ProgramPoint(const ProgramPoint &context, const IR::Node* node) {
-    for (auto e : context.stack)
-        stack.push_back(e);
-    stack.push_back(node);
+std::vector<const IR::Node*> ProgramPoint::getStack() const {
+    std::vector<const IR::Node*> stack;
+    for (auto e = entry; e != nullptr; e = e->parent)
+        stack.push_back(e->node);
+    std::reverse(stack.begin(), stack.end());
+    return stack;
 }
 
-bool ProgramPoint::operator==(const ProgramPoint& other) const {
-    if (stack.size() != other.stack.size())
-        return false;
-    for (unsigned i=0; i < stack.size(); i++)
-        if (stack.at(i) != other.stack.at(i))
-            return false;
-    return true;
+void ProgramPoints::add(ProgramPoint point) {
+    auto it = std::lower_bound(points.begin(), points.end(), point, before);
+    if (it == points.end() || *it != point)
+        points.insert(it, point);
 }
 
-std::size_t ProgramPoint::hash() const {
-    std::size_t result = 0;
-    boost::hash_range(result, stack.begin(), stack.end());
-    return result;
-}
-
-bool ProgramPoints::operator==(const ProgramPoints& other) const {
-    if (points.size() != other.points.size())
-        return false;
-    for (auto p : points)
-        if (other.points.find(p) == other.points.end())
-            return false;
-    return true;
+const ProgramPoints* ProgramPoints::merge(const ProgramPoints* with) const {
+    if (with->points.empty() || this == with)
+        return this;
+    if (points.empty())
+        return with;
+    Points merged;
+    merged.reserve(points.size() + with->points.size());
+    std::set_union(points.begin(), points.end(), with->points.begin(), with->points.end(),
+                   std::back_inserter(merged), before);
+    return new ProgramPoints(std::move(merged));
 }
 
 Definitions* Definitions::joinDefinitions(const Definitions* other) const {
     auto result = new Definitions();
-    for (auto d : other->definitions) {
-        auto loc = d.first;
-        auto defs = d.second;
-        auto current = ::get(definitions, loc);
-        if (current != nullptr) {
-            auto merged = current->merge(defs);
-            result->definitions.emplace(loc, merged);
+    // Both maps are sorted by location index, so they are merged in one pass.
+    auto it = definitions.begin();
+    auto oit = other->definitions.begin();
+    auto &merged = result->definitions;
+    while (it != definitions.end() || oit != other->definitions.end()) {
+        if (oit == other->definitions.end() ||
+            (it != definitions.end() && it->first->index < oit->first->index)) {
+            merged.emplace_hint(merged.end(), *it++);
+        } else if (it == definitions.end() || oit->first->index < it->first->index) {
+            merged.emplace_hint(merged.end(), *oit++);
         } else {
-            result->definitions.emplace(loc, defs);
+            auto points = it->second == oit->second ? it->second : it->second->merge(oit->second);
+            merged.emplace_hint(merged.end(), it->first, points);
+            ++it;
+            ++oit;
         }
     }
-    for (auto d : definitions) {
-        auto loc = d.first;
-        auto defs = d.second;
-        auto current = ::get(other->definitions, loc);
-        if (current == nullptr)
-            result->definitions.emplace(loc, defs);
-        // otherwise have have already done it in the loop above
-    }
     if (unreachable && other->unreachable)
         result->setUnreachable();
     return result;
@@ -381,11 +408,11 @@ Definitions* Definitions::writes(ProgramPoint point, const LocationSet* location
 bool Definitions::operator==(const Definitions& other) const {
     if (definitions.size() != other.definitions.size())
         return false;
-    for (auto d : definitions) {
-        auto od = ::get(other.definitions, d.first);
-        if (od == nullptr)
+    for (auto it = definitions.begin(), oit = other.definitions.begin();
+         it != definitions.end(); ++it, ++oit) {
+        if (it->first != oit->first)
             return false;
-        if (!d.second->operator==(*od))
+        if (it->second != oit->second && !it->second->operator==(*oit->second))
             return false;
     }
     return true;
@@ -469,9 +496,10 @@ void ComputeWriteSet::exitScope(const IR::ParameterList* parameters,
 Definitions* ComputeWriteSet::getDefinitionsAfter(const IR::ParserState* state) {
     ProgramPoint last;
     if (state->components.size() == 0)
-        last = ProgramPoint(state);
+        last = ProgramPoint(allDefinitions->beforeStart(), state);
     else
-        last = ProgramPoint(ProgramPoint(state), state->components.back());
+        last = ProgramPoint(ProgramPoint(allDefinitions->beforeStart(), state),
+                            state->components.back());
     return allDefinitions->getDefinitions(last);
 }
 
@@ -757,42 +785,37 @@ void ComputeWriteSet::visitVirtualMethods(const IR::IndexedVector<IR::Declaratio
 bool ComputeWriteSet::preorder(const IR::P4Parser* parser) {
     LOG3("CWS Visiting " << dbp(parser));
     auto startState = parser->getDeclByName(IR::ParserState::start)->to<IR::ParserState>();
-    auto startPoint = ProgramPoint(startState);
+    auto startPoint = ProgramPoint(allDefinitions->beforeStart(), startState);
     enterScope(parser->getApplyParameters(), &parser->parserLocals, startPoint);
     visitVirtualMethods(parser->parserLocals);
 
-    ParserCallGraph transitions("transitions");
-    ComputeParserCG pcg(storageMap->refMap, &transitions);
-    pcg.setCalledBy(this);
-
-    (void)parser->apply(pcg);
-    ordered_set<const IR::ParserState*> toRun;  // worklist
-    toRun.emplace(startState);
+    static auto &visits = PassProfile::counter("ComputeWriteSet.parserStates");
+    auto graph = allDefinitions->getParserGraph(parser, this);
+    ParserStateGraph::Worklist toRun(*graph);
+    toRun.add(startState);
 
     while (!toRun.empty()) {
-        auto state = *toRun.begin();
-        toRun.erase(state);
+        auto state = toRun.pop();
+        ++visits;
         LOG3("Traversing " << dbp(state));
 
         // We need a new visitor to visit the state,
         // but we use the same data structures
-        ProgramPoint pt(state);
+        ProgramPoint pt(allDefinitions->beforeStart(), state);
         currentDefinitions = allDefinitions->getDefinitions(pt);
         ComputeWriteSet cws(this, pt, currentDefinitions);
         cws.setCalledBy(this);
         (void)state->apply(cws);
 
-        ProgramPoint sp(state);
         auto after = getDefinitionsAfter(state);
-        auto next = transitions.getCallees(state);
-        for (auto n : *next) {
-            ProgramPoint pt(n);
+        for (auto n : graph->successors(state)) {
+            ProgramPoint pt(allDefinitions->beforeStart(), n);
             auto defs = allDefinitions->getDefinitions(pt, true);
             auto newdefs = defs->joinDefinitions(after);
             if (!(*defs == *newdefs)) {
                 // Only run once more if there are any changes
                 setDefinitions(newdefs, n, true);
-                toRun.emplace(n);
+                toRun.add(n);
             }
         }
     }
@@ -801,7 +824,7 @@ bool ComputeWriteSet::preorder(const IR::P4Parser* parser) {
 
 bool ComputeWriteSet::preorder(const IR::P4Control* control) {
     LOG3("CWS Visiting " << dbp(control));
-    auto startPoint = ProgramPoint(control);
+    auto startPoint = ProgramPoint(allDefinitions->beforeStart(), control);
     enterScope(control->getApplyParameters(), &control->controlLocals, startPoint);
     exitDefinitions = new Definitions();
     returnedDefinitions = new Definitions();
@@ -958,7 +981,7 @@ bool ComputeWriteSet::preorder(const IR::Function* function) {
         // We may not know where all virtual methods get called from; when
         // this flag is true we are visiting the method without any context,
         // as if it is a global function.
-        callingContext = ProgramPoint::beforeStart;
+        callingContext = allDefinitions->beforeStart();
     }
     LOG3("CWS Visiting " << dbp(function) << " called from " << callingContext);
     auto point = ProgramPoint(callingContext, function);
@@ -17,9 +17,20 @@ limitations under the License.
 #ifndef _FRONTENDS_P4_DEF_USE_H_
 #define _FRONTENDS_P4_DEF_USE_H_
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
+#include <boost/functional/hash.hpp>
+#include "lib/bitvec.h"
+#include "lib/hvec_map.h"
 #include "lib/ordered_map.h"
 #include "lib/ordered_set.h"
 #include "ir/ir.h"
+#include "frontends/p4/parserCallGraph.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
 
 namespace P4 {
@@ -30,6 +41,14 @@ class LocationSet;
 /// Abstraction for something that is has a left value (variable, parameter)
 class StorageLocation : public IHasDbPrint {
     static unsigned crtid;
+    /// Dense number of this location among the ones created by 'factory'.
+    int index = -1;
+    const StorageFactory* factory = nullptr;
+    /// Indices of the BaseLocations this location is made of.
+    bitvec canonical;
+    friend class StorageFactory;
+    friend class LocationSet;
+    friend class Definitions;
 
  public:
     virtual ~StorageLocation() {}
@@ -174,9 +193,22 @@ class ArrayLocation : public IndexedLocation {
     void addLastIndexField(LocationSet* result) const override;
 };
 
+/// Creates the storage locations of a program and numbers them densely,
+/// so that sets of them can be represented as bit vectors.
 class StorageFactory {
+    /// All locations created, indexed by StorageLocation::index.
+    std::vector<const StorageLocation*> locations;
+
+    StorageLocation* createLocation(const IR::Type* type, cstring name);
+    void number(StorageLocation* location);
+
  public:
-    StorageLocation* create(const IR::Type* type, cstring name) const;
+    StorageFactory() = default;
+    StorageFactory(const StorageFactory&) = delete;
+    StorageFactory& operator=(const StorageFactory&) = delete;
+
+    StorageLocation* create(const IR::Type* type, cstring name);
+    const StorageLocation* getLocation(int index) const { return locations.at(index); }
 
     static const cstring validFieldName;
     static const cstring indexFieldName;
@@ -184,14 +216,34 @@ class StorageFactory {
 
 /// A set of locations that may be read or written by a computation.
 /// In general this is a conservative approximation of the actual location set.
+/// The set is a bit vector of location indices, so all the locations in the
+/// sets being combined must come from the same StorageFactory.  Iteration is
+/// in the order the locations were created.
 class LocationSet : public IHasDbPrint {
-    ordered_set<const StorageLocation*> locations;
+    const StorageFactory* factory = nullptr;
+    bitvec locations;
+
+    LocationSet(const StorageFactory* factory, const bitvec &locations) :
+            factory(factory), locations(locations) {}
+    void checkFactory(const StorageFactory* other) const {
+        BUG_CHECK(factory == nullptr || other == nullptr || factory == other,
+                  "location sets from different storage maps");
+    }
 
  public:
+    class const_iterator {
+        const LocationSet* set;
+        int index;
+     public:
+        const_iterator(const LocationSet* set, int index) : set(set), index(index) {}
+        const StorageLocation* operator*() const { return set->factory->getLocation(index); }
+        const_iterator& operator++() { index = set->locations.ffs(index + 1); return *this; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+    };
+
     LocationSet() = default;
-    explicit LocationSet(const ordered_set<const StorageLocation*> &other) : locations(other) {}
-    explicit LocationSet(const StorageLocation* location)
-    { CHECK_NULL(location); locations.emplace(location); }
+    explicit LocationSet(const StorageLocation* location) { add(location); }
     static const LocationSet* empty;
 
     const LocationSet* getField(cstring field) const;
@@ -200,32 +252,37 @@ class LocationSet : public IHasDbPrint {
     const LocationSet* allElements() const;
     const LocationSet* getArrayLastIndex() const;
 
-    void add(const StorageLocation* location)
-    { CHECK_NULL(location); locations.emplace(location); }
+    void add(const StorageLocation* location) {
+        CHECK_NULL(location);
+        checkFactory(location->factory);
+        factory = location->factory;
+        locations.setbit(location->index); }
     const LocationSet* join(const LocationSet* other) const;
     /// @returns this location set expressed only in terms of BaseLocation;
     /// e.g., a StructLocation is expanded in all its fields.
     const LocationSet* canonicalize() const;
     void addCanonical(const StorageLocation* location);
-    ordered_set<const StorageLocation*>::const_iterator begin() const { return locations.cbegin(); }
-    ordered_set<const StorageLocation*>::const_iterator end()   const { return locations.cend(); }
+    const_iterator begin() const { return const_iterator(this, locations.ffs()); }
+    const_iterator end()   const { return const_iterator(this, -1); }
     void dbprint(std::ostream& out) const override {
         if (locations.empty())
             out << "LocationSet::empty";
-        for (auto l : locations) {
+        for (auto l : *this) {
             l->dbprint(out);
             out << " ";
         }
     }
     // only defined for canonical representations
-    bool overlaps(const LocationSet* other) const;
+    bool overlaps(const LocationSet* other) const {
+        checkFactory(other->factory);
+        return locations.intersects(other->locations); }
     bool isEmpty() const { return locations.empty(); }
 };
 
 /// Maps a declaration to its associated storage.
 class StorageMap : public IHasDbPrint {
     /// Storage location for each declaration.
-    ordered_map<const IR::IDeclaration*, StorageLocation*> storage;
+    hvec_map<const IR::IDeclaration*, StorageLocation*> storage;
     StorageFactory factory;
 
  public:
@@ -260,32 +317,51 @@ class StorageMap : public IHasDbPrint {
     }
 };
 
+class ProgramPointTrie;
+
 /// Indicates a statement in the program.
 class ProgramPoint : public IHasDbPrint {
-    /// The stack is for representing calls for context-sensitive analyses: i.e.,
-    /// table.apply() -> table -> action.
+    /// A program point is a stack of nodes, for representing calls for
+    /// context-sensitive analyses: i.e., table.apply() -> table -> action.
     /// An empty stack represents "beforeStart"
     /// A nullptr on the stack represents a node *after* the termination of
     /// the previous context.  E.g., a stack [Function] is the context before
     /// the function, while [Function, nullptr] is the context after the
     /// function terminates.
-    std::vector<const IR::Node*> stack;
+    /// The stacks of an analysis are interned in the trie of its
+    /// AllDefinitions, so a point is its entry in the trie, and equal stacks
+    /// have the same entry.  The empty stack has no entry.
+    struct Entry {
+        const Entry* parent;
+        const IR::Node* node;
+        unsigned index;  // entries are numbered in the order they are created
+    };
+    ProgramPointTrie* trie = nullptr;
+    const Entry* entry = nullptr;
+
+    ProgramPoint(ProgramPointTrie* trie, const Entry* entry) : trie(trie), entry(entry) {}
+    unsigned index() const { return entry == nullptr ? 0 : entry->index; }
+    friend class ProgramPointTrie;
+    friend class ProgramPoints;
 
  public:
     ProgramPoint() = default;
-    ProgramPoint(const ProgramPoint& other) : stack(other.stack) {}
-    explicit ProgramPoint(const IR::Node* node) { CHECK_NULL(node); stack.push_back(node); }
+    ProgramPoint(const ProgramPoint& other) = default;
+    /// The point of @node called from @context, which must belong to an
+    /// analysis: see AllDefinitions::beforeStart.
     ProgramPoint(const ProgramPoint& context, const IR::Node* node);
     /// A point logically before the function/control/action start.
     static ProgramPoint beforeStart;
     /// We use a nullptr to indicate a point *after* the previous context
     ProgramPoint after() { return ProgramPoint(*this, nullptr); }
-    bool operator==(const ProgramPoint& other) const;
-    std::size_t hash() const;
+    bool operator==(const ProgramPoint& other) const { return entry == other.entry; }
+    bool operator!=(const ProgramPoint& other) const { return entry != other.entry; }
+    std::size_t hash() const { return std::hash<const Entry*>()(entry); }
     void dbprint(std::ostream& out) const override {
         if (isBeforeStart()) {
             out << "<BeforeStart>";
         } else {
+            auto stack = getStack();
             bool first = true;
             for (auto n : stack) {
                 if (!first)
@@ -304,14 +380,32 @@ class ProgramPoint : public IHasDbPrint {
         }
     }
     const IR::Node* last() const
-    { return stack.empty() ? nullptr : stack.back(); }
+    { return entry == nullptr ? nullptr : entry->node; }
     bool isBeforeStart() const
-    { return stack.empty(); }
-    std::vector<const IR::Node*>::const_iterator begin() const { return stack.begin(); }
-    std::vector<const IR::Node*>::const_iterator end() const { return stack.end(); }
+    { return entry == nullptr; }
+    /// @returns the stack of nodes of this point, outermost first.
+    std::vector<const IR::Node*> getStack() const;
     ProgramPoint &operator=(const ProgramPoint &) = default;
     ProgramPoint &operator=(ProgramPoint &&) = default;
 };
+
+/// The stacks of the program points of one analysis.  The entries are never
+/// changed once created, so reading a point takes no lock.
+class ProgramPointTrie {
+    std::unordered_map<std::pair<const ProgramPoint::Entry*, const IR::Node*>,
+                       const ProgramPoint::Entry*,
+                       boost::hash<std::pair<const ProgramPoint::Entry*, const IR::Node*>>>
+            children;
+#ifdef MULTITHREAD
+    std::mutex lock;
+#endif  // MULTITHREAD
+
+ public:
+    /// The empty stack, from which the points of the analysis are built.
+    ProgramPoint beforeStart() { return ProgramPoint(this, nullptr); }
+    /// @returns the point @context with @node pushed.
+    ProgramPoint push(const ProgramPoint& context, const IR::Node* node);
+};
 }  // namespace P4
 
 // inject hash into std namespace so it is picked up by std::unordered_set
@@ -326,38 +420,49 @@ template<> struct hash<P4::ProgramPoint> {
 }  // namespace std
 
 namespace P4 {
+/// A set of program points, sorted in the order they were created.
 class ProgramPoints : public IHasDbPrint {
-    typedef std::unordered_set<ProgramPoint> Points;
+    typedef std::vector<ProgramPoint> Points;
     Points points;
-    explicit ProgramPoints(const Points &points) : points(points) {}
+    explicit ProgramPoints(Points &&points) : points(std::move(points)) {}
+    static bool before(const ProgramPoint& left, const ProgramPoint& right)
+    { return left.index() < right.index(); }
  public:
+    typedef Points::const_iterator const_iterator;
+
     ProgramPoints() = default;
-    explicit ProgramPoints(ProgramPoint point) { points.emplace(point); }
-    void add(ProgramPoint point) { points.emplace(point); }
+    explicit ProgramPoints(ProgramPoint point) { points.push_back(point); }
+    void add(ProgramPoint point);
     const ProgramPoints* merge(const ProgramPoints* with) const;
-    bool operator==(const ProgramPoints& other) const;
+    bool operator==(const ProgramPoints& other) const { return points == other.points; }
     void dbprint(std::ostream& out) const override {
         out << "{";
-        for (auto p : points)
+        for (auto p : *this)
             out << p << " ";
         out << "}";
     }
     size_t size() const { return points.size(); }
     bool containsBeforeStart() const
-    { return points.find(ProgramPoint::beforeStart) != points.end(); }
-    Points::const_iterator begin() const
-    { return points.cbegin(); }
-    Points::const_iterator end() const
-    { return points.cend(); }
+    { return !points.empty() && points.front().isBeforeStart(); }
+    const_iterator begin() const
+    { return const_iterator(points.cbegin()); }
+    const_iterator end() const
+    { return const_iterator(points.cend()); }
 };
 
 /// List of definers for each base storage (at a specific program point).
 class Definitions : public IHasDbPrint {
+    /// Orders the locations by their dense index, so that two
+    /// definition maps can be joined and compared in a single pass.
+    struct ByIndex {
+        bool operator()(const BaseLocation* left, const BaseLocation* right) const
+        { return left->index < right->index; }
+    };
     /// Set of program points that have written last to each location
     /// (conservative approximation).
-    ordered_map<const BaseLocation*, const ProgramPoints*> definitions;
+    std::map<const BaseLocation*, const ProgramPoints*, ByIndex> definitions;
     /// If true the current program point is actually unreachable.
-    bool unreachable;
+    bool unreachable = false;
 
  public:
     Definitions() = default;
@@ -405,11 +510,24 @@ class AllDefinitions : public IHasDbPrint {
     /// P4Table, P4Function -- the definitions are BEFORE the
     /// ProgramPoint.
     std::unordered_map<ProgramPoint, Definitions*> atPoint;
+    /// The stacks of the points of this analysis.
+    ProgramPointTrie programPoints;
+    /// Transition graphs of the parsers, built once for all the
+    /// analyses that use these definitions.
+    std::map<const IR::P4Parser*, const ParserStateGraph*> parserGraphs;
 
  public:
     StorageMap* storageMap;
     AllDefinitions(ReferenceMap* refMap, TypeMap* typeMap) :
             storageMap(new StorageMap(refMap, typeMap)) {}
+    /// The empty context of the points of this analysis.
+    ProgramPoint beforeStart() { return programPoints.beforeStart(); }
+    const ParserStateGraph* getParserGraph(const IR::P4Parser* parser, const Visitor* calledBy) {
+        auto &graph = parserGraphs[parser];
+        if (graph == nullptr)
+            graph = new ParserStateGraph(storageMap->refMap, parser, calledBy);
+        return graph;
+    }
     Definitions* getDefinitions(ProgramPoint point, bool emptyIfNotFound = false) {
         auto it = atPoint.find(point);
         if (it == atPoint.end()) {
@@ -505,6 +623,7 @@ class ComputeWriteSet : public Inspector, public IHasDbPrint {
     explicit ComputeWriteSet(AllDefinitions* allDefinitions) :
             allDefinitions(allDefinitions), currentDefinitions(nullptr),
             returnedDefinitions(nullptr), exitDefinitions(new Definitions()),
+            callingContext(allDefinitions->beforeStart()),
             storageMap(allDefinitions->storageMap), lhs(false), virtualMethod(false)
     { CHECK_NULL(allDefinitions); visitDagOnce = false; }
 
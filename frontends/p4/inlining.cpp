@@ -522,14 +522,13 @@ void GeneralInliner::inline_subst(P4Block *caller,
 
             const IR::MethodCallStatement *call = nullptr;
             const IR::MethodCallStatement *firstCall = nullptr;  // to get directionless parameters
-            for (auto m : workToDo->callToInstance) {
-                if (m.second != inst) continue;
+            for (auto mcs : workToDo->instanceToCalls[inst]) {
                 if (call) {
-                    if (!call->equiv(*m.first)) {
+                    if (!call->equiv(*mcs)) {
                         call = nullptr;
                         break; }
                 } else {
-                    call = firstCall = m.first; } }
+                    call = firstCall = mcs; } }
             CHECK_NULL(firstCall);
             MethodInstance *mi = MethodInstance::resolve(firstCall, refMap, typeMap);
             if (call != nullptr) {
@@ -638,8 +637,8 @@ const IR::Node* GeneralInliner::preorder(IR::MethodCallStatement* statement) {
 
     auto callee = called->to<IR::P4Control>();
     IR::IndexedVector<IR::StatOrDecl> body;
-    // clone the substitution: it may be reused for multiple invocations
-    auto substs = new PerInstanceSubstitutions(*workToDo->substitutions[decl]);
+    // the substitution is only read while renaming, so all invocations share it
+    auto substs = workToDo->substitutions[decl];
 
     auto mi = MethodInstance::resolve(statement->methodCall, refMap, typeMap);
     for (auto param : *mi->substitution.getParametersInArgumentOrder()) {
@@ -796,8 +795,8 @@ const IR::Node* GeneralInliner::preorder(IR::ParserState* state) {
 
         auto called = workToDo->declToCallee[decl];
         auto callee = called->to<IR::P4Parser>();
-        // clone the substitution: it may be reused for multiple invocations
-        auto substs = new PerInstanceSubstitutions(*workToDo->substitutions[decl]);
+        // the substitution is only read while renaming, so all invocations share it
+        auto substs = workToDo->substitutions[decl];
 
         auto mi = MethodInstance::resolve(call->methodCall, refMap, typeMap);
         // Evaluate in and inout parameters in order.
@@ -132,16 +132,15 @@ struct InlineSummary : public IHasDbPrint {
                            const IR::PathExpression*> InlinedInvocationInfo;
 
         /**
-         * Hash for InlinedInvocationInfo used as a key for unordered_map
+         * Hash for InlinedInvocationInfo used as a key for unordered_map.
+         * Uses the structural hash cached in the nodes, which is consistent
+         * with the equiv comparison in key_equal.
          *
          * @see field invocationToState
          */
         struct key_hash {
             std::size_t operator() (const InlinedInvocationInfo &k) const {
-                std::ostringstream oss;
-                std::get<0>(k)->dbprint(oss);
-                std::get<1>(k)->dbprint(oss);
-                return std::hash<std::string>{}(oss.str());
+                return Util::Hash::combine(std::get<0>(k)->hash(), std::get<1>(k)->hash());
             }
         };
 
@@ -164,6 +163,10 @@ struct InlineSummary : public IHasDbPrint {
         std::map<const IR::Declaration_Instance*, PerInstanceSubstitutions*> substitutions;
         /// For each invocation (key) call the instance that is invoked.
         std::map<const IR::MethodCallStatement*, const IR::Declaration_Instance*> callToInstance;
+        /// For each instance (key) the invocations of it, in the order of callToInstance;
+        /// the inverse of callToInstance.
+        std::map<const IR::Declaration_Instance*,
+                 std::vector<const IR::MethodCallStatement*>> instanceToCalls;
 
         /**
          * For each distinct invocation of the subparser identified by InlinedInvocationInfo
@@ -284,24 +287,22 @@ struct InlineSummary : public IHasDbPrint {
         /// otherwise the single caller of this instance.
         const IR::MethodCallStatement* uniqueCaller(
             const IR::Declaration_Instance* instance) const {
-            const IR::MethodCallStatement* call = nullptr;
-            for (auto m : callToInstance) {
-                if (m.second == instance) {
-                    if (call == nullptr)
-                        call = m.first;
-                    else
-                        return nullptr;
-                }
-            }
-            return call;
+            auto it = instanceToCalls.find(instance);
+            if (it == instanceToCalls.end() || it->second.size() != 1)
+                return nullptr;
+            return it->second.front();
         }
     };
     std::map<const IR::IContainer*, PerCaller> callerToWork;
 
     void add(const CallInfo *cci) {
-        callerToWork[cci->caller].declToCallee[cci->instantiation] = cci->callee;
+        auto &work = callerToWork[cci->caller];
+        work.declToCallee[cci->instantiation] = cci->callee;
         for (auto mcs : cci->invocations)
-            callerToWork[cci->caller].callToInstance[mcs] = cci->instantiation;
+            work.callToInstance[mcs] = cci->instantiation;
+        // invocations is ordered the same way as callToInstance
+        work.instanceToCalls[cci->instantiation].assign(
+            cci->invocations.begin(), cci->invocations.end());
     }
     void dbprint(std::ostream& out) const
     { out << "Inline " << callerToWork.size() << " call sites"; }
@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <set>
+#include <utility>
+
 #include "parserCallGraph.h"
 
 namespace P4 {
@@ -45,4 +48,62 @@ void ComputeParserCG::postorder(const IR::SelectExpression* expression) {
     transitions->calls(state, reject->to<IR::ParserState>());
 }
 
+ParserStateGraph::ParserStateGraph(const ReferenceMap* refMap, const IR::P4Parser* parser,
+                                   const Visitor* calledBy) {
+    ParserCallGraph transitions("transitions");
+    ComputeParserCG pcg(refMap, &transitions);
+    pcg.setCalledBy(calledBy);
+    (void)parser->apply(pcg);
+
+    auto startState = parser->getDeclByName(IR::ParserState::start)->to<IR::ParserState>();
+    CHECK_NULL(startState);
+    for (auto state : transitions.nodes) {
+        if (auto callees = transitions.getCallees(state))
+            next.emplace(state, *callees);
+    }
+
+    // Iterative depth-first search, so that long chains of states
+    // (e.g., unrolled loops) do not overflow the stack.
+    std::vector<const IR::ParserState*> postorder;
+    std::set<const IR::ParserState*> seen;
+    std::vector<std::pair<const IR::ParserState*, size_t>> stack;
+    seen.emplace(startState);
+    stack.emplace_back(startState, 0);
+    while (!stack.empty()) {
+        auto state = stack.back().first;
+        auto &succ = successors(state);
+        if (stack.back().second < succ.size()) {
+            auto n = succ.at(stack.back().second++);
+            if (seen.emplace(n).second)
+                stack.emplace_back(n, 0);
+        } else {
+            postorder.push_back(state);
+            stack.pop_back();
+        }
+    }
+    states.assign(postorder.rbegin(), postorder.rend());
+    for (unsigned i = 0; i < states.size(); i++)
+        position.emplace(states.at(i), i);
+}
+
+const std::vector<const IR::ParserState*>&
+ParserStateGraph::successors(const IR::ParserState* state) const {
+    static const std::vector<const IR::ParserState*> none;
+    auto it = next.find(state);
+    return it == next.end() ? none : it->second;
+}
+
+void ParserStateGraph::Worklist::add(const IR::ParserState* state) {
+    auto it = graph.position.find(state);
+    BUG_CHECK(it != graph.position.end(), "%1%: state not reachable from start", state);
+    pending.setbit(it->second);
+}
+
+const IR::ParserState* ParserStateGraph::Worklist::pop() {
+    int index = pending.ffs();
+    BUG_CHECK(index >= 0, "pop from an empty worklist");
+    pending.clrbit(index);
+    return graph.states.at(index);
+}
+
 }  // namespace P4
@@ -17,7 +17,11 @@ limitations under the License.
 #ifndef _FRONTENDS_P4_PARSERCALLGRAPH_H_
 #define _FRONTENDS_P4_PARSERCALLGRAPH_H_
 
+#include <map>
+#include <vector>
+
 #include "ir/ir.h"
+#include "lib/bitvec.h"
 #include "frontends/common/resolveReferences/resolveReferences.h"
 #include "frontends/p4/callGraph.h"
 
@@ -41,6 +45,41 @@ class ComputeParserCG : public Inspector {
     void postorder(const IR::SelectExpression* expression) override;
 };
 
+/** @brief The transition graph of a parser, for dataflow analyses over its states.
+  *
+  * The states reachable from the start state are numbered in reverse
+  * postorder.  A Worklist always yields the first pending state in this
+  * order, so each state is processed after its predecessors, except the
+  * ones that reach it through a loop, and an analysis reaches its fixed
+  * point with few repeated visits.
+  */
+class ParserStateGraph {
+    /// Reachable states, in reverse postorder.
+    std::vector<const IR::ParserState*> states;
+    std::map<const IR::ParserState*, unsigned> position;  // in 'states'
+    std::map<const IR::ParserState*, std::vector<const IR::ParserState*>> next;
+
+ public:
+    ParserStateGraph(const ReferenceMap* refMap, const IR::P4Parser* parser,
+                     const Visitor* calledBy = nullptr);
+    const IR::ParserState* start() const { return states.front(); }
+    const std::vector<const IR::ParserState*>& reachableStates() const { return states; }
+    /// @returns the states that @state may transition to.
+    const std::vector<const IR::ParserState*>& successors(const IR::ParserState* state) const;
+
+    class Worklist {
+        const ParserStateGraph& graph;
+        bitvec pending;
+
+     public:
+        explicit Worklist(const ParserStateGraph& graph) : graph(graph) {}
+        void add(const IR::ParserState* state);
+        bool empty() const { return pending.empty(); }
+        /// Removes and returns the first pending state in reverse postorder.
+        const IR::ParserState* pop();
+    };
+};
+
 }  // namespace P4
 
 #endif /* _FRONTENDS_P4_PARSERCALLGRAPH_H_ */
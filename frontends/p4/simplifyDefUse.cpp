@@ -21,6 +21,7 @@ limitations under the License.
 #include "frontends/p4/ternaryBool.h"
 #include "frontends/p4/sideEffects.h"
 #include "frontends/p4/parserCallGraph.h"
+#include "ir/pass_profile.h"
 
 namespace P4 {
 
@@ -432,9 +433,10 @@ class FindUninitialized : public Inspector {
 
  public:
     FindUninitialized(AllDefinitions* definitions, HasUses* hasUses) :
+            context(definitions->beforeStart()),
             refMap(definitions->storageMap->refMap),
             typeMap(definitions->storageMap->typeMap),
-            definitions(definitions), lhs(false), currentPoint(),
+            definitions(definitions), lhs(false), currentPoint(context),
             hasUses(hasUses), virtualMethod(false),
             headerDefs(new HeaderDefinitions(refMap, typeMap, definitions->storageMap)) {
         CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(definitions);
@@ -446,12 +448,12 @@ class FindUninitialized : public Inspector {
 
     bool preorder(const IR::ParserState* state) override {
         LOG3("FU Visiting state " << state->name);
-        context = ProgramPoint(state);
-        currentPoint = ProgramPoint(state);  // point before the first statement
+        context = ProgramPoint(definitions->beforeStart(), state);
+        currentPoint = context;  // point before the first statement
         visit(state->components, "components");
         if (state->selectExpression != nullptr)
             visit(state->selectExpression);
-        context = ProgramPoint();
+        context = definitions->beforeStart();
         return false;
     }
 
@@ -506,7 +508,7 @@ class FindUninitialized : public Inspector {
     bool preorder(const IR::P4Control* control) override {
         LOG3("FU Visiting control " << control->name << "[" << control->id << "]");
         BUG_CHECK(context.isBeforeStart(), "non-empty context in FindUnitialized::P4Control");
-        currentPoint = ProgramPoint(control);
+        currentPoint = ProgramPoint(definitions->beforeStart(), control);
         headerDefs->clear();
         initHeaderParams(control->getApplyMethodType()->parameters);
         visitVirtualMethods(control->controlLocals);
@@ -522,7 +524,7 @@ class FindUninitialized : public Inspector {
         HeaderDefinitions* saveHeaderDefs = nullptr;
         if (virtualMethod) {
             LOG3("Virtual method");
-            context = ProgramPoint::beforeStart;
+            context = definitions->beforeStart();
             unreachable = false;
             // we must save the definitions from the outer block
             saveHeaderDefs = headerDefs->clone();
@@ -575,7 +577,7 @@ class FindUninitialized : public Inspector {
 
     bool preorder(const IR::P4Parser* parser) override {
         LOG3("FU Visiting parser " << parser->name << "[" << parser->id << "]");
-        currentPoint = ProgramPoint(parser);
+        currentPoint = ProgramPoint(definitions->beforeStart(), parser);
         headerDefs->clear();
         initHeaderParams(parser->getApplyMethodType()->parameters);
         visitVirtualMethods(parser->parserLocals);
@@ -584,23 +586,20 @@ class FindUninitialized : public Inspector {
         auto startState = parser->getDeclByName(IR::ParserState::start)->to<IR::ParserState>();
         auto acceptState = parser->getDeclByName(IR::ParserState::accept)->to<IR::ParserState>();
 
-        ParserCallGraph transitions("transitions");
-        ComputeParserCG pcg(refMap, &transitions);
-        pcg.setCalledBy(this);
-
-        (void)parser->apply(pcg);
-        ordered_set<const IR::ParserState*> toRun;  // worklist
+        static auto &visits = PassProfile::counter("FindUninitialized.parserStates");
+        auto graph = definitions->getParserGraph(parser, this);
+        ParserStateGraph::Worklist toRun(*graph);
         ordered_map<const IR::ParserState*, HeaderDefinitions*> inputHeaderDefs;
 
-        toRun.emplace(startState);
+        toRun.add(startState);
         inputHeaderDefs.emplace(startState, headerDefs);
 
         // We do not report warnings until we have all definitions for every parser state
         reportInvalidHeaders = false;
 
         while (!toRun.empty()) {
-            auto state = *toRun.begin();
-            toRun.erase(state);
+            auto state = toRun.pop();
+            ++visits;
             LOG3("Traversing " << dbp(state));
 
             // We need a new visitor to visit the state,
@@ -610,16 +609,15 @@ class FindUninitialized : public Inspector {
             fu.setCalledBy(this);
             (void)state->apply(fu);
 
-            auto next = transitions.getCallees(state);
-            for (auto n : *next) {
+            for (auto n : graph->successors(state)) {
                 if (inputHeaderDefs.find(n) == inputHeaderDefs.end()) {
                     inputHeaderDefs[n] = headerDefs->clone();
-                    toRun.emplace(n);
+                    toRun.add(n);
                 } else {
                     auto newInputDefs = inputHeaderDefs[n]->intersect(headerDefs);
                     if (*newInputDefs != *inputHeaderDefs[n]) {
                         inputHeaderDefs[n] = newInputDefs;
-                        toRun.emplace(n);
+                        toRun.add(n);
                     }
                 }
             }
@@ -637,9 +635,11 @@ class FindUninitialized : public Inspector {
 
         headerDefs = inputHeaderDefs[acceptState];
         unreachable = false;
-        auto accept = ProgramPoint(parser->getDeclByName(IR::ParserState::accept)->getNode());
+        auto accept = ProgramPoint(definitions->beforeStart(),
+                                   parser->getDeclByName(IR::ParserState::accept)->getNode());
         auto acceptdefs = definitions->getDefinitions(accept, true);
-        auto reject = ProgramPoint(parser->getDeclByName(IR::ParserState::reject)->getNode());
+        auto reject = ProgramPoint(definitions->beforeStart(),
+                                   parser->getDeclByName(IR::ParserState::reject)->getNode());
         auto rejectdefs = definitions->getDefinitions(reject, true);
 
         auto outputDefs = acceptdefs->joinDefinitions(rejectdefs);
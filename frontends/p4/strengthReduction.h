@@ -42,7 +42,7 @@ namespace P4 {
   *   - division and modulus by `0`
   *
   */
-class DoStrengthReduction final : public Transform {
+class DoStrengthReduction final : public Transform, public DeclarationLocal {
     /// @returns `true` if @p expr is the constant `1`.
     bool isOne(const IR::Expression* expr) const;
     /// @returns `true` if @p expr is the constant `0`.
@@ -66,6 +66,7 @@ class DoStrengthReduction final : public Transform {
 
  public:
     DoStrengthReduction() { visitDagOnce = true; setName("StrengthReduction"); }
+    DoStrengthReduction *clone() const override { return new DoStrengthReduction(*this); }
 
     using Transform::postorder;
 
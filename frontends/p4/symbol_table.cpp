@@ -278,6 +278,82 @@ void ProgramStructure::declareParameters(const IR::IndexedVector<IR::Parameter>*
         declareObject(param->name, param->type->toString());
 }
 
+void ProgramStructure::declarePrototype(IR::ID name, const IR::Type_Method* type) {
+    declareObject(name, type->returnType ? type->returnType->toString() : cstring("void"));
+    if (!type->typeParameters->empty())
+        markAsTemplate(name);
+    pushNamespace(name.srcInfo, false);
+    declareTypes(&type->typeParameters->parameters);
+    declareParameters(&type->parameters->parameters);
+}
+
+// This follows the actions of the grammar rules in p4parser.ypp; only the
+// symbols that outlive the declaration matter, so nested bodies are skipped.
+void ProgramStructure::declareTopLevel(const IR::Node* decl) {
+    if (auto st = decl->to<IR::Type_StructLike>()) {
+        pushContainerType(st->name, true);
+        markAsTemplate(st->name);
+        declareTypes(&st->typeParameters->parameters);
+        pop();
+    } else if (decl->is<IR::Type_Enum>() || decl->is<IR::Type_SerEnum>() ||
+               decl->is<IR::Type_Typedef>() || decl->is<IR::Type_Newtype>()) {
+        declareType(decl->to<IR::Type_Declaration>()->name);
+    } else if (auto ab = decl->to<IR::Type_ArchBlock>()) {
+        pushContainerType(ab->name, !ab->is<IR::Type_Package>());
+        if (!ab->typeParameters->empty())
+            markAsTemplate(ab->name);
+        declareTypes(&ab->typeParameters->parameters);
+        if (auto app = ab->to<IR::IApply>())
+            declareParameters(&app->getApplyParameters()->parameters);
+        else
+            declareParameters(&ab->to<IR::Type_Package>()->constructorParams->parameters);
+        pop();
+    } else if (decl->is<IR::P4Parser>() || decl->is<IR::P4Control>()) {
+        auto type = decl->is<IR::P4Parser>()
+                ? decl->to<IR::P4Parser>()->type->to<IR::Type_ArchBlock>()
+                : decl->to<IR::P4Control>()->type->to<IR::Type_ArchBlock>();
+        pushContainerType(type->name, true);
+        if (!type->typeParameters->empty())
+            markAsTemplate(type->name);
+        declareTypes(&type->typeParameters->parameters);
+        declareParameters(&type->to<IR::IApply>()->getApplyParameters()->parameters);
+        auto locals = decl->is<IR::P4Parser>()
+                ? &decl->to<IR::P4Parser>()->parserLocals
+                : &decl->to<IR::P4Control>()->controlLocals;
+        for (auto local : *locals) {
+            if (auto inst = local->to<IR::Declaration_Instance>())
+                declareObject(inst->name, inst->type->toString());
+            else if (auto var = local->to<IR::Declaration_Variable>())
+                declareObject(var->name, var->type->toString());
+            else if (auto cst = local->to<IR::Declaration_Constant>())
+                declareObject(cst->name, cst->type->toString());
+        }
+        pop();
+    } else if (auto ext = decl->to<IR::Type_Extern>()) {
+        pushContainerType(ext->name, true);
+        if (!ext->typeParameters->empty())
+            markAsTemplate(ext->name);
+        declareTypes(&ext->typeParameters->parameters);
+        for (auto method : ext->methods) {
+            if (method->name == ext->name)
+                continue;  // constructors declare nothing
+            declarePrototype(method->name, method->type);
+            pop();
+        }
+        pop();
+    } else if (auto method = decl->to<IR::Method>()) {
+        declarePrototype(method->name, method->type);
+        pop();
+    } else if (auto func = decl->to<IR::Function>()) {
+        declarePrototype(func->name, func->type);
+        pop();
+    } else if (auto inst = decl->to<IR::Declaration_Instance>()) {
+        declareObject(inst->name, inst->type->toString());
+    } else if (auto cst = decl->to<IR::Declaration_Constant>()) {
+        declareObject(cst->name, cst->type->toString());
+    }
+}
+
 void ProgramStructure::endParse() {
     BUG_CHECK(currentNamespace == rootNamespace,
               "Namespace stack is not empty at the end of parsing");
@@ -52,6 +52,8 @@ class ProgramStructure final {
     void push(Namespace* ns);
     NamedSymbol* lookup(const cstring identifier);
     void declare(NamedSymbol* symbol);
+    // Declarations of a method or function prototype; leaves its namespace open
+    void declarePrototype(IR::ID name, const IR::Type_Method* type);
 
  public:
     enum class SymbolKind {
@@ -75,6 +77,9 @@ class ProgramStructure final {
     // Declares these types in the current scope
     void declareTypes(const IR::IndexedVector<IR::Type_Var>* typeVars);
     void declareParameters(const IR::IndexedVector<IR::Parameter>* params);
+    // Declares the symbols that parsing the top-level declaration 'decl'
+    // would have declared; used for declarations parsed by another parser.
+    void declareTopLevel(const IR::Node* decl);
     SymbolKind lookupIdentifier(cstring identifier);
 
     void startAbsolutePath();
@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "lib/log.h"
+#include "ir/pass_profile.h"
 #include "typeChecker.h"
 #include "typeUnification.h"
 #include "typeSubstitution.h"
@@ -133,9 +134,113 @@ const IR::Type* TypeInference::cloneWithFreshTypeVariables(const IR::IMayBeGener
     CHECK_NULL(cl);
     learn(cl, this);
     LOG3("Cloned for type variables " << type << " into " << cl);
+    clonedFrom.emplace(cl->to<IR::Type>(), type->to<IR::Type>());
     return cl->to<IR::Type>();
 }
 
+bool TypeInference::hasTypeVariables(const IR::Type* type) {
+    auto it = typeVariables.find(type);
+    if (it != typeVariables.end())
+        return it->second;
+    bool result = false;
+    forAllMatching<IR::Type_Var>(type, [&result](const IR::Type_Var*) { result = true; });
+    forAllMatching<IR::Type_InfInt>(type, [&result](const IR::Type_InfInt*) { result = true; });
+    typeVariables.emplace(type, result);
+    return result;
+}
+
+TypeVariableSubstitution* TypeInference::unifyCall(
+    const IR::Node* errorPosition, const IR::Type_MethodBase* methodType,
+    const IR::Type_MethodCall* callType, const IR::Type_Var* returnType,
+    cstring errorFormat, std::initializer_list<const IR::Node*> errorArgs) {
+    static auto &calls = PassProfile::counter("TypeInference.methodCalls");
+    static auto &reused = PassProfile::counter("TypeInference.methodCalls.reused");
+    ++calls;
+
+    // A solution can only be reused if it depends on nothing but the
+    // signature: the original method may only refer to its own type
+    // parameters, and the argument types must be fully known, except for
+    // integer literals, whose type variables are still unbound.
+    auto original = ::get(clonedFrom, methodType);
+    bool cacheable = original != nullptr;
+    if (cacheable) {
+        auto typeParams = original->to<IR::Type_MethodBase>()->typeParameters;
+        forAllMatching<IR::Type_Var>(original, [&](const IR::Type_Var* tv) {
+            if (typeParams->getDeclByName(tv->name) != tv)
+                cacheable = false; });
+        forAllMatching<IR::Type_InfInt>(original, [&](const IR::Type_InfInt*) {
+            cacheable = false; });
+    }
+    CallSignature signature;
+    std::vector<const IR::ITypeVar*> literals;
+    if (cacheable) {
+        signature.method = original;
+        for (auto type : *callType->typeArguments) {
+            signature.types.push_back(type);
+            cacheable = cacheable && !hasTypeVariables(type);
+        }
+        for (auto arg : *callType->arguments) {
+            signature.names.push_back(arg->argument->name.name);
+            signature.flags.push_back(arg->leftValue);
+            signature.flags.push_back(arg->compileTimeConstant);
+            if (auto literal = arg->type->to<IR::Type_InfInt>()) {
+                signature.types.push_back(nullptr);
+                literals.push_back(literal);
+                cacheable = cacheable && typeMap->getSubstitutions()->lookup(literal) == nullptr;
+            } else {
+                signature.types.push_back(arg->type);
+                cacheable = cacheable && !hasTypeVariables(arg->type);
+            }
+        }
+    }
+    if (!cacheable)
+        return unify(errorPosition, methodType, callType, errorFormat, errorArgs);
+
+    auto params = methodType->typeParameters->parameters;
+    auto it = callSolutions.find(signature);
+    if (it != callSolutions.end()) {
+        auto &solution = it->second;
+        auto tvs = new TypeVariableSubstitution();
+        for (size_t i = 0; i < params.size(); i++) {
+            if (solution.typeParameters.at(i) != nullptr)
+                tvs->setBinding(params.at(i), solution.typeParameters.at(i));
+        }
+        for (size_t i = 0; i < literals.size(); i++) {
+            if (solution.arguments.at(i) != nullptr)
+                tvs->setBinding(literals.at(i), solution.arguments.at(i));
+        }
+        tvs->setBinding(returnType, solution.returnType);
+        addSubstitutions(tvs);
+        ++reused;
+        LOG3("Reusing solution " << tvs << " for " << callType);
+        return tvs;
+    }
+
+    auto tvs = unify(errorPosition, methodType, callType, errorFormat, errorArgs);
+    if (tvs == nullptr)
+        return tvs;
+    // Only remember solutions that bind the call's own variables to known types.
+    CallSolution solution;
+    size_t bound = 0;
+    auto known = [&](const IR::ITypeVar* var) {
+        auto type = tvs->lookup(var);
+        if (type == nullptr)
+            return type;
+        bound++;
+        if (hasTypeVariables(type))
+            cacheable = false;
+        return type;
+    };
+    for (auto param : params)
+        solution.typeParameters.push_back(known(param));
+    for (auto literal : literals)
+        solution.arguments.push_back(known(literal));
+    solution.returnType = known(returnType);
+    if (cacheable && solution.returnType != nullptr && bound == tvs->size())
+        callSolutions.emplace(signature, solution);
+    return tvs;
+}
+
 TypeInference::TypeInference(ReferenceMap* refMap, TypeMap* typeMap,
                              bool readOnly, bool checkArrays) :
         refMap(refMap), typeMap(typeMap),
@@ -151,6 +256,9 @@ Visitor::profile_t TypeInference::init_apply(const IR::Node* node) {
         LOG2("TypeInference for " << dbp(node));
     }
     initialNode = node;
+    clonedFrom.clear();
+    callSolutions.clear();
+    typeVariables.clear();
     refMap->validateMap(node);
     return Transform::init_apply(node);
 }
@@ -165,6 +273,29 @@ void TypeInference::end_apply(const IR::Node* node) {
         LOG3("Typemap: " << std::endl << typeMap);
 }
 
+const IR::Node* TypeInference::apply_visitor(const IR::Node* n, const char* name) {
+    // Expressions and types are already skipped by done(), in their
+    // visitor methods, and there are too many of them to track; declared
+    // types, which include the controls and parsers, are tracked.
+    if (n == nullptr || n->is<IR::Expression>() ||
+        (n->is<IR::Type>() && !n->is<IR::Type_Declaration>()))
+        return Transform::apply_visitor(n, name);
+    if (typeMap->isChecked(n)) {
+        LOG3("TI Skipping checked " << dbp(n));
+        // An unchanged action list is still the latest version
+        if (auto al = n->to<IR::ActionList>())
+            currentActionList = al;
+        if (auto parent = getChildContext())
+            parent->child_index++;
+        return n;
+    }
+    unsigned errors = ::errorCount();
+    auto result = Transform::apply_visitor(n, name);
+    if (result == n && ::errorCount() == errors)
+        typeMap->setChecked(n);
+    return result;
+}
+
 TypeInference *TypeInference::clone() const {
     return new TypeInference(this->refMap, this->typeMap, true);
 }
@@ -3525,9 +3656,9 @@ const IR::Node* TypeInference::postorder(IR::MethodCallExpression* expression) {
         auto callType = new IR::Type_MethodCall(
             expression->srcInfo, typeArgs, rettype, args);
 
-        auto tvs = unify(expression, methodBaseType, callType,
-                         "Function type '%1%' does not match invocation type '%2%'",
-                         { methodBaseType, callType });
+        auto tvs = unifyCall(expression, methodBaseType, callType, rettype,
+                             "Function type '%1%' does not match invocation type '%2%'",
+                             { methodBaseType, callType });
         if (tvs == nullptr)
             return expression;
 
@@ -17,6 +17,10 @@ limitations under the License.
 #ifndef _TYPECHECKING_TYPECHECKER_H_
 #define _TYPECHECKING_TYPECHECKER_H_
 
+#include <map>
+#include <tuple>
+#include <vector>
+
 #include "ir/ir.h"
 #include "frontends/p4/typeMap.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
@@ -167,6 +171,42 @@ class TypeInference : public Transform {
     const IR::Node* typeSet(const IR::Operation_Binary* op);
 
     const IR::Type* cloneWithFreshTypeVariables(const IR::IMayBeGenericType* type);
+
+    /// Method types cloned by cloneWithFreshTypeVariables, mapped to the
+    /// generic types they were cloned from.
+    std::map<const IR::Type*, const IR::Type*> clonedFrom;
+    /// Everything the unifier looks at when solving a call of a cloned
+    /// generic method: the original method type, the type arguments, and
+    /// the name, type and flags of each argument.  The types of integer
+    /// literal arguments are type variables themselves and are left out.
+    struct CallSignature {
+        const IR::Type* method;
+        std::vector<const IR::Type*> types;
+        std::vector<cstring> names;
+        std::vector<bool> flags;
+        bool operator<(const CallSignature& other) const {
+            return std::tie(method, types, names, flags) <
+                    std::tie(other.method, other.types, other.names, other.flags);
+        }
+    };
+    /// The solution found for a CallSignature, as the types bound to the
+    /// type parameters of the method, to the integer literal arguments and
+    /// to the returned type.
+    struct CallSolution {
+        std::vector<const IR::Type*> typeParameters;
+        std::vector<const IR::Type*> arguments;
+        const IR::Type* returnType;
+    };
+    std::map<CallSignature, CallSolution> callSolutions;
+    std::map<const IR::Type*, bool> typeVariables;
+    /// True if @type contains type variables.
+    bool hasTypeVariables(const IR::Type* type);
+    /// Unifies @methodType with @callType; the result is reused for further
+    /// calls of the same generic method with the same argument types.
+    TypeVariableSubstitution* unifyCall(
+        const IR::Node* errorPosition, const IR::Type_MethodBase* methodType,
+        const IR::Type_MethodCall* callType, const IR::Type_Var* returnType,
+        cstring errorFormat, std::initializer_list<const IR::Node*> errorArgs);
     std::pair<const IR::Type*, const IR::Vector<IR::Argument>*>
     containerInstantiation(const IR::Node* node,
                            const IR::Vector<IR::Argument>* args,
@@ -320,6 +360,9 @@ class TypeInference : public Transform {
     const IR::Node* postorder(IR::Annotation* annotation) override;
 
     Visitor::profile_t init_apply(const IR::Node* node) override;
+    /// Skips subtrees that the typeMap records as already checked, and
+    /// records the ones checked now.
+    const IR::Node* apply_visitor(const IR::Node* n, const char* name = 0) override;
     void end_apply(const IR::Node* Node) override;
 
     TypeInference* clone() const override;
@@ -15,6 +15,8 @@ limitations under the License.
 */
 
 #include "typeMap.h"
+#include "ir/pass_profile.h"
+#include "lib/hash.h"
 #include "lib/map.h"
 
 namespace P4 {
@@ -95,6 +97,7 @@ void TypeMap::cloneExpressionProperties(const IR::Expression* to,
 void TypeMap::clear() {
     LOG3("Clearing typeMap");
     typeMap.clear(); leftValues.clear(); constants.clear(); allTypeVariables.clear();
+    checked.clear();
     program = nullptr;
     ProgramMap::clear();
 }
@@ -365,23 +368,48 @@ bool TypeMap::implicitlyConvertibleTo(const IR::Type* from, const IR::Type* to)
 }
 
 // Used for tuples, stacks and lists only
+// A hash of the parts of a type that strict equivalence always compares,
+// so that equivalent types have the same hash.
+size_t TypeMap::canonicalHash(const IR::Type* type) {
+    if (type == nullptr)
+        return 0;
+    size_t rv = std::hash<cstring>()(type->node_type_name());
+    if (auto tb = type->to<IR::Type_Bits>()) {
+        rv = Util::Hash::combine(rv, tb->size);
+        rv = Util::Hash::combine(rv, tb->isSigned);
+    } else if (auto tt = type->to<IR::Type_Type>()) {
+        rv = Util::Hash::combine(rv, canonicalHash(tt->type));
+    } else if (auto ts = type->to<IR::Type_Stack>()) {
+        rv = Util::Hash::combine(rv, canonicalHash(ts->elementType));
+        if (ts->sizeKnown())
+            rv = Util::Hash::combine(rv, ts->getSize());
+    } else if (auto tl = type->to<IR::Type_BaseList>()) {
+        for (auto c : tl->components)
+            rv = Util::Hash::combine(rv, canonicalHash(c));
+    } else if (auto st = type->to<IR::Type_StructLike>()) {
+        // not the name, which is not compared with a Type_UnknownStruct
+        for (auto f : st->fields) {
+            rv = Util::Hash::combine(rv, std::hash<cstring>()(f->name.name));
+            rv = Util::Hash::combine(rv, canonicalHash(f->type)); }
+    }
+    return rv;
+}
+
 const IR::Type* TypeMap::getCanonical(const IR::Type* type) {
-    // Currently a linear search; hopefully this won't be too expensive in practice
-    std::vector<const IR::Type*>* searchIn;
-    if (type->is<IR::Type_Stack>())
-        searchIn = &canonicalStacks;
-    else if (type->is<IR::Type_Tuple>())
-        searchIn = &canonicalTuples;
-    else if (type->is<IR::Type_List>())
-        searchIn = &canonicalLists;
-    else
+    static auto &lookups = PassProfile::counter("TypeMap.getCanonical");
+    static auto &compared = PassProfile::counter("TypeMap.getCanonical.compared");
+    if (!type->is<IR::Type_Stack>() && !type->is<IR::Type_Tuple>() &&
+        !type->is<IR::Type_List>())
         BUG("%1%: unexpected type", type);
 
-    for (auto t : *searchIn) {
+    ++lookups;
+    auto &bucket = canonicalTypes[canonicalHash(type)];
+    for (auto t : bucket) {
+        ++compared;
         if (equivalent(type, t, true))
             return t;
     }
-    searchIn->push_back(type);
+    bucket.push_back(type);
     return type;
 }
 
@@ -18,6 +18,8 @@ limitations under the License.
 #define _FRONTENDS_P4_TYPEMAP_H_
 
 #include "ir/ir.h"
+#include "lib/hvec_map.h"
+#include "lib/hvec_set.h"
 #include "frontends/common/programMap.h"
 #include "frontends/p4/typeChecking/typeSubstitution.h"
 
@@ -41,21 +43,28 @@ class TypeMap final : public ProgramMap {
  protected:
     // We want to have the same canonical type for two
     // different tuples, lists, or stacks with the same signature.
-    std::vector<const IR::Type*> canonicalTuples;
-    std::vector<const IR::Type*> canonicalStacks;
-    std::vector<const IR::Type*> canonicalLists;
+    // Indexed by canonicalHash, which is equal for equivalent types.
+    hvec_map<size_t, std::vector<const IR::Type*>> canonicalTypes;
+    static size_t canonicalHash(const IR::Type* type);
 
     // Map each node to its canonical type
-    ordered_map<const IR::Node*, const IR::Type*> typeMap;
+    hvec_map<const IR::Node*, const IR::Type*> typeMap;
     // All left-values in the program.
-    ordered_set<const IR::Expression*> leftValues;
+    hvec_set<const IR::Expression*> leftValues;
     // All compile-time constants.  A compile-time constant
     // is not necessarily a constant - it could be a directionless
     // parameter as well.
-    ordered_set<const IR::Expression*> constants;
+    hvec_set<const IR::Expression*> constants;
     // For each type variable in the program the actual
     // type that is substituted for it.
     TypeVariableSubstitution allTypeVariables;
+    // Nodes (other than expressions and types, which are looked up
+    // in typeMap) whose whole subtree has been type-checked without
+    // change or error.  IR nodes are immutable, so the types of all the
+    // nodes in these subtrees are still in the map, and TypeInference does
+    // not need to visit them again after a Transform has replaced other
+    // parts of the program.
+    hvec_set<const IR::Node*> checked;
 
     // checks some preconditions before setting the type
     void checkPrecondition(const IR::Node* element, const IR::Type* type) const;
@@ -79,6 +88,10 @@ class TypeMap final : public ProgramMap {
     bool isCompileTimeConstant(const IR::Expression* expression) const;
     size_t size() const
     { return typeMap.size(); }
+    bool isChecked(const IR::Node* node) const
+    { return checked.count(node) != 0; }
+    void setChecked(const IR::Node* node)
+    { checked.insert(node); }
 
     void setLeftValue(const IR::Expression* expression);
     void cloneExpressionProperties(const IR::Expression* to,
@@ -26,12 +26,13 @@ namespace P4 {
 Removes casts where the input expression has the exact same type
 as the cast type
 */
-class RemoveUselessCasts : public Transform {
+class RemoveUselessCasts : public Transform, public DeclarationLocal {
     const P4::TypeMap* typeMap;
 
  public:
     explicit RemoveUselessCasts(const P4::TypeMap* typeMap): typeMap(typeMap)
     { CHECK_NULL(typeMap); setName("RemoveUselessCasts"); }
+    RemoveUselessCasts *clone() const override { return new RemoveUselessCasts(*this); }
     const IR::Node* postorder(IR::Cast* cast) override;
 };
 
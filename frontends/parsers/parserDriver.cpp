@@ -1,9 +1,16 @@
 #include "parserDriver.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cerrno>
 #include <cstdio>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/format.hpp>
@@ -17,6 +24,7 @@
 #include "frontends/parsers/v1/v1lexer.hpp"
 #include "frontends/parsers/v1/v1parser.hpp"
 #include "lib/error.h"
+#include "lib/parallel.h"
 
 
 #ifdef HAVE_LIBBOOST_IOSTREAMS
@@ -111,6 +119,7 @@ void AbstractParserDriver::onParseError(const Util::SourceInfo& location,
                                         const std::string& message) {
     static const std::string unexpectedIdentifierError =
         "syntax error, unexpected IDENTIFIER";
+    if (!reportErrors) return;
     auto& context = BaseCompileContext::get();
     if (boost::equal(message, unexpectedIdentifierError)) {
         context.errorReporter().parser_error(location, boost::format("%s \"%s\"") %
@@ -129,6 +138,12 @@ P4ParserDriver::P4ParserDriver()
 bool
 P4ParserDriver::parse(AbstractP4Lexer& lexer, const char* sourceFile,
                       unsigned sourceLine /* = 1 */) {
+    // Provide an initial source location.
+    sources->mapLine(sourceFile, sourceLine);
+    return parseMore(lexer);
+}
+
+bool P4ParserDriver::parseMore(AbstractP4Lexer& lexer) {
     // Create and configure the parser.
     P4Parser parser(*this, lexer);
 
@@ -138,9 +153,6 @@ P4ParserDriver::parse(AbstractP4Lexer& lexer, const char* sourceFile,
     structure->setDebug(parser.debug_level() != 0);
 #endif
 
-    // Provide an initial source location.
-    sources->mapLine(sourceFile, sourceLine);
-
     // Parse.
     if (parser.parse() != 0) return false;
     structure->endParse();
@@ -165,6 +177,363 @@ P4ParserDriver::parse(FILE* in, const char* sourceFile,
     return parse(inputStream.get(), sourceFile, sourceLine);
 }
 
+namespace {
+
+/// If @line is a line marker that the lexer maps ('# 12 "file"' or
+/// '#line 12 "file"'), sets @number and @file to the line number and file
+/// it names and @returns true.
+bool isLineMarker(const std::string& line, std::string* number = nullptr,
+                  std::string* file = nullptr) {
+    size_t pos;
+    if (line.compare(0, 5, "#line") == 0)
+        pos = 5;
+    else if (line.compare(0, 2, "# ") == 0)
+        pos = 2;
+    else
+        return false;
+    pos = line.find_first_not_of(" \t", pos);
+    if (pos == std::string::npos || !isdigit(line[pos])) return false;
+    auto digits = pos;
+    pos = line.find_first_not_of("0123456789", pos);
+    if (pos == std::string::npos) return false;
+    auto numberEnd = pos;
+    pos = line.find_first_not_of(" \t", pos);
+    if (pos == std::string::npos || line[pos] != '"') return false;
+    auto end = line.find('"', pos + 1);
+    if (number) *number = line.substr(digits, numberEnd - digits);
+    if (file) *file = line.substr(pos + 1, end == std::string::npos ? end : end - pos - 1);
+    return true;
+}
+
+/// Splits preprocessed input into runs of lines that come alternately from
+/// the program and from system include files; a run of system lines starts
+/// with the line marker entering the first file.  The bool is true for those.
+std::vector<std::pair<bool, std::string>> splitIncludeRuns(std::istream& in) {
+    std::vector<std::pair<bool, std::string>> runs;
+    bool system = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string file;
+        if (isLineMarker(line, nullptr, &file))
+            system = cstring(file).startsWith(p4includePath);
+        if (runs.empty() || runs.back().first != system)
+            runs.emplace_back(system, std::string());
+        runs.back().second += line;
+        runs.back().second += '\n';
+    }
+    return runs;
+}
+
+/// @returns the first flag of the line marker @line: 1 when it enters an
+/// included file, 2 when it returns to the including file, 0 otherwise.
+int lineMarkerFlag(const std::string& line) {
+    if (!isLineMarker(line)) return 0;
+    auto quote = line.find('"', line.find('"') + 1);
+    if (quote == std::string::npos) return 0;
+    auto pos = line.find_first_not_of(" \t", quote + 1);
+    if (pos == std::string::npos || !isdigit(line[pos])) return 0;
+    return atoi(line.c_str() + pos);
+}
+
+/// A part of the preprocessed program that parseIncludeUnits parses on its
+/// own, and what a scan of its text tells about it.
+struct IncludeUnit {
+    std::string text;
+    /// The identifiers in the text.
+    std::unordered_set<cstring> identifiers;
+    /// The identifiers outside any brackets; they include the names of the
+    /// declarations of the unit.
+    std::unordered_set<cstring> topLevel;
+    /// The length of the longest chain of earlier units that this one
+    /// appears to depend on; the units of each level are parsed together.
+    unsigned level = 0;
+    /// The declarations parsed from the text; null if it could not be parsed.
+    const IR::Vector<IR::Node>* nodes = nullptr;
+};
+
+/// Scans preprocessed P4 text, skipping comments, string literals and line
+/// markers.
+struct UnitScanner {
+    int depth = 0;  ///< nesting of (), [] and {}
+    char last = 0;  ///< the last character of the last token
+    bool inComment = false;
+
+    /// Scans @text, adding its identifiers to @unit if not null.
+    void scan(const std::string& text, IncludeUnit* unit) {
+        static const std::unordered_set<std::string> keywords = {
+            "abstract", "action", "actions", "apply", "bool", "bit", "const", "control",
+            "default", "else", "entries", "enum", "error", "exit", "extern", "false",
+            "header", "header_union", "if", "in", "inout", "int", "key", "match_kind",
+            "type", "out", "parser", "package", "return", "select", "state",
+            "string", "struct", "switch", "table", "this", "transition", "true", "tuple",
+            "typedef", "varbit", "value_set", "void", "_" };
+        bool lineStart = true;
+        auto isIdChar = [](char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+        for (size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (inComment) {
+                if (c == '*' && i + 1 < text.size() && text[i + 1] == '/') {
+                    inComment = false;
+                    ++i; }
+            } else if (c == '\n') {
+                lineStart = true;
+                continue;
+            } else if (isspace(static_cast<unsigned char>(c))) {
+                continue;
+            } else if ((c == '#' && lineStart) ||
+                       (c == '/' && i + 1 < text.size() && text[i + 1] == '/')) {
+                auto end = text.find('\n', i);
+                if (end == std::string::npos) break;
+                i = end - 1;
+            } else if (c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+                inComment = true;
+                ++i;
+            } else if (c == '"') {
+                for (++i; i < text.size() && text[i] != '"'; ++i)
+                    if (text[i] == '\\') ++i;
+                last = c;
+            } else if (isIdChar(c) && !isdigit(static_cast<unsigned char>(c))) {
+                auto start = i;
+                while (i + 1 < text.size() && isIdChar(text[i + 1]))
+                    ++i;
+                last = text[i];
+                if (unit == nullptr) continue;
+                std::string id = text.substr(start, i + 1 - start);
+                if (keywords.count(id)) continue;
+                unit->identifiers.insert(id);
+                if (depth == 0)
+                    unit->topLevel.insert(id);
+            } else {
+                if (c == '(' || c == '[' || c == '{')
+                    ++depth;
+                else if (c == ')' || c == ']' || c == '}')
+                    --depth;
+                last = c;
+            }
+            lineStart = false;
+        }
+    }
+    /// True if the text scanned so far ends between two declarations.
+    bool atTopLevel() const {
+        return depth == 0 && !inComment && (last == 0 || last == ';' || last == '}');
+    }
+};
+
+/// Splits preprocessed input into units: the files included by the main
+/// file, and the runs of lines of the main file between them.  A unit that
+/// does not end between two top-level declarations (because it has an
+/// #include in the middle of a declaration, say) is merged with the next.
+std::vector<IncludeUnit> splitIncludeUnits(std::istream& in) {
+    std::vector<IncludeUnit> units(1);
+    UnitScanner scanner;
+    std::string line, text;
+    int nesting = 0;
+    auto addLines = [&]() {
+        scanner.scan(text, nullptr);
+        units.back().text += text;
+        text.clear();
+        if (scanner.atTopLevel() && !units.back().text.empty()) {
+            units.emplace_back();
+            scanner.last = 0; } };
+    while (std::getline(in, line)) {
+        int flag = lineMarkerFlag(line);
+        if ((flag == 1 && nesting++ == 0) || (flag == 2 && nesting > 0 && --nesting == 0))
+            addLines();
+        text += line;
+        text += '\n';
+    }
+    addLines();
+    if (units.back().text.empty())
+        units.pop_back();
+    return units;
+}
+
+/// Declarations parsed from runs of system include file lines, keyed by the
+/// earlier runs and the run itself, as earlier runs declare the type names the
+/// run needs.
+std::unordered_map<std::string, const IR::Vector<IR::Node>*>& includeRuns() {
+    static std::unordered_map<std::string, const IR::Vector<IR::Node>*> runs;
+    return runs;
+}
+
+}  // namespace
+
+/* static */ const IR::Vector<IR::Node>*
+P4ParserDriver::parseIncludeRun(const std::string& key, const std::string& text,
+                                const IR::Vector<IR::Node>& known) {
+    auto& runs = includeRuns();
+    auto it = runs.find(key);
+    if (it != runs.end()) return it->second;
+    // The run starts with a line marker, which provides the source location.
+    P4ParserDriver driver;
+    for (auto decl : known)
+        driver.structure->declareTopLevel(decl);
+    std::istringstream in(text);
+    P4Lexer lexer(in);
+    if (!driver.parseMore(lexer)) return nullptr;
+    runs.emplace(key, driver.nodes);
+    return driver.nodes;
+}
+
+void P4ParserDriver::splice(const std::string& text, const IR::Vector<IR::Node>& run) {
+    // Add the text to the sources as the lexer would, so that the positions of
+    // what follows are the same as if the run had been parsed here.
+    std::istringstream in(text);
+    std::string line, number, file;
+    while (std::getline(in, line)) {
+        sources->appendText(line.c_str());
+        if (isLineMarker(line, &number, &file)) {
+            onReadLineNumber(number.c_str());
+            onReadFileName(file.c_str());
+        }
+        sources->appendText("\n");
+    }
+    for (auto decl : run) {
+        structure->declareTopLevel(decl);
+        if (auto error = decl->to<IR::Type_Error>())
+            onReadErrorDeclaration(error->clone());  // the merged declaration changes
+        else
+            nodes->push_back(decl);
+    }
+}
+
+/* static */ const IR::P4Program*
+P4ParserDriver::parseWithIncludeCache(std::istream& in, const char* sourceFile,
+                                      unsigned sourceLine /* = 1 */) {
+    LOG1("Parsing P4-16 program " << sourceFile << " with the include cache");
+    P4ParserDriver driver;
+    driver.sources->mapLine(sourceFile, sourceLine);
+    // What the runs read so far mean to the next one: the text of the system
+    // runs, and the names the program's own runs declare and whether as types.
+    std::string prefix;
+    for (auto& run : splitIncludeRuns(in)) {
+        if (run.first) {
+            prefix += run.second;
+            auto decls = parseIncludeRun(prefix, run.second, *driver.nodes);
+            if (decls == nullptr) return nullptr;
+            driver.splice(run.second, *decls);
+        } else {
+            auto count = driver.nodes->size();
+            std::istringstream text(run.second);
+            P4Lexer lexer(text);
+            if (!driver.parseMore(lexer)) return nullptr;
+            for (auto i = count; i < driver.nodes->size(); ++i)
+                if (auto decl = driver.nodes->at(i)->to<IR::IDeclaration>())
+                    prefix += std::string("\n#declared ") + driver.nodes->at(i)->node_type_name()
+                            + " " + decl->getName().name.c_str();
+        }
+    }
+    return new IR::P4Program(driver.nodes->srcInfo, *driver.nodes);
+}
+
+/* static */ const IR::P4Program*
+P4ParserDriver::parseWithIncludeCache(FILE* in, const char* sourceFile,
+                                      unsigned sourceLine /* = 1 */) {
+    AutoStdioInputStream inputStream(in);
+    return parseWithIncludeCache(inputStream.get(), sourceFile, sourceLine);
+}
+
+/* static */ const IR::Vector<IR::Node>*
+P4ParserDriver::parseUnit(const std::string& text,
+                          const std::vector<const IR::Vector<IR::Node>*>& known,
+                          const char* sourceFile, unsigned sourceLine) {
+    P4ParserDriver driver;
+    driver.reportErrors = false;
+    if (sourceFile != nullptr)
+        driver.sources->mapLine(sourceFile, sourceLine);
+    for (auto decls : known)
+        for (auto decl : *decls)
+            driver.structure->declareTopLevel(decl);
+    std::istringstream in(text);
+    P4Lexer lexer(in);
+    if (!driver.parseMore(lexer)) return nullptr;
+    return driver.nodes;
+}
+
+/* static */ const IR::P4Program*
+P4ParserDriver::parseIncludeUnits(std::istream& in, const char* sourceFile,
+                                  unsigned sourceLine /* = 1 */) {
+    LOG1("Parsing P4-16 program " << sourceFile << " by include units");
+    auto units = splitIncludeUnits(in);
+    Util::parallelFor(units.size(), [&units](size_t i) {
+        UnitScanner().scan(units[i].text, &units[i]); });
+
+    // A unit appears to depend on the earlier units that have one of its
+    // identifiers outside brackets.
+    std::unordered_map<cstring, std::vector<size_t>> declaredBy;
+    std::vector<std::vector<size_t>> levels;
+    for (size_t i = 0; i < units.size(); ++i) {
+        auto& unit = units[i];
+        for (auto id : unit.identifiers) {
+            auto it = declaredBy.find(id);
+            if (it == declaredBy.end()) continue;
+            for (auto j : it->second)
+                unit.level = std::max(unit.level, units[j].level + 1); }
+        for (auto id : unit.topLevel)
+            declaredBy[id].push_back(i);
+        if (levels.size() <= unit.level)
+            levels.resize(unit.level + 1);
+        levels[unit.level].push_back(i);
+    }
+
+    // Parse the units of each level with the declarations of the earlier
+    // units of lower levels.
+    auto errors = ::errorCount();
+    for (auto& level : levels) {
+        Util::parallelFor(level.size(), [&](size_t k) {
+            auto i = level[k];
+            std::vector<const IR::Vector<IR::Node>*> known;
+            for (size_t j = 0; j < i; ++j)
+                if (units[j].level < units[i].level && units[j].nodes != nullptr)
+                    known.push_back(units[j].nodes);
+            units[i].nodes = parseUnit(units[i].text, known,
+                                       i == 0 ? sourceFile : nullptr, sourceLine);
+        });
+    }
+    // Errors other than syntax errors do not depend on what the units were
+    // parsed with.
+    if (::errorCount() > errors) return nullptr;
+    LOG2("Parsed " << units.size() << " units in " << levels.size() << " rounds");
+
+    // Add the units in order.  A unit is parsed again, after the units
+    // before it, if it failed or uses a declaration it was parsed without.
+    P4ParserDriver driver;
+    driver.sources->mapLine(sourceFile, sourceLine);
+    std::unordered_map<cstring, std::vector<size_t>> declarations;
+    std::vector<bool> reparsed(units.size());
+    for (size_t i = 0; i < units.size(); ++i) {
+        auto& unit = units[i];
+        bool valid = unit.nodes != nullptr;
+        for (auto it = unit.identifiers.begin(); valid && it != unit.identifiers.end(); ++it) {
+            auto decls = declarations.find(*it);
+            if (decls == declarations.end()) continue;
+            for (auto j : decls->second)
+                if (reparsed[j] || units[j].level >= unit.level || units[j].nodes == nullptr)
+                    valid = false; }
+        auto first = driver.nodes->size();
+        if (valid) {
+            driver.splice(unit.text, *unit.nodes);
+        } else {
+            LOG3("Parsing unit " << i << " again");
+            reparsed[i] = true;
+            std::istringstream text(unit.text);
+            P4Lexer lexer(text);
+            if (!driver.parseMore(lexer)) return nullptr;
+        }
+        for (auto j = first; j < driver.nodes->size(); ++j)
+            if (auto decl = driver.nodes->at(j)->to<IR::IDeclaration>())
+                declarations[decl->getName()].push_back(i);
+    }
+    return new IR::P4Program(driver.nodes->srcInfo, *driver.nodes);
+}
+
+/* static */ const IR::P4Program*
+P4ParserDriver::parseIncludeUnits(FILE* in, const char* sourceFile,
+                                  unsigned sourceLine /* = 1 */) {
+    AutoStdioInputStream inputStream(in);
+    return parseIncludeUnits(inputStream.get(), sourceFile, sourceLine);
+}
+
 template<typename T> const T*
 P4ParserDriver::parse(P4AnnotationLexer::Type type,
                       const Util::SourceInfo& srcInfo,
@@ -20,6 +20,7 @@ limitations under the License.
 #include <cstdio>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "frontends/p4/symbol_table.h"
 #include "frontends/parsers/p4/abstractP4Lexer.hpp"
@@ -84,6 +85,10 @@ class AbstractParserDriver {
     /// Scratch storage for the lexer to remember its previous state.
     int saveState = -1;
 
+    /// If false, syntax errors only make parsing fail, and are not reported;
+    /// used when the caller parses the input again if it fails.
+    bool reportErrors = true;
+
  private:
     /// The line number from the most recent #line directive.
     int lineDirectiveLine = 0;
@@ -116,6 +121,36 @@ class P4ParserDriver final : public AbstractParserDriver {
     static const IR::P4Program* parse(FILE* in, const char* sourceFile,
                                       unsigned sourceLine = 1);
 
+    /**
+     * Parse a preprocessed P4-16 program like parse(), but reuse the
+     * declarations that earlier calls in this process parsed from the same
+     * system include files (those under p4includePath).  The line markers in
+     * @in delimit the runs of lines coming from such files; each distinct run
+     * is parsed once, after the declarations of the runs before it, and its
+     * declarations are spliced into every program where it follows the same
+     * system runs and program declarations.
+     */
+    static const IR::P4Program* parseWithIncludeCache(std::istream& in,
+                                                      const char* sourceFile,
+                                                      unsigned sourceLine = 1);
+    static const IR::P4Program* parseWithIncludeCache(FILE* in, const char* sourceFile,
+                                                      unsigned sourceLine = 1);
+
+    /**
+     * Parse a preprocessed P4-16 program like parse(), but split it into
+     * units at the line markers that enter and leave the files included by
+     * the main file, and parse the units concurrently, on up to
+     * Util::parallelism() threads.  Each unit is parsed with the
+     * declarations of the earlier units whose names it mentions.  If it
+     * turns out to mention a declaration it was parsed without, it is
+     * parsed again once the units before it are done.  The declarations of
+     * the units are added to the program in order.
+     */
+    static const IR::P4Program* parseIncludeUnits(std::istream& in, const char* sourceFile,
+                                                  unsigned sourceLine = 1);
+    static const IR::P4Program* parseIncludeUnits(FILE* in, const char* sourceFile,
+                                                  unsigned sourceLine = 1);
+
     /**
      * Parses a P4-16 annotation body.
      *
@@ -224,6 +259,27 @@ class P4ParserDriver final : public AbstractParserDriver {
     bool parse(AbstractP4Lexer& lexer, const char* sourceFile,
                unsigned sourceLine = 1);
 
+    /// Parse more input, continuing the sources and declarations read so far.
+    bool parseMore(AbstractP4Lexer& lexer);
+
+    /// @returns the declarations parsed from the run of system include file
+    /// lines @text, after the declarations @known of the earlier runs, parsing
+    /// and caching them under @key if needed; null on errors.
+    static const IR::Vector<IR::Node>* parseIncludeRun(const std::string& key,
+                                                       const std::string& text,
+                                                       const IR::Vector<IR::Node>& known);
+
+    /// Add the declarations in @run, parsed from @text by another driver.
+    void splice(const std::string& text, const IR::Vector<IR::Node>& run);
+
+    /// @returns the declarations parsed from the unit @text, after those in
+    /// @known, or null if it cannot be parsed on its own.  Syntax errors are
+    /// not reported.  @sourceFile and @sourceLine give the initial source
+    /// location if not null.
+    static const IR::Vector<IR::Node>* parseUnit(
+        const std::string& text, const std::vector<const IR::Vector<IR::Node>*>& known,
+        const char* sourceFile, unsigned sourceLine);
+
     /// Common functionality for parsing annotation bodies.
     template<typename T> const T* parse(P4AnnotationLexer::Type type,
                                         const Util::SourceInfo& srcInfo,
@@ -0,0 +1,65 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IR_HASH_CONS_H_
+#define IR_HASH_CONS_H_
+
+#include <unordered_set>
+#include <utility>
+
+#include "node.h"
+
+namespace IR {
+
+/// A table of structurally unique IR nodes (hash-consing).  `get` returns the
+/// first node seen that is `equiv` to its argument, so programs with many
+/// repeated expressions (large keys, action arguments, types) can share a
+/// single copy of each, and equivalence tests between nodes obtained from the
+/// same table reduce to pointer comparison.
+///
+/// Hash-consing is optional: nodes that are `equiv` may still differ in their
+/// source position, which is lost for all but the first one.  So it should only
+/// be used for nodes created by the compiler itself, or where error messages do
+/// not need the exact position.  Nodes must not be modified once in the table.
+/// A HashCons is not thread-safe.
+class HashCons {
+    struct hash_t {
+        size_t operator()(const Node *n) const { return n->hash(); } };
+    struct equiv_t {
+        bool operator()(const Node *a, const Node *b) const { return a->equiv(*b); } };
+    std::unordered_set<const Node *, hash_t, equiv_t>   nodes;
+    size_t                                              hit_count = 0;
+
+ public:
+    /// @return the node in the table equiv to @n, adding @n if there is none.
+    template<class T> const T *get(const T *n) {
+        auto it = nodes.insert(n);
+        if (!it.second) ++hit_count;
+        // equiv nodes always have the same type
+        return static_cast<const T *>(*it.first); }
+    /// Create a T from @args, returning an existing equiv node if there is one.
+    template<class T, class... Args> const T *make(Args&&... args) {
+        return get(new T(std::forward<Args>(args)...)); }
+
+    size_t size() const { return nodes.size(); }
+    /// number of `get` calls that returned a node already in the table
+    size_t hits() const { return hit_count; }
+    void clear() { nodes.clear(); hit_count = 0; }
+};
+
+}  // namespace IR
+
+#endif /* IR_HASH_CONS_H_ */
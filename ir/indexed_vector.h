@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef IR_INDEXED_VECTOR_H_
 #define IR_INDEXED_VECTOR_H_
 
+#include <memory>
+#include <utility>
+#include <vector>
 
 #include "dbprint.h"
 #include "lib/enumerator.h"
@@ -31,13 +34,89 @@ class JSONLoader;
 
 namespace IR {
 
+/**
+ * The name index of an IndexedVector.  It is a hash table whose buckets are
+ * shared between copies: copying an index copies a single pointer, and
+ * the first modification of a copy duplicates the bucket table (an array of
+ * pointers), then only the bucket that is changed.  So cloning an
+ * IndexedVector in a Transform is cheap however many declarations it has,
+ * and changing one of them costs a small fraction of rebuilding the index.
+ */
+class DeclarationIndex {
+    typedef std::pair<cstring, const IDeclaration *> entry_t;
+    typedef std::vector<entry_t> bucket_t;
+    struct table_t {
+        std::vector<std::shared_ptr<bucket_t>>  buckets;
+        size_t                                  count = 0;
+    };
+    static constexpr size_t bucketSize = 8;  // average entries per bucket before growing
+    std::shared_ptr<table_t> table;
+
+    size_t bucket_of(cstring name) const {
+        // cstrings are interned, so their hash is the address, whose low bits
+        // carry little information; use the high bits of a Fibonacci hash
+        size_t h = std::hash<cstring>()(name) * 0x9E3779B97F4A7C15ULL;
+        size_t n = table->buckets.size();
+        return n == 1 ? 0 : h >> (8*sizeof(size_t) - __builtin_ctzl(n)); }
+    const entry_t *lookup(cstring name) const {
+        if (!table) return nullptr;
+        for (auto &e : *table->buckets[bucket_of(name)])
+            if (e.first == name) return &e;
+        return nullptr; }
+    /// Make the bucket holding @name private to this index, and return it.
+    bucket_t &writable(cstring name) {
+        if (!table) {
+            table = std::make_shared<table_t>();
+            table->buckets.push_back(std::make_shared<bucket_t>());
+        } else if (table.use_count() > 1) {
+            table = std::make_shared<table_t>(*table); }
+        auto &b = table->buckets[bucket_of(name)];
+        if (b.use_count() > 1)
+            b = std::make_shared<bucket_t>(*b);
+        return *b; }
+    void grow() {
+        auto old = std::move(table->buckets);
+        table->buckets.clear();
+        table->buckets.resize(old.size() * 2);
+        for (auto &b : table->buckets)
+            b = std::make_shared<bucket_t>();
+        for (auto &b : old)
+            for (auto &e : *b)
+                table->buckets[bucket_of(e.first)]->push_back(e); }
+
+ public:
+    const IDeclaration *find(cstring name) const {
+        auto *e = lookup(name);
+        return e ? e->second : nullptr; }
+    size_t size() const { return table ? table->count : 0; }
+    /// @return false (and leave the index unchanged) if @name is already present
+    bool insert(cstring name, const IDeclaration *decl) {
+        if (lookup(name)) return false;
+        writable(name).emplace_back(name, decl);
+        if (++table->count > bucketSize * table->buckets.size())
+            grow();
+        return true; }
+    /// @return false if @name is not present
+    bool erase(cstring name) {
+        if (!lookup(name)) return false;
+        auto &b = writable(name);
+        for (auto &e : b) {
+            if (e.first == name) {
+                e = b.back();
+                b.pop_back();
+                break; } }
+        --table->count;
+        return true; }
+    void clear() { table.reset(); }
+};
+
 /**
  * A Vector which holds objects which are instances of IDeclaration, and keeps
  * an index so that they can be quickly looked up by name.
  */
 template<class T>
 class IndexedVector : public Vector<T> {
-    ordered_map<cstring, const IDeclaration*> declarations;
+    DeclarationIndex declarations;
     bool invalid = false;  // set when an error occurs; then we don't
                            // expect the validity check to succeed.
 
@@ -46,13 +125,10 @@ class IndexedVector : public Vector<T> {
             return;
         auto decl = a->template to<IDeclaration>();
         auto name = decl->getName().name;
-        auto previous = declarations.find(name);
-        if (previous != declarations.end()) {
+        if (!declarations.insert(name, decl)) {
             invalid = true;
             ::error(ErrorType::ERR_DUPLICATE,
-                    "%1%: Duplicates declaration %2%", a, previous->second);
-        } else {
-            declarations[name] = decl; }}
+                    "%1%: Duplicates declaration %2%", a, declarations.find(name)); }}
     void removeFromMap(const T* a) {
         if (a == nullptr)
             return;
@@ -60,10 +136,11 @@ class IndexedVector : public Vector<T> {
         if (decl == nullptr)
             return;
         cstring name = decl->getName().name;
-        auto it = declarations.find(name);
-        if (it == declarations.end())
-            BUG("%1% does not exist", a);
-        declarations.erase(it); }
+        if (!declarations.erase(name))
+            BUG("%1% does not exist", a); }
+    /// true if @decl is the declaration indexed under its name (not a duplicate)
+    bool isIndexed(const IDeclaration *decl) const {
+        return decl && declarations.find(decl->getName().name) == decl; }
 
  public:
     using Vector<T>::begin;
@@ -91,19 +168,17 @@ class IndexedVector : public Vector<T> {
     typedef typename Vector<T>::iterator iterator;
 
     const IDeclaration* getDeclaration(cstring name) const {
-        auto it = declarations.find(name);
-        if (it == declarations.end())
-            return nullptr;
-        return it->second; }
+        return declarations.find(name); }
     template <class U>
     const U* getDeclaration(cstring name) const {
-        auto it = declarations.find(name);
-        if (it == declarations.end())
-            return nullptr;
-        return it->second->template to<U>(); }
+        auto decl = declarations.find(name);
+        return decl ? decl->template to<U>() : nullptr; }
+    /// The declarations in the vector, in order; duplicates are skipped.
     Util::Enumerator<const IDeclaration*>* getDeclarations() const {
-        return Util::Enumerator<const IDeclaration*>::createEnumerator(
-            Values(declarations).begin(), Values(declarations).end()); }
+        return Util::Enumerator<const T*>::createEnumerator(begin(), end())
+            ->template map<const IDeclaration*>([](const T *el) {
+                return el ? el->template to<IDeclaration>() : nullptr; })
+            ->where([this](const IDeclaration *decl) { return isIndexed(decl); }); }
     iterator erase(iterator i) {
         removeFromMap(*i);
         return Vector<T>::erase(i); }
@@ -184,8 +259,8 @@ class IndexedVector : public Vector<T> {
         for (auto el : *this) {
             auto decl = el->template to<IR::IDeclaration>();
             if (!decl) continue;
-            auto it = declarations.find(decl->getName());
-            BUG_CHECK(it != declarations.end() && it->second->getNode() == el->getNode(),
+            auto found = declarations.find(decl->getName());
+            BUG_CHECK(found && found->getNode() == el->getNode(),
                       "invalid element %1%", el); }
     }
 };
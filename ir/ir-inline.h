@@ -167,8 +167,10 @@ void IR::IndexedVector<T>::toJSON(JSONGenerator &json) const {
     const char *sep = "";
     Vector<T>::toJSON(json);
     json << "," << std::endl << json.indent++ << "\"declarations\" : {";
-    for (auto &k : declarations) {
-        json << sep << std::endl << json.indent << k.first << " : " << k.second;
+    for (auto el : *this) {
+        auto decl = el ? el->template to<IDeclaration>() : nullptr;
+        if (!isIndexed(decl)) continue;
+        json << sep << std::endl << json.indent << decl->getName().name << " : " << decl;
         sep = ","; }
     --json.indent;
     if (*sep) json << std::endl << json.indent;
@@ -32,8 +32,8 @@ const cstring IApply::applyMethodName = "apply";
 const cstring P4Program::main = "main";
 const cstring Type_Error::error = "error";
 
-int IR::Declaration::nextId = 0;
-int IR::This::nextId = 0;
+IR::IdCounter IR::Declaration::nextId(0);
+IR::IdCounter IR::This::nextId(0);
 
 const Type_Method* P4Control::getConstructorMethodType() const {
     return new Type_Method(getTypeParameters(), type, constructorParams, getName());
@@ -3,6 +3,9 @@
 #include <algorithm>
 #include <cmath>
 #include <map>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
 #include <ostream>
 #include <string>
 #include <tuple>
@@ -42,6 +45,10 @@ const Constant* getConstant(const Type* type, big_int v) {
     // Constants are interned. Keys in the intern map are pairs of types and values.
     using key_t = std::tuple<int, std::type_index, bool, big_int>;
     static std::map<key_t, const Constant*> constants;
+#ifdef MULTITHREAD
+    static std::mutex lock;
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
 
     auto*& result = constants[{tb->width_bits(), typeid(*type), tb->isSigned, v}];
     if (result == nullptr) {
@@ -54,6 +61,10 @@ const Constant* getConstant(const Type* type, big_int v) {
 const BoolLiteral* getBoolLiteral(bool value) {
     // Boolean literals are interned.
     static std::map<bool, const BoolLiteral*> literals;
+#ifdef MULTITHREAD
+    static std::mutex lock;
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
 
     auto*& result = literals[value];
     if (result == nullptr) {
@@ -304,7 +304,10 @@ IR::Vector<T>* IR::Vector<T>::fromJSON(JSONLoader &json) {
 }
 template<class T>
 IR::IndexedVector<T>::IndexedVector(JSONLoader &json) : Vector<T>(json) {
-    json.load("declarations", declarations);
+    ordered_map<cstring, const IDeclaration*> decls;
+    json.load("declarations", decls);
+    for (auto &d : decls)
+        declarations.insert(d.first, d.second);
 }
 template<class T>
 IR::IndexedVector<T>* IR::IndexedVector<T>::fromJSON(JSONLoader &json) {
@@ -124,6 +124,12 @@ class NameMap : public Node {
             if (el.first != it->first || !el.second->equiv(*(it++)->second))
                 return false;
         return true; }
+    size_t compute_hash() const override {
+        size_t h = Node::compute_hash();
+        for (auto &el : *this) {
+            h = Util::Hash::combine(h, std::hash<cstring>()(el.first));
+            h = Util::Hash::combine(h, el.second->hash()); }
+        return h; }
     cstring node_type_name() const override {
         return "NameMap<" + T::static_type_name() + ">"; }
     static cstring static_type_name() {
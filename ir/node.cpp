@@ -35,14 +35,14 @@ void IR::Node::traceCreation() const {
     LOG5("Created node " << id);
 }
 
-int IR::Node::currentId = 0;
+IR::IdCounter IR::Node::currentId(0);
 
 void IR::Node::toJSON(JSONGenerator &json) const {
     json << json.indent << "\"Node_ID\" : " << id << "," << std::endl
          << json.indent << "\"Node_Type\" : " << node_type_name();
 }
 
-IR::Node::Node(JSONLoader &json) : id(-1) {
+IR::Node::Node(JSONLoader &json) : id(-1), hash_cache(0) {
     json.load("Node_ID", id);
     if (id < 0)
         id = currentId++;
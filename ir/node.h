@@ -18,7 +18,12 @@ limitations under the License.
 #define _IR_NODE_H_
 
 #include <memory>
+#ifdef MULTITHREAD
+#include <atomic>
+#endif  // MULTITHREAD
+#include "lib/big_int_util.h"
 #include "lib/cstring.h"
+#include "lib/hash.h"
 #include "lib/stringify.h"
 #include "lib/indent.h"
 #include "lib/source_file.h"
@@ -40,6 +45,21 @@ namespace IR {
 class Node;
 class Annotation;
 
+/// Counter used to number IR objects as they are created; atomic when IR may
+/// be created on several threads at once.
+#ifdef MULTITHREAD
+typedef std::atomic<int> IdCounter;
+#else
+typedef int IdCounter;
+#endif  // MULTITHREAD
+
+/// Storage for the hash cached in each Node.
+#ifdef MULTITHREAD
+typedef std::atomic<size_t> HashCache;
+#else
+typedef size_t HashCache;
+#endif  // MULTITHREAD
+
 template<class T> class Vector;
 template<class T> class IndexedVector;
 // node interface
@@ -80,11 +100,16 @@ class Node : public virtual INode {
     virtual const Node *apply_visitor_postorder(Transform &v);
     virtual void apply_visitor_revisit(Transform &v, const Node *n) const;
     virtual void apply_visitor_loop_revisit(Transform &v) const;
-    Node &operator=(const Node &) = default;
-    Node &operator=(Node &&) = default;
+    Node &operator=(const Node &a) {
+        srcInfo = a.srcInfo;
+        id = a.id;
+        clone_id = a.clone_id;
+        hash_cache = 0;
+        return *this; }
+    Node &operator=(Node &&a) { return *this = a; }
 
  protected:
-    static int currentId;
+    static IdCounter currentId;
     void traceVisit(const char* visitor) const;
     virtual void visit_children(Visitor &) { }
     virtual void visit_children(Visitor &) const { }
@@ -92,6 +117,10 @@ class Node : public virtual INode {
     friend class ::Inspector;
     friend class ::Modifier;
     friend class ::Transform;
+    /// Deep structural hash, combining those of all fields that `equiv` compares.
+    /// Generated by the ir-generator for every IR class; hand-written classes whose
+    /// `equiv` looks at more than the type should override it too.
+    virtual size_t compute_hash() const { return typeid(*this).hash_code(); }
     cstring prepareSourceInfoForJSON(Util::SourceInfo& si,
                                      unsigned *lineNumber,
                                      unsigned *columnNumber) const;
@@ -100,11 +129,13 @@ class Node : public virtual INode {
     Util::SourceInfo    srcInfo;
     int id;  // unique id for each node
     int clone_id;  // unique id this node was cloned from (recursively)
+    static int nodesCreated() { return currentId; }  // ids handed out so far
     void traceCreation() const;
-    Node() : id(currentId++), clone_id(id) { traceCreation(); }
-    explicit Node(Util::SourceInfo si) : srcInfo(si), id(currentId++), clone_id(id) {
+    Node() : id(currentId++), clone_id(id), hash_cache(0) { traceCreation(); }
+    explicit Node(Util::SourceInfo si) : srcInfo(si), id(currentId++), clone_id(id), hash_cache(0) {
         traceCreation(); }
-    Node(const Node& other) : srcInfo(other.srcInfo), id(currentId++), clone_id(other.clone_id) {
+    Node(const Node& other) : srcInfo(other.srcInfo), id(currentId++), clone_id(other.clone_id),
+                              hash_cache(0) {
         traceCreation(); }
     virtual ~Node() {}
     const Node *apply(Visitor &v, const Visitor_Context *ctxt = nullptr) const;
@@ -130,14 +161,40 @@ class Node : public virtual INode {
     /* 'equiv' does a deep-equals comparison, comparing all non-pointer fields and recursing
      * though all Node subclass pointers to compare them with 'equiv' as well. */
     virtual bool equiv(const Node &a) const { return typeid(*this) == typeid(a); }
+    /* 'hash' is a deep structural hash consistent with 'equiv' -- nodes that are equiv
+     * have the same hash.  It is computed on first use and cached in the node, so it must
+     * only be used on nodes that will not be modified any further. */
+    size_t hash() const {
+        size_t h = hash_cache;
+        if (!h) {
+            h = compute_hash();
+            if (!h) h = 1;  // 0 means not computed yet
+            hash_cache = h; }
+        return h; }
 #define DEFINE_OPEQ_FUNC(CLASS, BASE) \
     virtual bool operator==(const CLASS &) const { return false; }
     IRNODE_ALL_SUBCLASSES(DEFINE_OPEQ_FUNC)
 #undef DEFINE_OPEQ_FUNC
 
     bool operator!=(const Node &n) const { return !operator==(n); }
+
+ private:
+    mutable HashCache hash_cache;
 };
 
+/// Hash of a non-IR field of a node, consistent with the field's operator==.
+/// Used by the generated compute_hash methods; types without a std::hash do
+/// not contribute to the hash.
+namespace Detail {
+template<class T> auto hash_field(const T &v, int) -> decltype(std::hash<T>()(v)) {
+    return std::hash<T>()(v); }
+template<class T> size_t hash_field(const T &, long) { return 0; }
+}  // namespace Detail
+template<class T> size_t hash_field(const T &v) { return Detail::hash_field(v, 0); }
+inline size_t hash_field(const big_int &v) {
+    // only the low bits; enough to tell constants apart
+    return Util::Hash::combine(v < 0, static_cast<uint64_t>(abs(v) & UINT64_MAX)); }
+
 // simple version of dbprint
 cstring dbp(const INode* node);
 
@@ -17,20 +17,29 @@ limitations under the License.
 #include "ir.h"
 #include "lib/gc.h"
 #include "lib/n4.h"
+#include "lib/parallel.h"
 
 #include "pass_manager.h"
+#include "pass_profile.h"
 
-void PassManager::removePasses(const std::vector<cstring> &exclude) {
-    for (auto it : exclude) {
-        bool excluded = false;
-        for (std::vector<Visitor *>::iterator it1 = passes.begin(); it1 != passes.end(); ++it1) {
-            if ((*it1)!= nullptr && it == (*it1)->name()) {
-                delete (*it1);
-                passes.erase(it1--);
+bool PassManager::removePass(cstring name) {
+    bool excluded = false;
+    for (std::vector<Visitor *>::iterator it1 = passes.begin(); it1 != passes.end(); ++it1) {
+        if ((*it1)!= nullptr && name == (*it1)->name()) {
+            delete (*it1);
+            passes.erase(it1--);
+            excluded = true;
+        } else if (auto *child = dynamic_cast<PassManager *>(*it1)) {
+            if (child->listsPassesInline() && child->removePass(name))
                 excluded = true;
-            }
         }
-        if (!excluded) {
+    }
+    return excluded;
+}
+
+void PassManager::removePasses(const std::vector<cstring> &exclude) {
+    for (auto it : exclude) {
+        if (!removePass(it)) {
             throw std::runtime_error("Trying to exclude unknown pass '" + it + "'");
         }
     }
@@ -40,13 +49,17 @@ void PassManager::listPasses(std::ostream &out, cstring sep) const {
     bool first = true;
     for (auto p : passes) {
         if (!first) out << sep;
-        out << p->name();
+        auto *child = dynamic_cast<const PassManager *>(p);
+        if (child && child->listsPassesInline())
+            child->listPasses(out, sep);
+        else
+            out << p->name();
         first = false; }
 }
 
 const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *) {
     safe_vector<std::pair<safe_vector<Visitor *>::iterator, const IR::Node *>> backup;
-    static indent_t log_indent(-1);
+    static thread_local indent_t log_indent(-1);
     struct indent_nesting {
         indent_t &indent;
         explicit indent_nesting(indent_t &i) : indent(i) { ++indent; }
@@ -56,6 +69,9 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
     early_exit_flag = false;
     unsigned initial_error_count = ::errorCount();
     BUG_CHECK(running, "not calling apply properly");
+    // no-op unless this manager is the outermost one (inner managers are
+    // profiled by the loop in the manager running them)
+    PassProfile::Scope self_profile(this);
     for (auto it = passes.begin(); it != passes.end();) {
         Visitor* v = *it;
         if (auto b = dynamic_cast<Backtrack *>(v)) {
@@ -64,7 +80,14 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
         try {
             try {
                 LOG1(log_indent << name() << " invoking " << v->name());
-                auto after = program->apply(**it);
+                const IR::Node *after;
+                {
+                    PassProfile::Scope profile(v);
+                    auto *local = dynamic_cast<DeclarationLocal *>(v);
+                    if (local && Util::parallelism() > 1 && program->is<IR::P4Program>())
+                        after = local->apply_parallel(program->to<IR::P4Program>());
+                    else
+                        after = program->apply(**it); }
                 if (LOGGING(3)) {
                     size_t maxmem, mem = gc_mem_inuse(&maxmem);  // triggers gc
                     LOG3(log_indent << "heap after " << v->name() << ": in use " <<
@@ -34,6 +34,11 @@ class PassManager : virtual public Visitor, virtual public Backtrack {
     bool                running = false;
     unsigned            seqNo = 0;
     void runDebugHooks(const char* visitorName, const IR::Node* node);
+    /// True if the passes of this manager are listed and excluded by the
+    /// listPasses and removePasses of an enclosing manager as its own.
+    virtual bool listsPassesInline() const { return false; }
+    /// Removes the passes named @name; @returns false if there are none.
+    virtual bool removePass(cstring name);
     profile_t init_apply(const IR::Node *root) override {
         running = true;
         return Visitor::init_apply(root); }
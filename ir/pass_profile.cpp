@@ -0,0 +1,183 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <time.h>
+#include <algorithm>
+#include <iostream>
+#include "ir.h"
+#include "visitor.h"
+#include "lib/gc.h"
+#include "lib/json.h"
+#include "lib/n4.h"
+#include "lib/nullstream.h"
+#include "lib/parallel.h"
+
+#include "pass_profile.h"
+
+bool PassProfile::is_enabled = false;
+bool PassProfile::gc_report = false;
+cstring PassProfile::output_file;
+ordered_map<cstring, PassProfile::Record> PassProfile::all_records;
+std::vector<const Visitor *> PassProfile::active_passes;
+thread_local uint64_t PassProfile::nodes_visited = 0;
+thread_local uint64_t PassProfile::nodes_changed = 0;
+
+void PassProfile::enable(cstring file) {
+    is_enabled = true;
+    output_file = file;
+}
+
+void PassProfile::enableGCStats() {
+    is_enabled = true;
+    gc_report = true;
+    gc_track_pauses();
+}
+
+void PassProfile::reset() {
+    all_records.clear();
+}
+
+std::deque<std::pair<cstring, PassProfile::counter_t>> &PassProfile::named_counters() {
+    // deque so that references handed out by `counter` stay valid as it grows
+    static std::deque<std::pair<cstring, counter_t>> counters;
+    return counters;
+}
+
+PassProfile::counter_t &PassProfile::counter(cstring name) {
+#ifdef MULTITHREAD
+    static std::mutex lock;
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    for (auto &c : named_counters())
+        if (c.first == name) return c.second;
+    named_counters().emplace_back(name, 0);
+    return named_counters().back().second;
+}
+
+static uint64_t clock_nsec(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec*1000000000UL + ts.tv_nsec;
+}
+
+PassProfile::Scope::sample_t PassProfile::Scope::sample() {
+    sample_t rv;
+    rv.wall = clock_nsec(CLOCK_MONOTONIC);
+    rv.cpu = clock_nsec(CLOCK_PROCESS_CPUTIME_ID);
+    rv.heap = gc_heap_size();
+    rv.allocated = gc_total_bytes();
+    rv.nodes = IR::Node::nodesCreated();
+    rv.visited = nodes_visited;
+    rv.changed = nodes_changed;
+    gc_get_statistics(rv.gc);
+    for (auto &c : named_counters())
+        rv.counters.push_back(c.second);
+    return rv;
+}
+
+PassProfile::Scope::Scope(const Visitor *pass)
+: active(PassProfile::enabled() && !Util::inParallelFor() &&
+         (active_passes.empty() || active_passes.back() != pass)) {
+    if (!active) return;
+    active_passes.push_back(pass);
+    std::string p;
+    for (auto *v : active_passes) {
+        if (!p.empty()) p += "/";
+        p += v->name(); }
+    path = p;
+    start = sample();
+    // the peak seen by an enclosing pass includes the peak of this one
+    outer_peak_heap = start.gc.peak_heap;
+    gc_reset_peak_heap();
+}
+
+PassProfile::Scope::~Scope() {
+    if (!active) return;
+    auto end = sample();
+    auto &rec = all_records[path];
+    rec.name = path;
+    rec.invocations++;
+    rec.wall_nsec += end.wall - start.wall;
+    rec.cpu_nsec += end.cpu - start.cpu;
+    rec.heap_growth += int64_t(end.heap) - int64_t(start.heap);
+    rec.bytes_allocated += end.allocated - start.allocated;
+    rec.nodes_created += end.nodes - start.nodes;
+    rec.nodes_visited += end.visited - start.visited;
+    rec.nodes_changed += end.changed - start.changed;
+    rec.gc_collections += end.gc.collections - start.gc.collections;
+    rec.gc_pause_nsec += end.gc.pause_nsec - start.gc.pause_nsec;
+    rec.gc_bytes_reclaimed += end.gc.bytes_reclaimed - start.gc.bytes_reclaimed;
+    rec.peak_heap = std::max(rec.peak_heap, end.gc.peak_heap);
+    if (end.gc.peak_heap < outer_peak_heap)
+        gc_reset_peak_heap(outer_peak_heap);
+    // counters registered while the pass ran started from zero
+    auto &counters = named_counters();
+    for (size_t i = 0; i < end.counters.size(); ++i) {
+        uint64_t delta = end.counters[i] - (i < start.counters.size() ? start.counters[i] : 0);
+        if (delta) rec.counters[counters[i].first] += delta; }
+    active_passes.pop_back();
+    if (active_passes.empty() && output_file) {
+        if (auto *out = openFile(output_file, false)) {
+            write(*out);
+            delete out; } }
+    if (active_passes.empty() && gc_report)
+        writeGCStats(std::cerr);
+}
+
+void PassProfile::write(std::ostream &out) {
+    auto *passes = new Util::JsonArray();
+    for (auto &r : all_records) {
+        auto &rec = r.second;
+        auto *pass = new Util::JsonObject();
+        pass->emplace("name", rec.name);
+        pass->emplace("invocations", rec.invocations);
+        pass->emplace("wall_usec", rec.wall_nsec / 1000.0);
+        pass->emplace("cpu_usec", rec.cpu_nsec / 1000.0);
+        pass->emplace("heap_growth", static_cast<long long>(rec.heap_growth));
+        pass->emplace("bytes_allocated", static_cast<unsigned long long>(rec.bytes_allocated));
+        pass->emplace("nodes_created", static_cast<unsigned long long>(rec.nodes_created));
+        pass->emplace("nodes_visited", static_cast<unsigned long long>(rec.nodes_visited));
+        pass->emplace("nodes_changed", static_cast<unsigned long long>(rec.nodes_changed));
+        pass->emplace("gc_collections", static_cast<unsigned long long>(rec.gc_collections));
+        pass->emplace("gc_pause_usec", rec.gc_pause_nsec / 1000.0);
+        pass->emplace("gc_bytes_reclaimed",
+                      static_cast<unsigned long long>(rec.gc_bytes_reclaimed));
+        pass->emplace("peak_heap", static_cast<unsigned long long>(rec.peak_heap));
+        if (!rec.counters.empty()) {
+            auto *counters = new Util::JsonObject();
+            for (auto &c : rec.counters)
+                counters->emplace(c.first, static_cast<unsigned long long>(c.second));
+            pass->emplace("counters", counters); }
+        passes->append(pass); }
+    auto *report = new Util::JsonObject();
+    report->emplace("passes", passes);
+    report->serialize(out);
+    out << std::endl;
+}
+
+void PassProfile::writeGCStats(std::ostream &out) {
+    gc_statistics total;
+    gc_get_statistics(total);
+    out << "GC: " << total.collections << " collections, " << total.pause_nsec / 1000000.0
+        << " msec paused, " << n4(total.bytes_reclaimed) << " reclaimed, peak heap "
+        << n4(total.peak_heap) << std::endl;
+    for (auto &r : all_records) {
+        auto &rec = r.second;
+        if (!rec.gc_collections) continue;
+        out << "  " << rec.name << ": " << rec.gc_collections << " collections, "
+            << rec.gc_pause_nsec / 1000000.0 << " msec, " << n4(rec.gc_bytes_reclaimed)
+            << " reclaimed, peak heap " << n4(rec.peak_heap) << std::endl; }
+}
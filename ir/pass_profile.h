@@ -0,0 +1,132 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IR_PASS_PROFILE_H_
+#define IR_PASS_PROFILE_H_
+
+#include <cstdint>
+#include <deque>
+#ifdef MULTITHREAD
+#include <atomic>
+#endif  // MULTITHREAD
+#include <iosfwd>
+#include <map>
+#include <vector>
+
+#include "lib/cstring.h"
+#include "lib/gc.h"
+#include "lib/ordered_map.h"
+
+class Visitor;
+
+/// Per-pass compile-time profile, enabled with --pass-profile.
+///
+/// Every pass run by a PassManager is measured (wall and CPU time, GC heap
+/// growth, bytes allocated, IR nodes created, visited and changed) and the
+/// measurements are aggregated per pass path, so passes run repeatedly by a
+/// PassRepeated accumulate into a single record.  The report is written as
+/// JSON each time the outermost PassManager finishes.
+class PassProfile {
+ public:
+    struct Record {
+        cstring                         name;
+        unsigned                        invocations = 0;
+        uint64_t                        wall_nsec = 0;
+        uint64_t                        cpu_nsec = 0;
+        int64_t                         heap_growth = 0;
+        uint64_t                        bytes_allocated = 0;
+        uint64_t                        nodes_created = 0;
+        uint64_t                        nodes_visited = 0;
+        uint64_t                        nodes_changed = 0;
+        /// collector activity while the pass ran (see --gc-stats)
+        uint64_t                        gc_collections = 0;
+        uint64_t                        gc_pause_nsec = 0;
+        uint64_t                        gc_bytes_reclaimed = 0;
+        size_t                          peak_heap = 0;
+        /// deltas of the named counters (see `counter`) that changed in this pass
+        std::map<cstring, uint64_t>     counters;
+    };
+
+    /// Start collecting a profile; if @file is not null the report is written there.
+    static void enable(cstring file);
+    /// Start collecting a profile, and print a summary of the collector's
+    /// activity in each pass to stderr when the outermost PassManager finishes.
+    static void enableGCStats();
+    static bool enabled() { return is_enabled; }
+    /// Discard all collected records (but keep the profile enabled).
+    static void reset();
+    static const ordered_map<cstring, Record> &records() { return all_records; }
+    /// Write the report to @out as JSON.
+    static void write(std::ostream &out);
+    /// Write the GC summary (passes during which the heap was collected) to @out.
+    static void writeGCStats(std::ostream &out);
+
+    /// Nodes visited / changed by any Inspector, Modifier or Transform.
+    /// Maintained by the visitors themselves, sampled around each pass.  Kept
+    /// per thread; work done on worker threads (see DeclarationLocal) is
+    /// credited back to the thread running the pass.
+    static thread_local uint64_t nodes_visited, nodes_changed;
+
+#ifdef MULTITHREAD
+    typedef std::atomic<uint64_t> counter_t;
+#else
+    typedef uint64_t counter_t;
+#endif  // MULTITHREAD
+
+    /// @return a named counter that analyses can bump to report their own
+    /// statistics (cache hits, dataflow iterations, ...).  The returned reference
+    /// stays valid for the lifetime of the program, so callers usually keep it
+    /// in a function-level static.  Counters are always maintained; they are only
+    /// reported when the profile is enabled.  They are atomic in multithreaded
+    /// builds, as the passes bumping them may run on worker threads.
+    static counter_t &counter(cstring name);
+
+    /// Measures one run of a pass; created by PassManager around each pass it
+    /// runs.  Does nothing when the profile is not enabled, when @pass is
+    /// already being measured by an enclosing Scope, or on a thread running a
+    /// call of Util::parallelFor: such passes are measured as part of the pass
+    /// that started the loop.
+    class Scope {
+        struct sample_t {
+            uint64_t                    wall, cpu;
+            size_t                      heap, allocated;
+            uint64_t                    nodes, visited, changed;
+            gc_statistics               gc;
+            std::vector<uint64_t>       counters;
+        };
+        bool            active;
+        cstring         path;
+        sample_t        start;
+        size_t          outer_peak_heap;
+        static sample_t sample();
+
+     public:
+        explicit Scope(const Visitor *pass);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+ private:
+    static bool                                 is_enabled;
+    static bool                                 gc_report;
+    static cstring                              output_file;
+    static ordered_map<cstring, Record>         all_records;
+    static std::vector<const Visitor *>         active_passes;
+    static std::deque<std::pair<cstring, counter_t>> &named_counters();
+};
+
+#endif /* IR_PASS_PROFILE_H_ */
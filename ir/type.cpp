@@ -15,6 +15,9 @@ limitations under the License.
 */
 
 #include <utility>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
 #include "ir.h"
 #include "frontends/common/options.h"
 
@@ -54,8 +57,8 @@ const cstring IR::Annotation::noWarnAnnotation = "noWarn";
 const cstring IR::Annotation::matchAnnotation = "match";
 const cstring IR::Annotation::fieldListAnnotation = "field_list";
 
-int Type_Declaration::nextId = 0;
-int Type_InfInt::nextId = 0;
+IdCounter Type_Declaration::nextId(0);
+IdCounter Type_InfInt::nextId(0);
 
 Annotations* Annotations::empty = new Annotations(Vector<Annotation>());
 
@@ -65,11 +68,18 @@ const Type_Bits* Type_Bits::get(int width, bool isSigned) {
     // map (width, signed) to type
     using bit_type_key = std::pair<int, bool>;
     static std::map<bit_type_key, const IR::Type_Bits*> *type_map = nullptr;
+#ifdef MULTITHREAD
+    static std::mutex lock;
+    std::unique_lock<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
     if (type_map == nullptr)
         type_map = new std::map<bit_type_key, const IR::Type_Bits*>();
     auto &result = (*type_map)[std::make_pair(width, isSigned)];
     if (!result)
         result = new Type_Bits(width, isSigned);
+#ifdef MULTITHREAD
+    acquire.unlock();
+#endif  // MULTITHREAD
     if (width > P4CContext::getConfig().maximumWidthSupported())
         ::error(ErrorType::ERR_UNSUPPORTED, "%1%: Compiler only supports widths up to %2%",
                 result, P4CContext::getConfig().maximumWidthSupported());
@@ -77,23 +87,17 @@ const Type_Bits* Type_Bits::get(int width, bool isSigned) {
 }
 
 const Type::Unknown *Type::Unknown::get() {
-    static const Type::Unknown *singleton = nullptr;
-    if (!singleton)
-        singleton = (new Type::Unknown());
+    static const Type::Unknown *singleton = new Type::Unknown();
     return singleton;
 }
 
 const Type::Boolean *Type::Boolean::get() {
-    static const Type::Boolean *singleton = nullptr;
-    if (!singleton)
-        singleton = (new Type::Boolean());
+    static const Type::Boolean *singleton = new Type::Boolean();
     return singleton;
 }
 
 const Type_String *Type_String::get() {
-    static const Type_String *singleton = nullptr;
-    if (!singleton)
-        singleton = (new Type_String());
+    static const Type_String *singleton = new Type_String();
     return singleton;
 }
 
@@ -127,30 +131,22 @@ const Type::Varbits *Type::Varbits::get() {
 }
 
 const Type_Dontcare *Type_Dontcare::get() {
-    static const Type_Dontcare *singleton;
-    if (!singleton)
-        singleton = (new Type_Dontcare());
+    static const Type_Dontcare *singleton = new Type_Dontcare();
     return singleton;
 }
 
 const Type_State *Type_State::get() {
-    static const Type_State *singleton;
-    if (!singleton)
-        singleton = (new Type_State());
+    static const Type_State *singleton = new Type_State();
     return singleton;
 }
 
 const Type_Void *Type_Void::get() {
-    static const Type_Void *singleton;
-    if (!singleton)
-        singleton = (new Type_Void());
+    static const Type_Void *singleton = new Type_Void();
     return singleton;
 }
 
 const Type_MatchKind *Type_MatchKind::get() {
-    static const Type_MatchKind *singleton;
-    if (!singleton)
-        singleton = (new Type_MatchKind());
+    static const Type_MatchKind *singleton = new Type_MatchKind();
     return singleton;
 }
 
@@ -176,6 +176,10 @@ class Vector : public VectorBase {
         auto it = a.begin();
         for (auto *el : *this) if (!el->equiv(**it++)) return false;
         return true; }
+    size_t compute_hash() const override {
+        size_t h = Node::compute_hash();
+        for (auto *el : *this) h = Util::Hash::combine(h, el ? el->hash() : 0);
+        return h; }
     cstring node_type_name() const override {
         return "Vector<" + T::static_type_name() + ">"; }
     static cstring static_type_name() {
@@ -16,9 +16,17 @@ limitations under the License.
 
 
 #include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
 #include "ir.h"
 #include "lib/log.h"
+#include "lib/parallel.h"
 
+#include "pass_profile.h"
 #include "visitor.h"
 
 /** @class Visitor::ChangeTracker
@@ -28,6 +36,13 @@ limitations under the License.
  *  node.  The `start` method begins tracking, and `finish` ends it.  The
  *  `done` method determines whether the node has been visited, and `result`
  *  returns the new IR if it changed.
+ *
+ *  Nodes are tracked in a flat open-addressed table keyed on the node pointer,
+ *  pointing into an arena of visit_info_t that never moves, so pointers handed
+ *  out by `refVisitOnce` stay valid as the table grows.  Table slots are stamped
+ *  with a generation, so forgetting every node (`revisit_visited`) is a bump of
+ *  the generation rather than an erase of each entry.  Trackers are recycled
+ *  (see `acquire`), so successive passes reuse the same storage.
  */
 class Visitor::ChangeTracker {
     struct visit_info_t {
@@ -35,24 +50,127 @@ class Visitor::ChangeTracker {
         bool            visitOnce;
         const IR::Node  *result;
     };
-    typedef std::unordered_map<const IR::Node *, visit_info_t>  visited_t;
-    visited_t           visited;
+    struct slot_t {
+        const IR::Node  *node;
+        unsigned        generation;     // slot is empty unless this is the current one
+        unsigned        info;           // index into the arena
+    };
+    std::vector<slot_t> slots;          // power of 2 size, linear probing
+    unsigned            shift;          // 64 - log2(slots.size())
+    unsigned            generation = 1;
+    size_t              entries = 0;    // slots in use in the current generation
+
+    static constexpr unsigned chunk_size = 1024;
+    std::vector<std::unique_ptr<visit_info_t[]>>        chunks;
+    unsigned                                            allocated = 0;
+    /// Nodes started and not yet finished, which survive `revisit_visited`.
+    std::vector<std::pair<const IR::Node *, unsigned>>  in_progress;
+
+    static constexpr unsigned initial_size = 256;
+    static constexpr size_t max_pooled = 16;
+    static std::vector<ChangeTracker *> *pool;
+#ifdef MULTITHREAD
+    static std::mutex pool_lock;
+#endif  // MULTITHREAD
+
+    visit_info_t &info(unsigned idx) const { return chunks[idx / chunk_size][idx % chunk_size]; }
+    size_t bucket(const IR::Node *n) const {
+        // Fibonacci hashing: the low bits of node pointers are always 0
+        return (uint64_t(reinterpret_cast<uintptr_t>(n)) * UINT64_C(0x9e3779b97f4a7c15)) >> shift; }
+    size_t mask() const { return slots.size() - 1; }
+
+    visit_info_t *find(const IR::Node *n) const {
+        for (size_t i = bucket(n); slots[i].generation == generation; i = (i + 1) & mask())
+            if (slots[i].node == n)
+                return &info(slots[i].info);
+        return nullptr; }
+    /// Add @n, known not to be in the table, referring to arena entry @idx.
+    void place(const IR::Node *n, unsigned idx) {
+        size_t i = bucket(n);
+        while (slots[i].generation == generation)
+            i = (i + 1) & mask();
+        slots[i] = slot_t{n, generation, idx};
+        ++entries; }
+    void resize(size_t size) {
+        std::vector<slot_t> old(size, slot_t{nullptr, 0, 0});
+        old.swap(slots);
+        shift = 64 - __builtin_ctzll(size);
+        entries = 0;
+        for (auto &s : old)
+            if (s.generation == generation)
+                place(s.node, s.info); }
+    std::pair<visit_info_t *, bool> emplace(const IR::Node *n, const visit_info_t &vi) {
+        if (auto *rv = find(n))
+            return std::make_pair(rv, false);
+        if (2 * (entries + 1) > slots.size())
+            resize(2 * slots.size());
+        if (allocated == chunks.size() * chunk_size)
+            chunks.emplace_back(new visit_info_t[chunk_size]);
+        unsigned idx = allocated++;
+        info(idx) = vi;
+        place(n, idx);
+        if (vi.visit_in_progress)
+            in_progress.emplace_back(n, idx);
+        return std::make_pair(&info(idx), true); }
+
+    ChangeTracker() { resize(initial_size); }
+    /// Forget everything, and drop all references to IR nodes so that a pooled
+    /// tracker does not keep them from being collected.  Storage grown by a
+    /// big traversal is freed, so that later small ones do not pay for it.
+    void clear() {
+        generation = 1;
+        entries = 0;
+        if (slots.size() > initial_size) {
+            std::vector<slot_t>(initial_size, slot_t{nullptr, 0, 0}).swap(slots);
+            shift = 64 - __builtin_ctzll(initial_size);
+        } else {
+            std::fill(slots.begin(), slots.end(), slot_t{nullptr, 0, 0}); }
+        if (chunks.size() > 1)
+            chunks.resize(1);
+        for (unsigned i = 0; i < std::min(allocated, chunk_size); ++i)
+            info(i).result = nullptr;
+        allocated = 0;
+        in_progress.clear(); }
+    static void release(ChangeTracker *t) {
+        t->clear();
+        {
+#ifdef MULTITHREAD
+            std::lock_guard<std::mutex> guard(pool_lock);
+#endif  // MULTITHREAD
+            if (pool->size() < max_pooled) {
+                pool->push_back(t);
+                return; }
+        }
+        delete t; }
 
  public:
+    /// @return an empty tracker, reusing the storage of one no longer in use if any.
+    static std::shared_ptr<ChangeTracker> acquire() {
+        ChangeTracker *t = nullptr;
+        {
+#ifdef MULTITHREAD
+            std::lock_guard<std::mutex> guard(pool_lock);
+#endif  // MULTITHREAD
+            if (!pool->empty()) {
+                t = pool->back();
+                pool->pop_back(); }
+        }
+        if (!t) t = new ChangeTracker;
+        return std::shared_ptr<ChangeTracker>(t, release); }
+
     /** Begin tracking @n during a visiting pass.  Use `finish(@n)` to mark @n as
      * visited once the pass completes.
      */
     void start(const IR::Node *n, bool defaultVisitOnce) {
         // Initialization
-        visited_t::iterator visited_it;
+        visit_info_t *visit_info;
         bool inserted;
         bool visit_in_progress = true;
-        std::tie(visited_it, inserted) =
-            visited.emplace(n, visit_info_t{visit_in_progress, defaultVisitOnce, n});
+        std::tie(visit_info, inserted) =
+            emplace(n, visit_info_t{visit_in_progress, defaultVisitOnce, n});
 
         // Sanity check for IR loops
         bool already_present = !inserted;
-        visit_info_t *visit_info = &(visited_it->second);
         if (already_present && visit_info->visit_in_progress)
             BUG("IR loop detected ");
     }
@@ -71,20 +189,27 @@ class Visitor::ChangeTracker {
      * previously been invoked.
      */
     bool finish(const IR::Node *orig, const IR::Node *final) {
-        auto it = visited.find(orig);
-        if (it == visited.end())
+        visit_info_t *orig_visit_info = find(orig);
+        if (!orig_visit_info)
             BUG("visitor state tracker corrupted");
 
-        visit_info_t *orig_visit_info = &(it->second);
+        if (orig_visit_info->visit_in_progress) {
+            // almost always the innermost node in progress
+            for (auto it = in_progress.rbegin(); it != in_progress.rend(); ++it) {
+                if (it->first == orig) {
+                    in_progress.erase(std::next(it).base());
+                    break; } } }
         orig_visit_info->visit_in_progress = false;
         if (!final) {
             orig_visit_info->result = final;
+            ++PassProfile::nodes_changed;
             return true;
         } else if (final != orig && *final != *orig) {
             orig_visit_info->result = final;
-            visited.emplace(final, visit_info_t{false, orig_visit_info->visitOnce, final});
+            emplace(final, visit_info_t{false, orig_visit_info->visitOnce, final});
+            ++PassProfile::nodes_changed;
             return true;
-        } else if (visited.count(final)) {
+        } else if (find(final)) {
             // coalescing with some previously visited node, so we don't want to undo
             // the coalesce
             orig_visit_info->result = final;
@@ -98,19 +223,22 @@ class Visitor::ChangeTracker {
     /** Return a pointer to the visitOnce flag for node @n so that it can be changed
      */
     bool *refVisitOnce(const IR::Node *n) {
-        if (!visited.count(n))
+        auto *visit_info = find(n);
+        if (!visit_info)
             BUG("visitor state tracker corrupted");
-        return &visited.at(n).visitOnce;
+        return &visit_info->visitOnce;
     }
 
     /** Forget nodes that have already been visited, allowing them to be visited
      * again. */
     void revisit_visited() {
-        for (auto it = visited.begin(); it != visited.end();) {
-            if (!it->second.visit_in_progress)
-                it = visited.erase(it);
-            else
-                ++it; } }
+        if (++generation == 0) {
+            // wrapped around; really empty the table
+            std::fill(slots.begin(), slots.end(), slot_t{nullptr, 0, 0});
+            generation = 1; }
+        entries = 0;
+        for (auto &p : in_progress)
+            place(p.first, p.second); }
 
     /** Determine whether @n is currently being visited and the visitor has not finished
      * That is, `start(@n)` has been invoked, and `finish(@n)` has not,
@@ -118,8 +246,8 @@ class Visitor::ChangeTracker {
      * @return true if @n is being visited and has not finished
      */
     bool busy(const IR::Node *n) const {
-        auto it = visited.find(n);
-        return it != visited.end() && it->second.visit_in_progress; }
+        auto *visit_info = find(n);
+        return visit_info && visit_info->visit_in_progress; }
 
     /** Determine whether @n has been visited and the visitor has finished
      *  and we don't want to visit @n again the next time we see it.
@@ -129,8 +257,8 @@ class Visitor::ChangeTracker {
      * @return true if @n has been visited and the visitor is finished and visitOnce is true
      */
     bool done(const IR::Node *n) const {
-        auto it = visited.find(n);
-        return it != visited.end() && !it->second.visit_in_progress && it->second.visitOnce;
+        auto *visit_info = find(n);
+        return visit_info && !visit_info->visit_in_progress && visit_info->visitOnce;
     }
 
     /** Produce the result of visiting @n.
@@ -140,12 +268,18 @@ class Visitor::ChangeTracker {
      * if `start(@n)` has not been invoked.
      */
     const IR::Node *result(const IR::Node *n) const {
-        if (!visited.count(n))
-            return n;
-        return visited.at(n).result;
+        auto *visit_info = find(n);
+        return visit_info ? visit_info->result : n;
     }
 };
 
+// never destroyed, as visitors may outlive static destructors
+std::vector<Visitor::ChangeTracker *> *Visitor::ChangeTracker::pool =
+    new std::vector<Visitor::ChangeTracker *>;
+#ifdef MULTITHREAD
+std::mutex Visitor::ChangeTracker::pool_lock;
+#endif  // MULTITHREAD
+
 // static
 bool Visitor::warning_enabled(const Visitor* visitor, int warning_kind) {
     auto errorString = ErrorCatalog::getCatalog().getName(warning_kind);
@@ -170,6 +304,8 @@ bool Visitor::warning_enabled(const Visitor* visitor, int warning_kind) {
 
 Visitor::profile_t Visitor::init_apply(const IR::Node *root) {
     ctxt = nullptr;
+    if (apply_depth.n++ == 0)
+        scratch_arena.reset();
     if (joinFlows) init_join_flows(root);
     return profile_t(*this);
 }
@@ -180,20 +316,25 @@ Visitor::profile_t Visitor::init_apply(const IR::Node *root, const Context *pare
 }
 Visitor::profile_t Modifier::init_apply(const IR::Node *root) {
     auto rv = Visitor::init_apply(root);
-    visited = std::make_shared<ChangeTracker>();
+    visited = ChangeTracker::acquire();
     return rv; }
 Visitor::profile_t Inspector::init_apply(const IR::Node *root) {
     auto rv = Visitor::init_apply(root);
-    visited = std::make_shared<visited_t>();
+    // the table keeps the arena alive, as it may outlive the apply when
+    // applied with a context
+    auto *table = new visited_t(0, visited_t::hasher(), visited_t::key_equal(),
+                                visited_t::allocator_type(scratch()));
+    visited = std::shared_ptr<visited_t>(table, [arena = scratch_arena](visited_t *t) {
+        delete t; });
     return rv; }
 Visitor::profile_t Transform::init_apply(const IR::Node *root) {
     auto rv = Visitor::init_apply(root);
-    visited = std::make_shared<ChangeTracker>();
+    visited = ChangeTracker::acquire();
     return rv; }
 void Visitor::end_apply() {}
 void Visitor::end_apply(const IR::Node*) {}
 
-static indent_t profile_indent;
+static thread_local indent_t profile_indent;
 static uint64_t first_start = 0;
 Visitor::profile_t::profile_t(Visitor &v_) : v(v_) {
     struct timespec ts;
@@ -215,6 +356,8 @@ Visitor::profile_t::profile_t(profile_t &&a) : v(a.v), start(a.start) {
 Visitor::profile_t::~profile_t() {
     if (start) {
         v.end_apply();
+        if (--v.apply_depth.n == 0)
+            v.scratch_arena.reset();
         --profile_indent;
         struct timespec ts;
 #ifdef CLOCK_MONOTONIC
@@ -289,6 +432,7 @@ const IR::Node *Modifier::apply_visitor(const IR::Node *n, const char *name) {
             n->apply_visitor_revisit(*this, visited->result(n));
             n = visited->result(n);
         } else {
+            ++PassProfile::nodes_visited;
             visited->start(n, visitDagOnce);
             IR::Node *copy = n->clone();
             local.current.node = copy;
@@ -319,6 +463,7 @@ const IR::Node *Inspector::apply_visitor(const IR::Node *n, const char *name) {
         } else if (!vp.second && vp.first->second.visitOnce) {
             n->apply_visitor_revisit(*this);
         } else {
+            ++PassProfile::nodes_visited;
             vp.first->second.done = false;
             visitCurrentOnce = &vp.first->second.visitOnce;
             if (n->apply_visitor_preorder(*this)) {
@@ -348,6 +493,7 @@ const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
             n->apply_visitor_revisit(*this, visited->result(n));
             n = visited->result(n);
         } else {
+            ++PassProfile::nodes_visited;
             visited->start(n, visitDagOnce);
             auto copy = n->clone();
             local.current.node = copy;
@@ -536,6 +682,59 @@ IRNODE_ALL_NON_TEMPLATE_CLASSES(DEFINE_APPLY_FUNCTIONS, , , )
 std::ostream &operator<<(std::ostream &out, const IR::Vector<IR::Expression> *v) {
     return v ? out << *v : out << "<null>"; }
 
+const IR::Node *DeclarationLocal::apply_parallel(const IR::P4Program *program) {
+    auto &objects = program->objects;
+    std::vector<size_t> blocks;
+    IR::Vector<IR::Node> others;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        auto *obj = objects.at(i);
+        if (obj->is<IR::P4Control>() || obj->is<IR::P4Parser>() ||
+            obj->is<IR::P4Action>() || obj->is<IR::Function>())
+            blocks.push_back(i);
+        else
+            others.push_back(obj); }
+
+    // everything else is visited first, so the clones start from the state it leaves
+    auto *prefix = (new IR::P4Program(program->srcInfo, others))->apply(*this);
+    if (!prefix) return nullptr;
+    BUG_CHECK(prefix->objects.size() == others.size(),
+              "%1% added or removed top-level objects", name());
+    std::vector<Visitor *> clones(blocks.size());
+    for (auto &c : clones) {
+        c = clone();
+        BUG_CHECK(typeid(*c) == typeid(*this), "%1% must override clone()", name()); }
+
+    std::vector<const IR::Node *> results(blocks.size());
+    std::atomic<uint64_t> visited(0), changed(0);
+    Context program_ctxt = { nullptr, program, program, 0, "objects", 1 };
+    Util::parallelFor(blocks.size(), [&](size_t i) {
+        uint64_t visited_before = PassProfile::nodes_visited;
+        uint64_t changed_before = PassProfile::nodes_changed;
+        Context ctxt = { &program_ctxt, &objects, &objects, static_cast<int>(blocks[i]),
+                         nullptr, 2 };
+        results[i] = objects.at(blocks[i])->apply(*clones[i], &ctxt);
+        visited += PassProfile::nodes_visited - visited_before;
+        changed += PassProfile::nodes_changed - changed_before;
+        PassProfile::nodes_visited = visited_before;
+        PassProfile::nodes_changed = changed_before; });
+    PassProfile::nodes_visited += visited;
+    PassProfile::nodes_changed += changed;
+
+    IR::Vector<IR::Node> merged;
+    auto other = prefix->objects.begin();
+    for (size_t i = 0, b = 0; i < objects.size(); ++i) {
+        auto *obj = b < blocks.size() && blocks[b] == i ? results[b++] : *other++;
+        if (!obj) continue;
+        if (auto *vec = obj->to<IR::VectorBase>()) {
+            for (auto *el : *vec)
+                merged.push_back(el);
+        } else {
+            merged.push_back(obj); } }
+    if (merged == objects)
+        return program;
+    return new IR::P4Program(program->srcInfo, merged);
+}
+
 #include <config.h>
 #if HAVE_CXXABI_H
 #include <cxxabi.h>
@@ -19,6 +19,7 @@ limitations under the License.
 
 #include <stdexcept>
 #include <unordered_map>
+#include "lib/arena.h"
 #include "lib/cstring.h"
 #include "ir/ir.h"
 #include "lib/exceptions.h"
@@ -280,10 +281,30 @@ class Visitor  {
     void visitOnce() const { *visitCurrentOnce = true; }
     void visitAgain() const { *visitCurrentOnce = false; }
 
+    /// Region for scratch data (temporary containers, per-node state) that is
+    /// only needed during one traversal.  It is all freed at once when the
+    /// outermost apply of the visitor finishes, so nothing allocated from it may
+    /// be kept in the visitor between applies; applies nested in it share it.
+    /// Flow clones share the arena of the visitor they were cloned from; a
+    /// clone applied on its own gets a fresh one.  Inspectors keep the nodes
+    /// they have visited in it.
+    Util::Arena &scratch() {
+        if (!scratch_arena) scratch_arena = std::make_shared<Util::Arena>();
+        return *scratch_arena; }
+
  private:
     virtual void visitor_const_error();
     const Context *ctxt = nullptr;  // should be readonly to subclasses
     bool *visitCurrentOnce = nullptr;
+    std::shared_ptr<Util::Arena> scratch_arena;
+    /// Applies of this visitor in progress.  Not copied, so that a clone
+    /// applied on its own starts its own scratch arena.
+    struct apply_depth_t {
+        unsigned n = 0;
+        apply_depth_t() {}
+        apply_depth_t(const apply_depth_t &) {}
+        apply_depth_t &operator=(const apply_depth_t &) { return *this; }
+    } apply_depth;
     friend class Inspector;
     friend class Modifier;
     friend class Transform;
@@ -314,7 +335,10 @@ class Modifier : public virtual Visitor {
 
 class Inspector : public virtual Visitor {
     struct info_t { bool done, visitOnce; };
-    typedef std::unordered_map<const IR::Node *, info_t>       visited_t;
+    typedef std::unordered_map<const IR::Node *, info_t, std::hash<const IR::Node *>,
+                               std::equal_to<const IR::Node *>,
+                               Util::ArenaAllocator<std::pair<const IR::Node *const, info_t>>>
+                                                                visited_t;
     std::shared_ptr<visited_t> visited;
     bool check_clone(const Visitor *) override;
  public:
@@ -438,6 +462,23 @@ class Backtrack : public virtual Visitor {
         // returns true for passes that will never catch a trigger (backtrack() is always false)
 };
 
+/** A pass whose effect on each P4Control, P4Parser, P4Action and Function declared at
+ * the top level of a P4Program depends only on that declaration, on state collected
+ * from the top-level objects preceding it, and on analyses that do not change while
+ * the pass runs (e.g., a ReferenceMap or TypeMap computed earlier).
+ *
+ * When more than one thread is available (see Util::parallelism), PassManager runs
+ * such a pass with apply_parallel:  all other top-level objects are visited first, in
+ * order, by the pass itself; then each of those declarations is visited by its own
+ * clone of the pass, concurrently, and the results are merged into a new P4Program.
+ * A DeclarationLocal pass must therefore implement clone(), must not add or remove
+ * top-level objects other than the declaration being visited, and must not rely on
+ * visiting the P4Program node itself. */
+class DeclarationLocal : public virtual Visitor {
+ public:
+    const IR::Node *apply_parallel(const IR::P4Program *program);
+};
+
 class P4WriteContext : public virtual Visitor {
  public:
     bool isWrite(bool root_value = false);     // might write based on context
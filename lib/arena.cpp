@@ -0,0 +1,85 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "arena.h"
+
+namespace Util {
+
+static constexpr size_t headerSize =
+    (sizeof(void *) + sizeof(size_t) + alignof(std::max_align_t) - 1)
+    & ~(alignof(std::max_align_t) - 1);
+
+void *Arena::allocate_slow(size_t size, size_t align) {
+    size_t need = size + align;
+    if (need > chunk_size / 4) {
+        // a large object gets a chunk of its own, behind the current one, so
+        // the space left in the current chunk is not wasted
+        auto *c = static_cast<chunk_t *>(::operator new(headerSize + need));
+        c->size = need;
+        if (chunks) {
+            c->next = chunks->next;
+            chunks->next = c;
+        } else {
+            c->next = nullptr;
+            chunks = c; }
+        char *data = reinterpret_cast<char *>(c) + headerSize;
+        used += size;
+        return data + (-reinterpret_cast<uintptr_t>(data) & (align - 1)); }
+    auto *c = static_cast<chunk_t *>(::operator new(headerSize + chunk_size));
+    c->size = chunk_size;
+    c->next = chunks;
+    chunks = c;
+    ptr = reinterpret_cast<char *>(c) + headerSize;
+    end = ptr + chunk_size;
+    return allocate(size, align);
+}
+
+void Arena::run_cleanups() {
+    while (cleanups) {
+        auto *c = cleanups;
+        cleanups = c->next;
+        c->destroy(c->obj); }
+}
+
+void Arena::release() {
+    run_cleanups();
+    // keep the most recently allocated regular chunk
+    chunk_t *keep = nullptr;
+    while (chunks) {
+        auto *c = chunks;
+        chunks = c->next;
+        if (!keep && c->size == chunk_size) {
+            keep = c;
+        } else {
+            ::operator delete(c); } }
+    if ((chunks = keep)) {
+        keep->next = nullptr;
+        ptr = reinterpret_cast<char *>(keep) + headerSize;
+        end = ptr + chunk_size;
+    } else {
+        ptr = end = nullptr; }
+    used = 0;
+}
+
+Arena::~Arena() {
+    run_cleanups();
+    while (chunks) {
+        auto *c = chunks;
+        chunks = c->next;
+        ::operator delete(c); }
+}
+
+}  // namespace Util
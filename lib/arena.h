@@ -0,0 +1,110 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_ARENA_H_
+#define LIB_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Util {
+
+/// A region allocator for short-lived scratch data.  Memory is carved out of
+/// large chunks and is never freed piecemeal: it all goes away at once when
+/// the arena is released or destroyed.  With libgc, the chunks are ordinary
+/// collected (and scanned) memory, but they are freed explicitly, so the
+/// collector has a few large objects to track rather than many small ones,
+/// and nothing to sweep.  Without libgc this gives scratch data an explicit
+/// lifetime.  An Arena is not thread-safe.
+class Arena {
+    struct chunk_t {
+        chunk_t         *next;
+        size_t          size;   // of the data following the header
+    };
+    struct cleanup_t {
+        cleanup_t       *next;
+        void            (*destroy)(void *);
+        void            *obj;
+    };
+    chunk_t             *chunks = nullptr;
+    char                *ptr = nullptr, *end = nullptr;
+    cleanup_t           *cleanups = nullptr;
+    size_t              chunk_size;
+    size_t              used = 0;
+
+    void *allocate_slow(size_t size, size_t align);
+    void run_cleanups();
+
+ public:
+    explicit Arena(size_t chunk_size = 64*1024) : chunk_size(chunk_size) {}
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /// @align must be a power of 2
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        if (ptr) {
+            char *rv = ptr + (-reinterpret_cast<uintptr_t>(ptr) & (align - 1));
+            if (rv <= end && size <= size_t(end - rv)) {
+                ptr = rv + size;
+                used += size;
+                return rv; } }
+        return allocate_slow(size, align); }
+
+    /// Construct a T in the arena.  Its destructor (if it has one) is run
+    /// when the arena is released.
+    template<class T, class... Args> T *make(Args&&... args) {
+        void *mem = allocate(sizeof(T), alignof(T));
+        T *rv = new(mem) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            auto *c = new(allocate(sizeof(cleanup_t), alignof(cleanup_t))) cleanup_t;
+            c->next = cleanups;
+            c->destroy = [](void *p) { static_cast<T *>(p)->~T(); };
+            c->obj = rv;
+            cleanups = c; }
+        return rv; }
+
+    /// Free everything allocated so far, keeping one chunk for reuse.
+    void release();
+    /// Bytes handed out since the last release.
+    size_t bytes_used() const { return used; }
+};
+
+/// Standard allocator adapter, so containers of scratch data can live in an
+/// Arena.  deallocate is a no-op; the memory is reclaimed with the arena.
+template<class T> class ArenaAllocator {
+    template<class U> friend class ArenaAllocator;
+    Arena       *arena;
+
+ public:
+    typedef T value_type;
+    explicit ArenaAllocator(Arena &a) : arena(&a) {}
+    template<class U> ArenaAllocator(const ArenaAllocator<U> &a)  // NOLINT(runtime/explicit)
+    : arena(a.arena) {}
+    T *allocate(size_t n) { return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) {}
+    template<class U> bool operator==(const ArenaAllocator<U> &a) const {
+        return arena == a.arena; }
+    template<class U> bool operator!=(const ArenaAllocator<U> &a) const {
+        return arena != a.arena; }
+};
+
+}  // namespace Util
+
+#endif /* LIB_ARENA_H_ */
@@ -17,9 +17,14 @@ limitations under the License.
 #include "cstring.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <ios>
 #include <string>
 #include <unordered_set>
+#ifdef MULTITHREAD
+#include <atomic>
+#include <mutex>
+#endif  // MULTITHREAD
 
 #include "hash.h"
 
@@ -42,6 +47,7 @@ inline table_entry_flags operator |(table_entry_flags l, table_entry_flags r) {
 // cache entry, ordered by string length
 class table_entry {
     std::size_t m_length = 0;
+    std::size_t m_hash = 0;
     table_entry_flags m_flags = table_entry_flags::none;
 
     union {
@@ -50,9 +56,10 @@ class table_entry {
     };
 
  public:
-    // entry ctor, makes copy of passed string
-    table_entry(const char *string, std::size_t length, table_entry_flags flags)
-        : m_length(length) {
+    // entry ctor, makes copy of passed string; @hash is the hash of the string
+    table_entry(const char *string, std::size_t length, std::size_t hash,
+                table_entry_flags flags)
+        : m_length(length), m_hash(hash) {
         if ((flags & table_entry_flags::no_need_copy) == table_entry_flags::no_need_copy) {
             // No need to copy object, it's view of string, string literal or string allocated
             // on heap and wrapped with cstring.
@@ -87,7 +94,8 @@ class table_entry {
     // table_entry moveable only
     table_entry(const table_entry &) = delete;
 
-    table_entry(table_entry &&other) : m_length(other.m_length), m_flags(other.m_flags) {
+    table_entry(table_entry &&other)
+        : m_length(other.m_length), m_hash(other.m_hash), m_flags(other.m_flags) {
         // this object for internal usage only, length will never be accessed
         // if object was moved, so do not zero other.m_length here
 
@@ -113,6 +121,10 @@ class table_entry {
         return m_length;
     }
 
+    std::size_t hash() const {
+        return m_hash;
+    }
+
     const char *string() const {
         if (is_inplace()) {
             return m_inplace_string;
@@ -136,31 +148,63 @@ namespace std {
 template<>
 struct hash<table_entry> {
     std::size_t operator()(const table_entry &entry) const {
-        return Util::Hash::murmur(entry.string(), entry.length());
+        return entry.hash();
     }
 };
 }
 
 namespace {
-std::unordered_set<table_entry>& cache() {
-    static std::unordered_set<table_entry> g_cache;
+// The cache is split in shards, selected by the high bits of the string hash, each with
+// its own lock, so threads interning different strings rarely wait for each other and
+// growing the table only rehashes one (small) shard at a time.
+constexpr std::size_t cache_shards = 64;
+
+#ifdef MULTITHREAD
+typedef std::atomic<std::size_t> shard_counter;
+#else
+typedef std::size_t shard_counter;
+#endif  // MULTITHREAD
+
+struct cache_shard {
+    std::unordered_set<table_entry> strings;
+    // maintained separately so that cache_size can be called without locking, e.g.,
+    // from the GC callback triggered by an allocation while a shard is locked
+    shard_counter count{0}, bytes{0};
+#ifdef MULTITHREAD
+    shard_counter contended{0};
+    std::mutex lock;
+#endif  // MULTITHREAD
+};
+
+cache_shard *cache() {
+    static cache_shard g_cache[cache_shards];
 
     return g_cache;
 }
 
 const char *save_to_cache(const char *string, std::size_t length, table_entry_flags flags) {
-    if ((flags & table_entry_flags::no_need_copy) == table_entry_flags::no_need_copy) {
-        return cache().emplace(string, length, flags).first->string();
-    }
-
-    // temporary table_entry, used for searching only. no need to copy string
-    auto found = cache().find(table_entry(string, length, table_entry_flags::no_need_copy));
-
-    if (found == cache().end()) {
-        return cache().emplace(string, length, flags).first->string();
+    auto hash = Util::Hash::murmur(string, length);
+    auto &shard = cache()[hash / (SIZE_MAX / cache_shards + 1)];
+#ifdef MULTITHREAD
+    std::unique_lock<std::mutex> acquire(shard.lock, std::try_to_lock);
+    if (!acquire.owns_lock()) {
+        acquire.lock();
+        ++shard.contended; }
+#endif  // MULTITHREAD
+
+    if ((flags & table_entry_flags::no_need_copy) == table_entry_flags::none) {
+        // temporary table_entry, used for searching only. no need to copy string
+        auto found = shard.strings.find(
+            table_entry(string, length, hash, table_entry_flags::no_need_copy));
+        if (found != shard.strings.end())
+            return found->string();
     }
 
-    return found->string();
+    auto inserted = shard.strings.emplace(string, length, hash, flags);
+    if (inserted.second) {
+        ++shard.count;
+        shard.bytes += sizeof(table_entry) + length; }
+    return inserted.first->string();
 }
 
 }  // namespace
@@ -179,13 +223,28 @@ void cstring::construct_from_literal(const char *string, std::size_t length) {
 }
 
 size_t cstring::cache_size(size_t &count) {
-    size_t rv = 0;
-    count = cache().size();
-    for (auto &s : cache())
-        rv += sizeof(s) + s.length();
+    cache_stats stats;
+    auto rv = cache_size(stats);
+    count = stats.count;
     return rv;
 }
 
+size_t cstring::cache_size(cache_stats &stats) {
+    stats = cache_stats();
+    stats.shards = cache_shards;
+    for (size_t i = 0; i < cache_shards; ++i) {
+        auto &shard = cache()[i];
+        size_t count = shard.count;
+        stats.count += count;
+        stats.bytes += shard.bytes;
+        stats.largest_shard = std::max(stats.largest_shard, count);
+#ifdef MULTITHREAD
+        stats.contended += shard.contended;
+#endif  // MULTITHREAD
+    }
+    return stats.bytes;
+}
+
 cstring cstring::newline = cstring("\n");
 cstring cstring::empty = cstring("");
 
@@ -51,8 +51,9 @@ limitations under the License.
  *     std::string.
  *   - Interned strings can never be freed, so they'll stick around for the
  *     lifetime of the program.
- *   - The string interning cstring performs is currently not threadsafe, so you
- *     can't safely use cstrings off the main thread.
+ *   - The string interning cstring performs is only threadsafe when the
+ *     compiler is built with ENABLE_MULTITHREAD, so otherwise you can't
+ *     safely use cstrings off the main thread.
  *
  * Given these tradeoffs, the general rule of thumb to follow is that you should
  * try to convert strings to cstrings early and keep them in that form. That
@@ -261,6 +262,17 @@ class cstring {
     /// to the total number of interned strings.
     static size_t cache_size(size_t &count);
 
+    /// Occupancy and contention of the (sharded) table of interned strings.
+    struct cache_stats {
+        size_t count = 0;           ///< number of interned strings
+        size_t bytes = 0;           ///< total size of the strings and their table entries
+        size_t shards = 0;          ///< number of shards of the table
+        size_t largest_shard = 0;   ///< number of strings in the fullest shard
+        size_t contended = 0;       ///< lookups that had to wait for another thread
+    };
+    /// @return the total size in bytes of all interned strings; fills in @stats.
+    static size_t cache_size(cache_stats &stats);
+
     /// convert the cstring to upper case
     cstring toUpper() const;
     /// capitalize the first symbol
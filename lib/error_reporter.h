@@ -17,6 +17,10 @@ limitations under the License.
 #ifndef _LIB_ERROR_REPORTER_H_
 #define _LIB_ERROR_REPORTER_H_
 
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
 #include "error_helper.h"
 #include "error_catalog.h"
 #include "exceptions.h"
@@ -63,10 +67,20 @@ class ErrorReporter {
     bool error_reported(int err, const Util::SourceInfo source) {
         if (!source.isValid())
             return false;
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock());
+#endif  // MULTITHREAD
         auto p = errorTracker.emplace(err, source);
         return !p.second;  // if insertion took place, then we have not seen the error.
     }
 
+#ifdef MULTITHREAD
+    /// Diagnostics may be reported from worker threads (see Util::parallelFor)
+    static std::mutex &lock() {
+        static std::mutex lock;
+        return lock; }
+#endif  // MULTITHREAD
+
     /// retrieve the format from the error catalog
     const char *get_error_name(int errorCode) {
         return ErrorCatalog::getCatalog().getName(errorCode);
@@ -137,6 +151,9 @@ class ErrorReporter {
     void diagnose(DiagnosticAction action, const char* diagnosticName,
                   const char* format, const char* suffix, T... args) {
         if (action == DiagnosticAction::Ignore) return;
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock());
+#endif  // MULTITHREAD
 
         ErrorMessage::MessageType msgType = ErrorMessage::MessageType::None;
         if (action == DiagnosticAction::Warn) {
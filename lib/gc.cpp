@@ -16,10 +16,15 @@ limitations under the License.
 
 #include "config.h"
 #if HAVE_LIBGC
+#ifdef MULTITHREAD
+#define GC_THREADS
+#endif  // MULTITHREAD
 #include <gc/gc_cpp.h>
 #include <gc/gc_mark.h>
 #endif  /* HAVE_LIBGC */
 #include <sys/mman.h>
+#include <time.h>
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
 #include <new>
@@ -36,6 +41,7 @@ limitations under the License.
 #endif
 
 static bool done_init, started_init;
+static size_t gc_peak_heap;  // see gc_get_statistics
 // emergency pool to allow a few extra allocations after a bad_alloc is thrown so we
 // can generate reasonable errors, a stack trace, etc
 static char emergency_pool[16*1024];
@@ -171,13 +177,36 @@ extern "C" int GC_print_stats;
 #endif /* HAVE_GC_PRINT_STATS */
 
 static int gc_logging_level;
+static uint64_t gc_pause_nsec;
+
+#if HAVE_GC_SET_ON_COLLECTION_EVENT
+static uint64_t gc_clock_nsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000UL + ts.tv_nsec;
+}
+
+static void gc_event(GC_EventType event) {
+    // called with the allocation lock held, so must not call locking GC functions
+    static uint64_t start;
+    if (event == GC_EVENT_START) {
+        start = gc_clock_nsec();
+    } else if (event == GC_EVENT_END) {
+        gc_pause_nsec += gc_clock_nsec() - start;
+        struct GC_prof_stats_s stats;
+        GC_get_prof_stats_unsafe(&stats, sizeof(stats));
+        gc_peak_heap = std::max(gc_peak_heap, static_cast<size_t>(stats.heapsize_full)); }
+}
+#endif  /* HAVE_GC_SET_ON_COLLECTION_EVENT */
 
 static void gc_callback() {
     if (gc_logging_level >= 1) {
         std::clog << "****** GC called ****** (heap size " << n4(GC_get_heap_size()) << ")";
-        size_t count, size = cstring::cache_size(count);
-        std::clog << " cstring cache size " << n4(size) << " (count " << n4(count) << ")"
-                  << std::endl;
+        cstring::cache_stats stats;
+        size_t size = cstring::cache_size(stats);
+        std::clog << " cstring cache size " << n4(size) << " (count " << n4(stats.count)
+                  << ", largest shard " << n4(stats.largest_shard) << ", contended "
+                  << n4(stats.contended) << ")" << std::endl;
     }
 }
 
@@ -213,3 +242,95 @@ size_t gc_mem_inuse(size_t *max) {
     return 0;
 #endif
 }
+
+size_t gc_heap_size() {
+#if HAVE_LIBGC
+    return GC_get_heap_size();
+#else
+    return 0;
+#endif
+}
+
+size_t gc_total_bytes() {
+#if HAVE_LIBGC
+    return GC_get_total_bytes();
+#else
+    return 0;
+#endif
+}
+
+void gc_get_statistics(gc_statistics &stats) {
+#if HAVE_LIBGC
+    stats.collections = GC_get_gc_no();
+    stats.pause_nsec = gc_pause_nsec;
+    struct GC_prof_stats_s prof;
+    GC_get_prof_stats(&prof, sizeof(prof));
+    stats.bytes_reclaimed = prof.reclaimed_bytes_before_gc + prof.bytes_reclaimed_since_gc;
+    gc_peak_heap = std::max(gc_peak_heap, static_cast<size_t>(prof.heapsize_full));
+    stats.peak_heap = gc_peak_heap;
+#else
+    stats = gc_statistics();
+#endif
+}
+
+void gc_reset_peak_heap(size_t at_least) {
+    gc_peak_heap = std::max(at_least, gc_heap_size());
+}
+
+void gc_track_pauses() {
+#if HAVE_LIBGC && HAVE_GC_SET_ON_COLLECTION_EVENT
+    GC_set_on_collection_event(gc_event);
+#endif
+}
+
+void gc_set_mode(gc_mode mode) {
+#if HAVE_LIBGC
+    if (mode == gc_mode::full) return;
+    GC_enable_incremental();
+    if (mode == gc_mode::generational)
+        GC_set_time_limit(GC_TIME_UNLIMITED);
+#else
+    (void)mode;
+#endif
+}
+
+void gc_set_free_space_divisor(unsigned divisor) {
+#if HAVE_LIBGC
+    if (divisor > 0)
+        GC_set_free_space_divisor(divisor);
+#else
+    (void)divisor;
+#endif
+}
+
+#ifdef MULTITHREAD
+void gc_start_threads() {
+#if HAVE_LIBGC
+    static bool allowed = false;
+    if (!allowed) {
+        GC_allow_register_threads();
+        allowed = true; }
+    GC_disable();
+#endif
+}
+
+void gc_end_threads() {
+#if HAVE_LIBGC
+    GC_enable();
+#endif
+}
+
+void gc_register_thread() {
+#if HAVE_LIBGC
+    struct GC_stack_base sb;
+    GC_get_stack_base(&sb);
+    GC_register_my_thread(&sb);
+#endif
+}
+
+void gc_unregister_thread() {
+#if HAVE_LIBGC
+    GC_unregister_my_thread();
+#endif
+}
+#endif  // MULTITHREAD
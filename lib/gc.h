@@ -18,8 +18,44 @@ limitations under the License.
 #define LIB_GC_H_
 
 #include <cstddef>
+#include <cstdint>
 
 void setup_gc_logging();
 size_t gc_mem_inuse(size_t *max = 0);  // trigger GC, return inuse after
+size_t gc_heap_size();                 // current heap size, does not trigger GC
+size_t gc_total_bytes();               // total bytes allocated since startup
+
+// Collector statistics (--gc-stats).  All counts are totals since startup,
+// except peak_heap, which is the largest heap size seen since the last
+// gc_reset_peak_heap (which restarts it from the current heap size, or
+// @at_least if that is larger).  Pause times are only tracked once gc_track_pauses has
+// been called, and only with a libgc that has GC_set_on_collection_event.
+struct gc_statistics {
+    size_t      collections = 0;
+    uint64_t    pause_nsec = 0;
+    size_t      bytes_reclaimed = 0;
+    size_t      peak_heap = 0;
+};
+void gc_get_statistics(gc_statistics &stats);
+void gc_reset_peak_heap(size_t at_least = 0);
+void gc_track_pauses();
+
+// Collector tuning: incremental collection (also generational where libgc
+// supports it), generational only (without a time limit on each increment),
+// and the free space divisor (higher values mean a smaller heap and more
+// frequent collections; libgc's default is 3).
+enum class gc_mode { full, incremental, generational };
+void gc_set_mode(gc_mode mode);
+void gc_set_free_space_divisor(unsigned divisor);
+
+#ifdef MULTITHREAD
+// Allocating from worker threads (see Util::parallelFor): collection is suspended
+// between gc_start_threads and gc_end_threads, called by the main thread around
+// the lifetime of the workers, and each worker registers itself before allocating.
+void gc_start_threads();
+void gc_end_threads();
+void gc_register_thread();
+void gc_unregister_thread();
+#endif  // MULTITHREAD
 
 #endif /* LIB_GC_H_ */
@@ -37,6 +37,11 @@ auto murmur(const T& obj, typename std::enable_if<
     -> decltype(murmur(reinterpret_cast<const void *>(&obj), sizeof(T))) {
     return murmur(reinterpret_cast<const void *>(&obj), sizeof(T));
 }
+
+// mixes hash value @v into the running hash @seed (as boost::hash_combine)
+inline std::size_t combine(std::size_t seed, std::size_t v) {
+    return seed ^ (v + static_cast<std::size_t>(0x9e3779b97f4a7c15ULL) + (seed << 6) + (seed >> 2));
+}
 }  // namespace Hash
 }  // namespace Util
 
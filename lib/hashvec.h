@@ -0,0 +1,171 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_HASHVEC_H_
+#define LIB_HASHVEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// Common implementation of hvec_map and hvec_set: the elements are stored in
+/// insertion order in a contiguous vector, and found through an open-addressing
+/// hash index of element numbers (linear probing, load at most 1/2).
+///
+/// Erasing an element leaves a tombstone in the vector (so erasing never moves
+/// other elements or invalidates iterators); tombstones are skipped by
+/// iterators and lookups, and squeezed out when the index is next rebuilt,
+/// once they make up more than a quarter of the vector.  So, as with
+/// std::unordered_map, inserting may invalidate iterators and references to
+/// the elements, while erasing does not.
+template <class ELEM, class KEY_OF, class HASH, class PRED, class ALLOC>
+class hash_vector_base {
+ protected:
+    std::vector<ELEM, ALLOC>    data;
+    std::vector<bool>           erased;
+    size_t                      erased_count = 0;
+    std::vector<uint32_t>       index;  // 0 for an empty slot, else element number + 1
+    unsigned                    index_shift = 8*sizeof(size_t);
+    HASH                        hf;
+    PRED                        eq;
+
+    static constexpr size_t npos = ~size_t(0);
+
+    size_t slot_of(size_t hash) const {
+        return index_shift >= 8*sizeof(size_t) ? 0
+             : (hash * 0x9E3779B97F4A7C15ULL) >> index_shift; }
+    template<class K> size_t find_elem(const K &k) const {
+        if (index.empty()) return npos;
+        size_t mask = index.size() - 1;
+        for (size_t s = slot_of(hf(k)); index[s]; s = (s + 1) & mask) {
+            size_t i = index[s] - 1;
+            if (!erased[i] && eq(KEY_OF()(data[i]), k)) return i; }
+        return npos; }
+    void index_elem(size_t i) {
+        size_t mask = index.size() - 1;
+        size_t s = slot_of(hf(KEY_OF()(data[i])));
+        while (index[s]) s = (s + 1) & mask;
+        index[s] = i + 1; }
+    void rebuild_index(size_t slots) {
+        index.assign(slots, 0);
+        index_shift = 8*sizeof(size_t);
+        for (size_t n = slots; n > 1; n >>= 1) --index_shift;
+        for (size_t i = 0; i < data.size(); ++i)
+            if (!erased[i]) index_elem(i); }
+    /// make room in the index (and vector) for one more element
+    void reserve_one() {
+        size_t need = data.size() + 1;
+        if (2*need <= index.size()) return;
+        if (4*erased_count > data.size()) {
+            // squeeze out the tombstones; elements are move-constructed, as a
+            // map's value_type is not assignable
+            std::vector<ELEM, ALLOC> live(data.get_allocator());
+            live.reserve(data.size() - erased_count + 1);
+            for (size_t i = 0; i < data.size(); ++i)
+                if (!erased[i]) live.emplace_back(std::move(data[i]));
+            data.swap(live);
+            erased.assign(data.size(), false);
+            erased_count = 0;
+            need = data.size() + 1; }
+        size_t slots = index.empty() ? 8 : index.size();
+        while (2*need > slots) slots *= 2;
+        rebuild_index(slots); }
+    /// append an element known not to be present
+    template<class... Args> size_t append(Args &&... args) {
+        reserve_one();
+        data.emplace_back(std::forward<Args>(args)...);
+        erased.push_back(false);
+        index_elem(data.size() - 1);
+        return data.size() - 1; }
+    void erase_elem(size_t i) {
+        erased[i] = true;
+        ++erased_count; }
+    size_t next_live(size_t i) const {
+        while (i < data.size() && erased[i]) ++i;
+        return i; }
+    size_t prev_live(size_t i) const {
+        do { --i; } while (erased[i]);
+        return i; }
+
+    hash_vector_base() = default;
+    hash_vector_base(const hash_vector_base &a) : data(a.data), erased(a.erased),
+        erased_count(a.erased_count), index(a.index), index_shift(a.index_shift) {}
+    hash_vector_base(hash_vector_base &&) = default;
+    hash_vector_base &operator=(const hash_vector_base &a) {
+        if (this != &a) {
+            // assign by copy construction, for the same reason as in reserve_one
+            hash_vector_base tmp(a);
+            swap(tmp); }
+        return *this; }
+    hash_vector_base &operator=(hash_vector_base &&) = default;
+    void swap(hash_vector_base &a) {
+        data.swap(a.data);
+        erased.swap(a.erased);
+        std::swap(erased_count, a.erased_count);
+        index.swap(a.index);
+        std::swap(index_shift, a.index_shift); }
+
+    /// bidirectional iterator skipping the tombstones; VAL is the (possibly
+    /// const) element type
+    template<class VAL> class iter_t {
+        friend class hash_vector_base;
+        template<class, class, class, class, class> friend class hvec_map;
+        template<class, class, class, class> friend class hvec_set;
+        typedef typename std::conditional<std::is_const<VAL>::value,
+                const hash_vector_base, hash_vector_base>::type base_t;
+        base_t  *self;
+        size_t  idx;
+        iter_t(base_t *self, size_t idx) : self(self), idx(idx) {}
+
+     public:
+        typedef std::bidirectional_iterator_tag         iterator_category;
+        typedef typename std::remove_const<VAL>::type   value_type;
+        typedef ptrdiff_t                               difference_type;
+        typedef VAL                                     *pointer;
+        typedef VAL                                     &reference;
+
+        iter_t() : self(nullptr), idx(0) {}
+        template<class V2, class = typename std::enable_if<
+                     std::is_same<const V2, VAL>::value && !std::is_same<V2, VAL>::value>::type>
+        iter_t(const iter_t<V2> &a) : self(a.self), idx(a.idx) {}  // NOLINT(runtime/explicit)
+        reference operator*() const { return self->data[idx]; }
+        pointer operator->() const { return &self->data[idx]; }
+        iter_t &operator++() { idx = self->next_live(idx + 1); return *this; }
+        iter_t &operator--() { idx = self->prev_live(idx); return *this; }
+        iter_t operator++(int) { auto copy = *this; ++*this; return copy; }
+        iter_t operator--(int) { auto copy = *this; --*this; return copy; }
+        bool operator==(const iter_t &a) const { return idx == a.idx; }
+        bool operator!=(const iter_t &a) const { return idx != a.idx; }
+        template<class> friend class iter_t;
+    };
+
+ public:
+    typedef size_t      size_type;
+
+    bool        empty() const noexcept { return data.size() == erased_count; }
+    size_type   size() const noexcept { return data.size() - erased_count; }
+    size_type   max_size() const noexcept { return UINT32_MAX - 1; }
+    void clear() {
+        data.clear();
+        erased.clear();
+        erased_count = 0;
+        index.clear(); }
+};
+
+#endif /* LIB_HASHVEC_H_ */
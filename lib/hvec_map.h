@@ -0,0 +1,189 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_HVEC_MAP_H_
+#define LIB_HVEC_MAP_H_
+
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "hashvec.h"
+
+namespace HVecDetail {
+struct first_of {
+    template<class P> const typename P::first_type &operator()(const P &p) const {
+        return p.first; } };
+}  // namespace HVecDetail
+
+/// Map ordered by order of element insertion, like ordered_map, but with the
+/// elements in one contiguous vector and a hash index rather than a list and
+/// a std::map of list iterators.  So it needs a hash function for the keys
+/// rather than a comparison, and does not provide the key-ordered operations
+/// (lower_bound etc.) or inserting at a position.  Unlike ordered_map,
+/// inserting may invalidate iterators and references (see hash_vector_base).
+template <class K, class V, class HASH = std::hash<K>, class PRED = std::equal_to<K>,
+          class ALLOC = std::allocator<std::pair<const K, V>>>
+class hvec_map : public hash_vector_base<std::pair<const K, V>, HVecDetail::first_of,
+                                         HASH, PRED, ALLOC> {
+    typedef hash_vector_base<std::pair<const K, V>, HVecDetail::first_of,
+                             HASH, PRED, ALLOC>         base;
+    using base::data;
+    using base::npos;
+    using base::find_elem;
+    using base::append;
+
+ public:
+    typedef K                           key_type;
+    typedef V                           mapped_type;
+    typedef std::pair<const K, V>       value_type;
+    typedef HASH                        hasher;
+    typedef PRED                        key_equal;
+    typedef ALLOC                       allocator_type;
+    typedef value_type                  &reference;
+    typedef const value_type            &const_reference;
+    typedef typename base::size_type    size_type;
+
+    typedef typename base::template iter_t<value_type>          iterator;
+    typedef typename base::template iter_t<const value_type>    const_iterator;
+    typedef std::reverse_iterator<iterator>             reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>       const_reverse_iterator;
+
+    hvec_map() = default;
+    hvec_map(const hvec_map &) = default;
+    hvec_map(hvec_map &&) = default;
+    template<typename InputIt>
+    hvec_map(InputIt first, InputIt last) { insert(first, last); }
+    hvec_map(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+    hvec_map &operator=(const hvec_map &) = default;
+    hvec_map &operator=(hvec_map &&) = default;
+
+    iterator                    begin() noexcept { return iterator(this, this->next_live(0)); }
+    const_iterator              begin() const noexcept {
+                                    return const_iterator(this, this->next_live(0)); }
+    iterator                    end() noexcept { return iterator(this, data.size()); }
+    const_iterator              end() const noexcept { return const_iterator(this, data.size()); }
+    reverse_iterator            rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator      rbegin() const noexcept { return const_reverse_iterator(end()); }
+    reverse_iterator            rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator      rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_iterator              cbegin() const noexcept { return begin(); }
+    const_iterator              cend() const noexcept { return end(); }
+    const_reverse_iterator      crbegin() const noexcept { return rbegin(); }
+    const_reverse_iterator      crend() const noexcept { return rend(); }
+
+    /// equal if they have the same elements in the same order
+    bool operator==(const hvec_map &a) const {
+        if (this->size() != a.size()) return false;
+        auto it = a.begin();
+        for (auto &el : *this) {
+            if (el != *it) return false;
+            ++it; }
+        return true; }
+    bool operator!=(const hvec_map &a) const { return !(*this == a); }
+
+    iterator find(const key_type &k) {
+        auto i = find_elem(k);
+        return iterator(this, i == npos ? data.size() : i); }
+    const_iterator find(const key_type &k) const {
+        auto i = find_elem(k);
+        return const_iterator(this, i == npos ? data.size() : i); }
+    size_type count(const key_type &k) const { return find_elem(k) != npos; }
+
+    V &operator[](const K &k) {
+        auto i = find_elem(k);
+        if (i == npos)
+            i = append(std::piecewise_construct, std::forward_as_tuple(k), std::tuple<>());
+        return data[i].second; }
+    V &operator[](K &&k) {
+        auto i = find_elem(k);
+        if (i == npos)
+            i = append(std::piecewise_construct, std::forward_as_tuple(std::move(k)),
+                       std::tuple<>());
+        return data[i].second; }
+    V &at(const K &k) {
+        auto i = find_elem(k);
+        if (i == npos) throw std::out_of_range("hvec_map::at");
+        return data[i].second; }
+    const V &at(const K &k) const {
+        auto i = find_elem(k);
+        if (i == npos) throw std::out_of_range("hvec_map::at");
+        return data[i].second; }
+
+    template<typename KK, typename... VV>
+    std::pair<iterator, bool> emplace(KK &&k, VV &&... v) {
+        auto i = find_elem(k);
+        if (i != npos)
+            return std::make_pair(iterator(this, i), false);
+        i = append(std::piecewise_construct, std::forward_as_tuple(std::forward<KK>(k)),
+                   std::forward_as_tuple(std::forward<VV>(v)...));
+        return std::make_pair(iterator(this, i), true); }
+    std::pair<iterator, bool> insert(const value_type &v) {
+        auto i = find_elem(v.first);
+        if (i != npos)
+            return std::make_pair(iterator(this, i), false);
+        return std::make_pair(iterator(this, append(v)), true); }
+    template<class InputIterator> void insert(InputIterator b, InputIterator e) {
+        while (b != e) insert(*b++); }
+
+    iterator erase(const_iterator pos) {
+        this->erase_elem(pos.idx);
+        return iterator(this, this->next_live(pos.idx + 1)); }
+    size_type erase(const K &k) {
+        auto i = find_elem(k);
+        if (i == npos) return 0;
+        this->erase_elem(i);
+        return 1; }
+};
+
+namespace GetImpl {
+
+template<class K, class T, class V, class Hash, class Pred, class Alloc>
+inline V get(const hvec_map<K, V, Hash, Pred, Alloc> &m, T key, V def = V()) {
+    auto it = m.find(key);
+    if (it != m.end()) return it->second;
+    return def; }
+
+template<class K, class T, class V, class Hash, class Pred, class Alloc>
+inline V *getref(hvec_map<K, V, Hash, Pred, Alloc> &m, T key) {
+    auto it = m.find(key);
+    if (it != m.end()) return &it->second;
+    return 0; }
+
+template<class K, class T, class V, class Hash, class Pred, class Alloc>
+inline const V *getref(const hvec_map<K, V, Hash, Pred, Alloc> &m, T key) {
+    auto it = m.find(key);
+    if (it != m.end()) return &it->second;
+    return 0; }
+
+template<class K, class T, class V, class Hash, class Pred, class Alloc>
+inline V get(const hvec_map<K, V, Hash, Pred, Alloc> *m, T key, V def = V()) {
+    return m ? get(*m, key, def) : def; }
+
+template<class K, class T, class V, class Hash, class Pred, class Alloc>
+inline V *getref(hvec_map<K, V, Hash, Pred, Alloc> *m, T key) {
+    return m ? getref(*m, key) : 0; }
+
+template<class K, class T, class V, class Hash, class Pred, class Alloc>
+inline const V *getref(const hvec_map<K, V, Hash, Pred, Alloc> *m, T key) {
+    return m ? getref(*m, key) : 0; }
+
+}  // namespace GetImpl
+using namespace GetImpl;  // NOLINT(build/namespaces)
+
+#endif /* LIB_HVEC_MAP_H_ */
@@ -0,0 +1,161 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_HVEC_SET_H_
+#define LIB_HVEC_SET_H_
+
+#include <functional>
+#include <initializer_list>
+#include <utility>
+
+#include "hashvec.h"
+
+namespace HVecDetail {
+struct identity {
+    template<class T> const T &operator()(const T &v) const { return v; } };
+}  // namespace HVecDetail
+
+/// Set remembering items in insertion order, like ordered_set, but with the
+/// items in one contiguous vector and a hash index rather than a list and a
+/// std::map of list iterators.  So it needs a hash function rather than a
+/// comparison, and does not provide the sorted operations.  Unlike
+/// ordered_set, inserting may invalidate iterators (see hash_vector_base).
+template <class T, class HASH = std::hash<T>, class PRED = std::equal_to<T>,
+          class ALLOC = std::allocator<T>>
+class hvec_set : public hash_vector_base<T, HVecDetail::identity, HASH, PRED, ALLOC> {
+    typedef hash_vector_base<T, HVecDetail::identity, HASH, PRED, ALLOC>    base;
+    using base::data;
+    using base::npos;
+    using base::find_elem;
+    using base::append;
+
+ public:
+    typedef T                           key_type;
+    typedef T                           value_type;
+    typedef HASH                        hasher;
+    typedef PRED                        key_equal;
+    typedef ALLOC                       allocator_type;
+    typedef const T                     &reference;
+    typedef const T                     &const_reference;
+    typedef typename base::size_type    size_type;
+
+    // as with ordered_set, no iterator may modify the items
+    typedef typename base::template iter_t<const T>     iterator;
+    typedef typename base::template iter_t<const T>     const_iterator;
+    typedef std::reverse_iterator<iterator>             reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>       const_reverse_iterator;
+
+    hvec_set() = default;
+    hvec_set(const hvec_set &) = default;
+    hvec_set(hvec_set &&) = default;
+    hvec_set(std::initializer_list<T> init) { insert(init.begin(), init.end()); }
+    template<typename InputIt>
+    hvec_set(InputIt first, InputIt last) { insert(first, last); }
+    hvec_set &operator=(const hvec_set &) = default;
+    hvec_set &operator=(hvec_set &&) = default;
+
+    /// equal if they have the same items in the same order
+    bool operator==(const hvec_set &a) const {
+        if (this->size() != a.size()) return false;
+        auto it = a.begin();
+        for (auto &el : *this) {
+            if (!(el == *it)) return false;
+            ++it; }
+        return true; }
+    bool operator!=(const hvec_set &a) const { return !(*this == a); }
+
+    const_iterator              begin() const noexcept {
+                                    return const_iterator(this, this->next_live(0)); }
+    const_iterator              end() const noexcept { return const_iterator(this, data.size()); }
+    const_reverse_iterator      rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator      rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_iterator              cbegin() const noexcept { return begin(); }
+    const_iterator              cend() const noexcept { return end(); }
+    const_reverse_iterator      crbegin() const noexcept { return rbegin(); }
+    const_reverse_iterator      crend() const noexcept { return rend(); }
+
+    reference front() const noexcept { return *begin(); }
+    reference back() const noexcept { return *rbegin(); }
+
+    const_iterator find(const T &a) const {
+        auto i = find_elem(a);
+        return const_iterator(this, i == npos ? data.size() : i); }
+    size_type count(const T &a) const { return find_elem(a) != npos; }
+
+    std::pair<iterator, bool> insert(const T &v) {
+        auto i = find_elem(v);
+        if (i != npos)
+            return std::make_pair(iterator(this, i), false);
+        return std::make_pair(iterator(this, append(v)), true); }
+    std::pair<iterator, bool> insert(T &&v) {
+        auto i = find_elem(v);
+        if (i != npos)
+            return std::make_pair(iterator(this, i), false);
+        return std::make_pair(iterator(this, append(std::move(v))), true); }
+    template<class InputIterator> void insert(InputIterator b, InputIterator e) {
+        for (; b != e; ++b) insert(*b); }
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args &&... args) {
+        return insert(T(std::forward<Args>(args)...)); }
+    /// insert @v, moving it to the end if it is already present
+    void push_back(const T &v) {
+        erase(v);
+        append(v); }
+
+    iterator erase(const_iterator pos) {
+        this->erase_elem(pos.idx);
+        return iterator(this, this->next_live(pos.idx + 1)); }
+    size_type erase(const T &v) {
+        auto i = find_elem(v);
+        if (i == npos) return 0;
+        this->erase_elem(i);
+        return 1; }
+};
+
+template<class T, class H, class P, class A, class U> inline
+auto operator|=(hvec_set<T, H, P, A> &a, const U &b) -> decltype(b.begin(), a) {
+    for (auto &el : b) a.insert(el);
+    return a; }
+template<class T, class H, class P, class A, class U> inline
+auto operator-=(hvec_set<T, H, P, A> &a, const U &b) -> decltype(b.begin(), a) {
+    for (auto &el : b) a.erase(el);
+    return a; }
+template<class T, class H, class P, class A, class U> inline
+auto operator&=(hvec_set<T, H, P, A> &a, const U &b) -> decltype(b.begin(), a) {
+    for (auto it = a.begin(); it != a.end();) {
+        if (b.count(*it))
+            ++it;
+        else
+            it = a.erase(it); }
+    return a; }
+
+template<class T, class H, class P, class A, class U> inline
+auto contains(const hvec_set<T, H, P, A> &a, const U &b) -> decltype(b.begin(), true) {
+    for (auto &el : b) if (!a.count(el)) return false;
+    return true; }
+template<class T, class H, class P, class A, class U> inline
+auto intersects(const hvec_set<T, H, P, A> &a, const U &b) -> decltype(b.begin(), true) {
+    for (auto &el : b) if (a.count(el)) return true;
+    return false; }
+// overloads for non-const sets, which would otherwise pick contains() from lib/algorithm.h
+template<class T, class H, class P, class A, class U> inline
+auto contains(hvec_set<T, H, P, A> &a, const U &b) -> decltype(b.begin(), true) {
+    return contains(static_cast<const hvec_set<T, H, P, A> &>(a), b); }
+template<class T, class H, class P, class A, class U> inline
+auto intersects(hvec_set<T, H, P, A> &a, const U &b) -> decltype(b.begin(), true) {
+    return intersects(static_cast<const hvec_set<T, H, P, A> &>(a), b); }
+
+#endif /* LIB_HVEC_SET_H_ */
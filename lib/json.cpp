@@ -198,7 +198,7 @@ JsonObject* JsonObject::emplace(cstring label, IJson* value) {
                                      "for a label which already exists ")
                              + label.c_str() + " " + s.c_str());
     }
-    ordered_map<cstring, IJson*>::emplace(label, value);
+    hvec_map<cstring, IJson*>::emplace(label, value);
     return this;
 }
 
@@ -25,6 +25,7 @@ limitations under the License.
 #include "gtest/gtest_prod.h"
 #include "lib/big_int_util.h"
 #include "lib/cstring.h"
+#include "lib/hvec_map.h"
 #include "lib/ordered_map.h"
 #include "lib/castable.h"
 
@@ -128,7 +129,7 @@ class JsonArray final : public IJson, public std::vector<IJson*> {
     JsonArray(std::vector<IJson*> &data) : std::vector<IJson*>(data) {} // NOLINT
 };
 
-class JsonObject final : public IJson, public ordered_map<cstring, IJson*> {
+class JsonObject final : public IJson, public hvec_map<cstring, IJson*> {
     friend class Test::TestJson;
 
  public:
@@ -0,0 +1,90 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "parallel.h"
+
+#ifdef MULTITHREAD
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "gc.h"
+#endif  // MULTITHREAD
+
+namespace Util {
+
+static unsigned parallel_threads = 1;
+static thread_local bool in_parallel_for = false;
+
+unsigned parallelism() { return in_parallel_for ? 1 : parallel_threads; }
+
+bool inParallelFor() { return in_parallel_for; }
+
+/// Runs @fn(@i) as a call made by parallelFor.
+static void parallelCall(const std::function<void(size_t)> &fn, size_t i) {
+    struct restore {
+        bool was = in_parallel_for;
+        ~restore() { in_parallel_for = was; }
+    } restore;
+    in_parallel_for = true;
+    fn(i);
+}
+
+void setParallelism(unsigned threads) {
+#ifdef MULTITHREAD
+    if (threads == 0)
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    parallel_threads = threads;
+#else
+    (void)threads;
+#endif  // MULTITHREAD
+}
+
+void parallelFor(size_t count, std::function<void(size_t)> fn) {
+#ifdef MULTITHREAD
+    size_t threads = std::min<size_t>(parallelism(), count);
+    if (threads > 1) {
+        std::atomic<size_t> next(0);
+        std::exception_ptr failure;
+        std::mutex failure_lock;
+        auto work = [&]() {
+            for (size_t i; (i = next++) < count;) {
+                try {
+                    parallelCall(fn, i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> acquire(failure_lock);
+                    if (!failure) failure = std::current_exception();
+                    next = count; } } };
+        gc_start_threads();
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t)
+            workers.emplace_back([&work]() {
+                gc_register_thread();
+                work();
+                gc_unregister_thread(); });
+        work();
+        for (auto &w : workers) w.join();
+        gc_end_threads();
+        if (failure) std::rethrow_exception(failure);
+        return; }
+#endif  // MULTITHREAD
+    for (size_t i = 0; i < count; ++i)
+        parallelCall(fn, i);
+}
+
+}  // namespace Util
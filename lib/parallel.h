@@ -0,0 +1,43 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_PARALLEL_H_
+#define LIB_PARALLEL_H_
+
+#include <cstddef>
+#include <functional>
+
+namespace Util {
+
+/// Number of threads (including the calling one) that parallelFor may use.
+/// Always 1 unless the compiler is built with ENABLE_MULTITHREAD, and on the
+/// threads running the calls of a parallelFor, so nested loops run serially.
+unsigned parallelism();
+/// Set the number of threads; 0 means one per hardware thread.
+void setParallelism(unsigned threads);
+
+/// Call @fn(i) for each i in [0, @count), spreading the calls over up to
+/// parallelism() threads; returns when all calls are done.  If any call
+/// throws, no further calls are started and the first exception is rethrown
+/// on the calling thread.
+void parallelFor(size_t count, std::function<void(size_t)> fn);
+
+/// True while the current thread runs a call made by parallelFor.
+bool inParallelFor();
+
+}  // namespace Util
+
+#endif /* LIB_PARALLEL_H_ */
@@ -0,0 +1,255 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_PERSISTENT_MAP_H_
+#define LIB_PERSISTENT_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/// Ordered map whose copies share their contents: copying is O(1), and
+/// changing one copy (set/erase, O(log n)) copies only the path to the
+/// changed entry.  Meant for the dataflow state of ControlFlowVisitors,
+/// which is copied at every branch (flow_clone) and merged where branches
+/// join (flow_merge): merge_from only visits the entries that differ
+/// between the two copies.
+///
+/// It is a treap whose priorities are the hashes of the keys, so all maps
+/// with the same keys have the same shape, and the parts of two copies
+/// that were not changed since they were copied are the same nodes.
+/// Values cannot be changed in place; iterators and references remain
+/// valid (and see the old contents) when the map is changed.
+template <class K, class V, class COMP = std::less<K>, class HASH = std::hash<K>>
+class persistent_map {
+ public:
+    typedef K                           key_type;
+    typedef V                           mapped_type;
+    typedef std::pair<const K, V>       value_type;
+    typedef const value_type            &const_reference;
+    typedef size_t                      size_type;
+
+ private:
+    struct node;
+    typedef std::shared_ptr<const node> node_ptr;
+    struct node {
+        value_type      kv;
+        size_t          priority;
+        node_ptr        left, right;
+        node(const K &k, const V &v, size_t p, node_ptr l, node_ptr r)
+        : kv(k, v), priority(p), left(std::move(l)), right(std::move(r)) {}
+    };
+
+    node_ptr            root;
+    size_t              elements = 0;
+    COMP                comp;
+    HASH                hash;
+
+    /// std::hash is often the identity, which would make the tree a list
+    size_t priority(const K &k) const {
+        uint64_t h = hash(k);
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return h ^ (h >> 31); }
+    bool above(const node *a, const node *b) const {
+        return a->priority != b->priority ? a->priority > b->priority
+                                          : comp(a->kv.first, b->kv.first); }
+    static node_ptr make(const node *n, node_ptr l, node_ptr r) {
+        return std::make_shared<node>(n->kv.first, n->kv.second, n->priority,
+                                      std::move(l), std::move(r)); }
+
+    node_ptr insert(const node_ptr &t, const K &k, const V &v) {
+        if (!t) {
+            ++elements;
+            return std::make_shared<node>(k, v, priority(k), nullptr, nullptr); }
+        if (comp(k, t->kv.first)) {
+            auto l = insert(t->left, k, v);
+            if (above(l.get(), t.get()))
+                return make(l.get(), l->left, make(t.get(), l->right, t->right));
+            return make(t.get(), std::move(l), t->right); }
+        if (comp(t->kv.first, k)) {
+            auto r = insert(t->right, k, v);
+            if (above(r.get(), t.get()))
+                return make(r.get(), make(t.get(), t->left, r->left), r->right);
+            return make(t.get(), t->left, std::move(r)); }
+        return std::make_shared<node>(t->kv.first, v, t->priority, t->left, t->right);
+    }
+    node_ptr join(const node_ptr &l, const node_ptr &r) const {
+        if (!l) return r;
+        if (!r) return l;
+        if (above(l.get(), r.get()))
+            return make(l.get(), l->left, join(l->right, r));
+        return make(r.get(), join(l, r->left), r->right);
+    }
+    node_ptr remove(const node_ptr &t, const K &k) {
+        if (!t) return t;
+        if (comp(k, t->kv.first)) {
+            auto l = remove(t->left, k);
+            return l == t->left ? t : make(t.get(), std::move(l), t->right); }
+        if (comp(t->kv.first, k)) {
+            auto r = remove(t->right, k);
+            return r == t->right ? t : make(t.get(), t->left, std::move(r)); }
+        --elements;
+        return join(t->left, t->right);
+    }
+
+    /// Merges the subtree @t of this map, holding the keys in (@lo, @hi), with
+    /// @o, a subtree of the other map holding all its keys in that range.
+    template<class FN>
+    node_ptr merge(const node_ptr &t, const node *o, const K *lo, const K *hi, FN &fn) const {
+        if (!t || t.get() == o) return t;
+        while (o) {
+            if (lo && !comp(*lo, o->kv.first))
+                o = o->right.get();
+            else if (hi && !comp(o->kv.first, *hi))
+                o = o->left.get();
+            else
+                break; }
+        if (t.get() == o) return t;
+        const K &key = t->kv.first;
+        const node *ol = o, *orr = o;
+        const V *other = nullptr;
+        if (o && !comp(key, o->kv.first) && !comp(o->kv.first, key)) {
+            other = &o->kv.second;
+            ol = o->left.get();
+            orr = o->right.get();
+        } else {
+            for (auto n = o; n; n = comp(key, n->kv.first) ? n->left.get() : n->right.get()) {
+                if (!comp(n->kv.first, key) && !comp(key, n->kv.first)) {
+                    other = &n->kv.second;
+                    break; } } }
+        auto l = merge(t->left, ol, lo, &key, fn);
+        auto r = merge(t->right, orr, &key, hi, fn);
+        V value = t->kv.second;
+        if (fn(key, value, other))
+            return std::make_shared<node>(key, value, t->priority, std::move(l), std::move(r));
+        if (l == t->left && r == t->right) return t;
+        return make(t.get(), std::move(l), std::move(r));
+    }
+
+ public:
+    class const_iterator {
+        friend class persistent_map;
+        node_ptr                        root;   // keeps the nodes alive
+        std::vector<const node *>       path;   // ancestors still to visit; top is current
+        void descend(const node *n) {
+            for (; n; n = n->left.get()) path.push_back(n); }
+
+     public:
+        typedef std::forward_iterator_tag       iterator_category;
+        typedef typename persistent_map::value_type value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef const value_type                *pointer;
+        typedef const value_type                &reference;
+
+        const_iterator() = default;
+        reference operator*() const { return path.back()->kv; }
+        pointer operator->() const { return &path.back()->kv; }
+        const_iterator &operator++() {
+            auto n = path.back();
+            path.pop_back();
+            descend(n->right.get());
+            return *this; }
+        const_iterator operator++(int) { auto rv = *this; ++*this; return rv; }
+        bool operator==(const const_iterator &a) const {
+            if (path.empty() || a.path.empty()) return path.empty() == a.path.empty();
+            return path.back() == a.path.back(); }
+        bool operator!=(const const_iterator &a) const { return !(*this == a); }
+    };
+    typedef const_iterator iterator;
+
+    persistent_map() = default;
+    persistent_map(std::initializer_list<value_type> il) {
+        for (auto &kv : il) set(kv.first, kv.second); }
+
+    bool empty() const { return elements == 0; }
+    size_type size() const { return elements; }
+    void clear() { root.reset(); elements = 0; }
+
+    const_iterator begin() const {
+        const_iterator rv;
+        rv.root = root;
+        rv.descend(root.get());
+        return rv; }
+    const_iterator end() const { return const_iterator(); }
+    /// First element with a key not less than (if @strict, greater than) @k.
+    const_iterator lower_bound(const K &k, bool strict = false) const {
+        const_iterator rv;
+        rv.root = root;
+        for (auto n = root.get(); n;) {
+            if (strict ? comp(k, n->kv.first) : !comp(n->kv.first, k)) {
+                rv.path.push_back(n);
+                n = n->left.get();
+            } else {
+                n = n->right.get(); } }
+        return rv; }
+    const_iterator upper_bound(const K &k) const { return lower_bound(k, true); }
+    const_iterator find(const K &k) const {
+        auto rv = lower_bound(k);
+        if (rv != end() && comp(k, rv->first)) return end();
+        return rv; }
+    size_type count(const K &k) const { return lookup(k) != nullptr; }
+    /// @returns the value for @k, or null if there is none.
+    const V *lookup(const K &k) const {
+        for (auto n = root.get(); n; n = comp(k, n->kv.first) ? n->left.get() : n->right.get())
+            if (!comp(n->kv.first, k) && !comp(k, n->kv.first))
+                return &n->kv.second;
+        return nullptr; }
+
+    /// Sets the value for @k, adding it if needed.
+    void set(const K &k, const V &v) { root = insert(root, k, v); }
+    /// Removes @k; @returns the number of elements removed.
+    size_type erase(const K &k) {
+        auto before = elements;
+        root = remove(root, k);
+        return before - elements; }
+
+    /// Calls @fn(key, value, other) for the entries of this map that may
+    /// differ from @other: @value is a copy of the entry's value, and @other
+    /// points to the value of the same key in @other, or is null.  If @fn
+    /// returns true, @value replaces the entry's value.  The entries that
+    /// this map still shares with @other are skipped, so merging a value
+    /// with itself must not change it.  Keys only in @other are ignored.
+    template<class FN> void merge_from(const persistent_map &other, FN fn) {
+        root = merge(root, other.root.get(), nullptr, nullptr, fn); }
+
+    /// True if the maps are the same copy, changed in the same way.
+    bool shares(const persistent_map &other) const { return root == other.root; }
+};
+
+// The get() and getref() of lib/map.h for persistent maps.  They go in the
+// same GetImpl namespace as the overloads for the other maps (see there), so
+// that a call picks among all of them in the same way.
+namespace GetImpl {
+
+template<class K, class T, class V, class Comp, class Hash>
+inline V get(const persistent_map<K, V, Comp, Hash> &m, T key, V def = V()) {
+    if (auto v = m.lookup(key)) return *v;
+    return def; }
+
+template<class K, class T, class V, class Comp, class Hash>
+inline const V *getref(const persistent_map<K, V, Comp, Hash> &m, T key) {
+    return m.lookup(key); }
+
+}  // namespace GetImpl
+using namespace GetImpl;  // NOLINT(build/namespaces)
+
+#endif /* LIB_PERSISTENT_MAP_H_ */
@@ -0,0 +1,349 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "eliminateCommonSubexpressions.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ir/pass_profile.h"
+
+namespace P4 {
+
+namespace {
+
+/// @returns the number of operators in @e, or -1 if it is not a pure
+/// expression that can be kept in a temporary.
+int operations(const IR::Expression *e) {
+    if (e->is<IR::Literal>() || e->is<IR::PathExpression>() || e->is<IR::TypeNameExpression>())
+        return 0;
+    if (auto *m = e->to<IR::Member>())
+        return operations(m->expr);
+    if (auto *ai = e->to<IR::ArrayIndex>()) {
+        int l = operations(ai->left), r = operations(ai->right);
+        if (l < 0 || r < 0) return -1;
+        return ai->right->is<IR::Constant>() ? l : l + r + 1; }
+    if (auto *sl = e->to<IR::Slice>()) {
+        int rv = operations(sl->e0);
+        return rv < 0 ? rv : rv + 1; }
+    if (auto *u = e->to<IR::Operation_Unary>()) {
+        int rv = operations(u->expr);
+        return rv < 0 ? rv : rv + 1; }
+    if (auto *b = e->to<IR::Operation_Binary>()) {
+        int l = operations(b->left), r = operations(b->right);
+        return l < 0 || r < 0 ? -1 : l + r + 1; }
+    if (auto *t = e->to<IR::Operation_Ternary>()) {
+        int a = operations(t->e0), b = operations(t->e1), c = operations(t->e2);
+        return a < 0 || b < 0 || c < 0 ? -1 : a + b + c + 1; }
+    return -1;
+}
+
+/// Computes the location @e refers to as a path like "h.f[2].g", ending in
+/// '*' if it is a whole header stack accessed with a non-constant index.
+/// @returns false if @e is not a location.
+bool location(const IR::Expression *e, std::string &path) {
+    if (auto *pe = e->to<IR::PathExpression>()) {
+        path = pe->path->name.name.c_str();
+        return true; }
+    if (auto *m = e->to<IR::Member>()) {
+        if (!location(m->expr, path)) return false;
+        if (path.back() != '*') {
+            path += ".";
+            path += m->member.name.c_str(); }
+        return true; }
+    if (auto *ai = e->to<IR::ArrayIndex>()) {
+        if (!location(ai->left, path)) return false;
+        if (path.back() == '*') return true;
+        if (auto *k = ai->right->to<IR::Constant>())
+            path += "[" + k->value.str() + "]";
+        else
+            path += "*";
+        return true; }
+    if (auto *sl = e->to<IR::Slice>())
+        return location(sl->e0, path);
+    return false;
+}
+
+/// True if the locations @a and @b overlap: one of them contains the other.
+bool overlap(const std::string &a, const std::string &b) {
+    size_t la = a.size() - (a.back() == '*'), lb = b.size() - (b.back() == '*');
+    size_t len = std::min(la, lb);
+    if (a.compare(0, len, b, 0, len) != 0) return false;
+    if (la == lb) return true;
+    char next = la < lb ? b[len] : a[len];
+    return next == '.' || next == '[' || next == '*';
+}
+
+/// The locations read by the pure expression @e.
+void reads(const IR::Expression *e, std::vector<std::string> &out) {
+    std::string path;
+    if (location(e, path)) {
+        out.push_back(path);
+        // and those read by the indexes
+        for (auto *inner = e; !inner->is<IR::PathExpression>();) {
+            if (auto *ai = inner->to<IR::ArrayIndex>()) {
+                reads(ai->right, out);
+                inner = ai->left;
+            } else if (auto *m = inner->to<IR::Member>()) {
+                inner = m->expr;
+            } else {
+                inner = inner->to<IR::Slice>()->e0; } }
+    } else if (auto *u = e->to<IR::Operation_Unary>()) {
+        reads(u->expr, out);
+    } else if (auto *b = e->to<IR::Operation_Binary>()) {
+        reads(b->left, out);
+        reads(b->right, out);
+    } else if (auto *t = e->to<IR::Operation_Ternary>()) {
+        reads(t->e0, out);
+        reads(t->e1, out);
+        reads(t->e2, out); }
+}
+
+/// True for the method calls that cannot change any location: isValid.
+bool readsOnly(const IR::MethodCallExpression *mce) {
+    auto *m = mce->method->to<IR::Member>();
+    return m && m->member == IR::Type_Header::isValid && mce->arguments->empty();
+}
+
+/// The locations written by a statement, including its nested statements.
+class Writes : public Inspector {
+ public:
+    bool all = false;
+    std::vector<std::string> locations;
+
+    void write(const IR::Expression *e) {
+        std::string path;
+        if (location(e, path))
+            locations.push_back(path);
+        else
+            all = true; }
+    bool preorder(const IR::Expression *) override { return !all; }
+    void postorder(const IR::AssignmentStatement *s) override { write(s->left); }
+    void postorder(const IR::Declaration_Variable *d) override {
+        locations.push_back(d->name.name.c_str()); }
+    void postorder(const IR::MethodCallExpression *mce) override {
+        auto *m = mce->method->to<IR::Member>();
+        if (readsOnly(mce)) return;
+        if (m && mce->arguments->empty() &&
+            (m->member == IR::Type_Header::setValid || m->member == IR::Type_Header::setInvalid))
+            write(m->expr);
+        else
+            all = true; }
+};
+
+/// True if @e calls a method that may write some location.
+bool writes(const IR::Expression *e) {
+    Writes w;
+    e->apply(w);
+    return w.all || !w.locations.empty();
+}
+
+/// True if @e is (part of) a location, so may be written by a method call.
+bool isLocation(const IR::Expression *e) {
+    std::string path;
+    return location(e, path);
+}
+
+/// The expressions a statement evaluates before it writes anything.
+std::vector<const IR::Expression *> evaluated(const IR::StatOrDecl *s) {
+    std::vector<const IR::Expression *> rv;
+    if (auto *as = s->to<IR::AssignmentStatement>()) {
+        rv.push_back(as->right);
+    } else if (auto *is = s->to<IR::IfStatement>()) {
+        rv.push_back(is->condition);
+    } else if (auto *ss = s->to<IR::SwitchStatement>()) {
+        rv.push_back(ss->expression);
+    } else if (auto *dv = s->to<IR::Declaration_Variable>()) {
+        if (dv->initializer) rv.push_back(dv->initializer);
+    } else if (auto *mcs = s->to<IR::MethodCallStatement>()) {
+        for (auto *arg : *mcs->methodCall->arguments)
+            if (!isLocation(arg->expression)) rv.push_back(arg->expression); }
+    // a call within the expressions may write locations read after it
+    for (auto *e : rv)
+        if (writes(e)) return {};
+    return rv;
+}
+
+/// Replaces the expressions equiv to @expr by references to @temp.
+class Replace : public Transform {
+    const IR::Expression *expr;
+    cstring temp;
+
+ public:
+    Replace(const IR::Expression *expr, cstring temp) : expr(expr), temp(temp) {}
+    const IR::Node *preorder(IR::Expression *e) override {
+        if (!getOriginal<IR::Expression>()->equiv(*expr)) return e;
+        prune();
+        return new IR::PathExpression(e->srcInfo, expr->type, new IR::Path(IR::ID(temp))); }
+};
+
+/// Replaces the expressions that @s evaluates (see `evaluated`) equiv to
+/// @expr by @temp.
+const IR::StatOrDecl *replace(const IR::StatOrDecl *s, const IR::Expression *expr,
+                              cstring temp) {
+    Replace r(expr, temp);
+    if (auto *as = s->to<IR::AssignmentStatement>()) {
+        auto *right = as->right->apply(r);
+        if (right == as->right) return s;
+        auto *rv = as->clone();
+        rv->right = right;
+        return rv; }
+    if (auto *is = s->to<IR::IfStatement>()) {
+        auto *condition = is->condition->apply(r);
+        if (condition == is->condition) return s;
+        auto *rv = is->clone();
+        rv->condition = condition;
+        return rv; }
+    if (auto *ss = s->to<IR::SwitchStatement>()) {
+        auto *expression = ss->expression->apply(r);
+        if (expression == ss->expression) return s;
+        auto *rv = ss->clone();
+        rv->expression = expression;
+        return rv; }
+    if (auto *dv = s->to<IR::Declaration_Variable>()) {
+        if (!dv->initializer) return s;
+        auto *initializer = dv->initializer->apply(r);
+        if (initializer == dv->initializer) return s;
+        auto *rv = dv->clone();
+        rv->initializer = initializer;
+        return rv; }
+    if (auto *mcs = s->to<IR::MethodCallStatement>()) {
+        auto *args = new IR::Vector<IR::Argument>;
+        bool changed = false;
+        for (auto *arg : *mcs->methodCall->arguments) {
+            if (isLocation(arg->expression)) {
+                args->push_back(arg);
+                continue; }
+            auto *expression = arg->expression->apply(r);
+            if (expression != arg->expression) {
+                changed = true;
+                arg = new IR::Argument(arg->srcInfo, arg->name, expression); }
+            args->push_back(arg); }
+        if (!changed) return s;
+        auto *call = mcs->methodCall->clone();
+        call->arguments = args;
+        auto *rv = mcs->clone();
+        rv->methodCall = call;
+        return rv; }
+    return s;
+}
+
+/// An expression computed by a range of statements, all reading the same values.
+struct Computation {
+    const IR::Expression        *expr;
+    size_t                      first, last;    // statements computing it
+    unsigned                    count;          // times it is computed
+    int                         cost;           // operators
+    std::vector<std::string>    reads;
+    size_t                      order;          // for ties: order of the first computation
+
+    int savings() const { return static_cast<int>(count - 1) * cost - 1; }
+};
+
+struct hash_t {
+    size_t operator()(const IR::Expression *e) const { return e->hash(); } };
+struct equiv_t {
+    bool operator()(const IR::Expression *a, const IR::Expression *b) const {
+        return a->equiv(*b); } };
+
+typedef std::unordered_map<const IR::Expression *, Computation, hash_t, equiv_t> Available;
+
+/// Adds the computations of @e and its subexpressions, made by statement
+/// @stat, to @available.  @order numbers the computations seen.
+void addComputations(const IR::Expression *e, size_t stat, Available &available, size_t &order) {
+    int cost = operations(e);
+    if (cost > 0 && e->type && (e->type->is<IR::Type_Bits>() || e->type->is<IR::Type_Boolean>())) {
+        auto it = available.find(e);
+        if (it != available.end()) {
+            it->second.count++;
+            it->second.last = stat;
+        } else {
+            Computation c = { e, stat, stat, 1, cost, {}, order++ };
+            reads(e, c.reads);
+            // expressions of constants are left to constant folding
+            if (!c.reads.empty())
+                available.emplace(e, c); } }
+    if (cost < 0) return;
+    if (auto *u = e->to<IR::Operation_Unary>()) {
+        addComputations(u->expr, stat, available, order);
+    } else if (auto *b = e->to<IR::Operation_Binary>()) {
+        addComputations(b->left, stat, available, order);
+        addComputations(b->right, stat, available, order);
+    } else if (auto *t = e->to<IR::Operation_Ternary>()) {
+        addComputations(t->e0, stat, available, order);
+        addComputations(t->e1, stat, available, order);
+        addComputations(t->e2, stat, available, order); }
+}
+
+/// @returns the computation of @components that saves the most operations,
+/// or one with a null expr if there is none.
+Computation bestComputation(const IR::IndexedVector<IR::StatOrDecl> &components) {
+    Available available;
+    Computation best = { nullptr, 0, 0, 0, 0, {}, 0 };
+    size_t order = 0;
+    auto retire = [&](const Computation &c) {
+        if (c.count < 2 || c.savings() <= 0) return;
+        if (!best.expr || c.savings() > best.savings() ||
+            (c.savings() == best.savings() && c.order < best.order))
+            best = c; };
+    for (size_t i = 0; i < components.size(); ++i) {
+        auto *s = components.at(i);
+        for (auto *e : evaluated(s))
+            addComputations(e, i, available, order);
+        Writes w;
+        s->apply(w);
+        for (auto it = available.begin(); it != available.end();) {
+            bool killed = w.all;
+            for (auto &loc : w.locations) {
+                for (auto &read : it->second.reads)
+                    if ((killed = overlap(loc, read))) break;
+                if (killed) break; }
+            if (killed) {
+                retire(it->second);
+                it = available.erase(it);
+            } else {
+                ++it; } } }
+    for (auto &kv : available)
+        retire(kv.second);
+    return best;
+}
+
+}  // namespace
+
+const IR::Node *DoEliminateCommonSubexpressions::postorder(IR::BlockStatement *block) {
+    static auto &temporaries = PassProfile::counter("EliminateCommonSubexpressions.temporaries");
+    for (;;) {
+        auto best = bestComputation(block->components);
+        if (!best.expr) break;
+        auto name = refMap->newName("tmp");
+        auto *type = best.expr->type;
+        LOG2("Computing " << best.expr << " " << best.count << " times, in " << name);
+        IR::IndexedVector<IR::StatOrDecl> components;
+        for (size_t i = 0; i < block->components.size(); ++i) {
+            auto *s = block->components.at(i);
+            if (i == best.first)
+                components.push_back(new IR::Declaration_Variable(
+                    best.expr->srcInfo, IR::ID(name), type, best.expr));
+            if (i >= best.first && i <= best.last)
+                s = replace(s, best.expr, name);
+            components.push_back(s); }
+        block->components = components;
+        ++temporaries; }
+    return block;
+}
+
+}  // namespace P4
@@ -0,0 +1,81 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _MIDEND_ELIMINATECOMMONSUBEXPRESSIONS_H_
+#define _MIDEND_ELIMINATECOMMONSUBEXPRESSIONS_H_
+
+#include "ir/ir.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+
+namespace P4 {
+
+/**
+ * Computes once the pure expressions that a sequence of statements computes
+ * several times, in a temporary:
+
+x = (a & 0xf) + b;
+y = (a & 0xf) + b;
+
+becomes
+
+bit<8> tmp = (a & 0xf) + b;
+x = tmp;
+y = tmp;
+
+ * The statements of each block are numbered in order; two computations of
+ * an expression are the same value when no statement between them writes a
+ * location the expression reads.  Expressions are compared structurally,
+ * using the IR hash and equiv.  Calls of methods, actions, functions and
+ * tables may write anything, so are never part of the expressions and end
+ * the range in which a value can be reused.  Only the expressions evaluated
+ * by the statements of the block itself are considered (assigned values,
+ * conditions, switch expressions, initializers and the arguments of method
+ * call statements), not those in nested blocks, which are handled on their
+ * own.
+ *
+ * An expression gets a temporary if this saves operations: one with N
+ * operators computed K times costs N * K, and N + 1 with the temporary.
+ * Larger expressions are eliminated first.
+ *
+ * Controls and actions are handled; parsers and functions are not.
+ *
+ * @pre Expressions have their types (TypeChecking with updateExpressions).
+ * @post The temporaries are declared, with initializers, in the blocks where
+ * they are used; MoveDeclarations can move them to the top.
+ */
+class DoEliminateCommonSubexpressions : public Transform {
+    ReferenceMap *refMap;
+
+ public:
+    explicit DoEliminateCommonSubexpressions(ReferenceMap *refMap) : refMap(refMap) {
+        CHECK_NULL(refMap); setName("DoEliminateCommonSubexpressions"); }
+    const IR::Node *preorder(IR::P4Parser *parser) override { prune(); return parser; }
+    const IR::Node *preorder(IR::Function *function) override { prune(); return function; }
+    const IR::Node *postorder(IR::BlockStatement *block) override;
+};
+
+class EliminateCommonSubexpressions : public PassManager {
+ public:
+    EliminateCommonSubexpressions(ReferenceMap *refMap, TypeMap *typeMap) {
+        passes.push_back(new TypeChecking(refMap, typeMap, true));
+        passes.push_back(new DoEliminateCommonSubexpressions(refMap));
+        setName("EliminateCommonSubexpressions");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_ELIMINATECOMMONSUBEXPRESSIONS_H_ */
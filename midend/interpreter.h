@@ -83,7 +83,8 @@ class ValueMap final : public IHasDbPrint {
             result->map.emplace(v.first, v.second->clone());
         return result;
     }
-    ValueMap* filter(std::function<bool(const IR::IDeclaration*, const SymbolicValue*)> filter) {
+    ValueMap* filter(
+            std::function<bool(const IR::IDeclaration*, const SymbolicValue*)> filter) const {
         auto result = new ValueMap();
         for (auto v : map)
             if (filter(v.first, v.second))
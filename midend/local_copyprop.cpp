@@ -161,14 +161,17 @@ class DoLocalCopyPropagation::RewriteTableKeys : public Transform {
 void DoLocalCopyPropagation::flow_merge(Visitor &a_) {
     auto &a = dynamic_cast<DoLocalCopyPropagation &>(a_);
     BUG_CHECK(working == a.working, "inconsitent DoLocalCopyPropagation state on merge");
-    for (auto &var : available) {
-        if (auto merge = ::getref(a.available, var.first)) {
-            if (merge->val != var.second.val)
-                var.second.val = nullptr;
+    // Only the variables changed by one branch or the other are visited.
+    available.merge_from(a.available, [](cstring, VarInfo &var, const VarInfo *merge) {
+        auto old = var;
+        if (merge) {
+            if (merge->val != var.val)
+                var.val = nullptr;
             if (merge->live)
-                var.second.live = true;
+                var.live = true;
         } else {
-            var.second.val = nullptr; } }
+            var.val = nullptr; }
+        return var != old; });
     need_key_rewrite |= a.need_key_rewrite;
 }
 
@@ -184,36 +187,43 @@ bool DoLocalCopyPropagation::name_overlap(cstring name1, cstring name2) {
 
 void DoLocalCopyPropagation::forOverlapAvail(cstring name,
                                              std::function<void(cstring, VarInfo *)> fn) {
+    auto call = [this, &fn](const std::pair<const cstring, VarInfo> &var) {
+        auto info = var.second;
+        fn(var.first, &info);
+        update(var.first, var.second, info); };
     for (const char *pfx = name.c_str(); *pfx; pfx += strspn(pfx, ".[")) {
         pfx += strcspn(pfx, ".[");
         auto it = available.find(name.before(pfx));
         if (it != available.end())
-            fn(it->first, &it->second); }
+            call(*it); }
+    // changing the map leaves this iteration over the old contents
     for (auto it = available.upper_bound(name); it != available.end(); ++it) {
         if (!it->first.startsWith(name) || !strchr(".[", it->first.get(name.size())))
             break;
-        fn(it->first, &it->second); }
+        call(*it); }
 }
 
 void DoLocalCopyPropagation::dropValuesUsing(cstring name) {
     LOG6("dropValuesUsing(" << name << ")");
     for (auto &var : available) {
         LOG7("  checking " << var.first << " = " << var.second.val);
+        auto info = var.second;
         if (name_overlap(var.first, name)) {
             LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << "as " << name <<
                  " is being assigned to");
-            var.second.val = nullptr;
+            info.val = nullptr;
         } else if (var.second.val && exprUses(var.second.val, name)) {
             LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << var.first <<
                  " as it uses " << name);
-            var.second.val = nullptr; } }
+            info.val = nullptr; }
+        update(var.first, var.second, info); }
 }
 
 void DoLocalCopyPropagation::visit_local_decl(const IR::Declaration_Variable *var) {
     LOG4("Visiting " << var);
     if (available.count(var->name))
         BUG("duplicate var declaration for %s", var->name);
-    auto &local = available[var->name];
+    VarInfo local;
     local.local = true;
     if (var->initializer) {
         if (!hasSideEffects(var->initializer)) {
@@ -221,6 +231,7 @@ void DoLocalCopyPropagation::visit_local_decl(const IR::Declaration_Variable *va
             local.val = var->initializer;
         } else {
             local.live = true; } }
+    available.set(var->name, local);
 }
 
 const IR::Node *DoLocalCopyPropagation::postorder(IR::Declaration_Variable *var) {
@@ -269,7 +280,9 @@ const IR::Expression *DoLocalCopyPropagation::copyprop_name(
             LOG3("  policy rejects propagation of " << name << ": " << var->val);
         } else {
             LOG4("  using " << name << " with no propagated value"); }
-        var->live = true; }
+        auto live = *var;
+        live.live = true;
+        update(name, *var, live); }
     forOverlapAvail(name, [name](cstring, VarInfo *var) {
         LOG4("  using part of " << name);
         var->live = true; });
@@ -346,7 +359,9 @@ IR::AssignmentStatement *DoLocalCopyPropagation::postorder(IR::AssignmentStateme
                  * may make things worse rather than better */
                 return as; }
             LOG3("  saving value for " << dest << ": " << as->right);
-            available[dest].val = as->right;
+            auto var = ::get(available, dest);
+            var.val = as->right;
+            available.set(dest, var);
         } else {
             LOG3("Can't copyprop " << as->right << " due to side effects"); }
     } else {
@@ -461,8 +476,10 @@ IR::MethodCallExpression *DoLocalCopyPropagation::postorder(IR::MethodCallExpres
     for (auto &var : available) {
         if (!var.second.local) {
             LOG7("    may access non-local " << var.first);
-            var.second.val = nullptr;
-            var.second.live = true;
+            auto info = var.second;
+            info.val = nullptr;
+            info.live = true;
+            update(var.first, var.second, info);
             if (inferForFunc) {
                 inferForFunc->reads.insert(var.first);
                 inferForFunc->writes.insert(var.first); } } }
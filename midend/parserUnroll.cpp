@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
 #include "parserUnroll.h"
 #include "interpreter.h"
 #include "lib/hash.h"
@@ -49,49 +53,24 @@ size_t StackVariableHash::operator()(const StackVariable& var) const {
 
 /// The main class for parsers' states key for visited checking.
 struct VisitedKey {
-    cstring                           name;     // name of a state.
-    StackVariableMap                  indexes;  // indexes of header stacks.
-
-    VisitedKey(cstring name, StackVariableMap& indexes)
-        : name(name), indexes(indexes) {}
-
-    explicit VisitedKey(const ParserStateInfo* stateInfo) {
-        CHECK_NULL(stateInfo);
-        name = stateInfo->state->name.name;
-        indexes = stateInfo->statesIndexes;
+    cstring                                 name;     // name of a state.
+    /// indexes of header stacks, sorted by the names of the stacks.
+    std::vector<std::pair<cstring, size_t>> indexes;
+
+    VisitedKey(cstring name, const StackVariableMap& indexes) : name(name) {
+        for (auto& i : indexes)
+            this->indexes.emplace_back(i.first.toString(), i.second);
+        std::sort(this->indexes.begin(), this->indexes.end());
     }
 
-    /// Checks of two states to be less. If @a name < @a e.name then it returns @a true.
-    /// if @a name > @a e.name then it returns false.
-    /// If @a name is equal @a e.name then it checks the values of the headers stack indexes.
-    /// For both map of header stacks' indexes it creates map of pairs of values for each
-    /// header stack index.
-    /// If some indexes are missing then it cosiders them as -1.
-    /// Next, it continues checking each pair in a intermidiate map with the same approach
-    /// as for @a name and @a e.name.
+    explicit VisitedKey(const ParserStateInfo* stateInfo)
+        : VisitedKey(stateInfo->state->name.name, stateInfo->statesIndexes) {}
+
+    /// Orders the keys by state name, then by the indexes of the header stacks.
+    /// The indexes are put in a canonical order once, when the key is made, as keys
+    /// are compared many times in the visited maps.
     bool operator<(const VisitedKey& e) const {
-        if (name < e.name)
-            return true;
-        if (name > e.name)
-            return false;
-        std::unordered_map<StackVariable, std::pair<size_t, size_t>, StackVariableHash > mp;
-        for (auto& i1 : indexes) {
-            mp.emplace(i1.first, std::make_pair(i1.second, -1));
-        }
-        for (auto& i2 : e.indexes) {
-            auto ref = mp.find(i2.first);
-            if (ref == mp.end())
-                mp.emplace(i2.first, std::make_pair(-1, i2.second));
-            else
-                ref->second.second = i2.second;
-        }
-        for (auto j : mp) {
-            if (j.second.first < j.second.second)
-                return true;
-            if (j.second.first > j.second.second)
-                return false;
-        }
-        return false;
+        return std::tie(name, indexes) < std::tie(e.name, e.indexes);
     }
 };
 
@@ -308,6 +287,9 @@ class ParserSymbolicInterpreter {
     bool                unroll;
     StatesVisitedMap    visitedStates;
     bool&               wasError;
+    size_t              explored = 0;   // states taken from the worklist
+    size_t              skipped = 0;    // ... of which already visited
+    size_t              evaluated = 0;  // ... of which symbolically executed
 
     ValueMap* initializeVariables() {
         wasError = false;
@@ -350,14 +332,14 @@ class ParserSymbolicInterpreter {
         return result;
     }
 
+    /// The successors of a state share its values: @values is not changed afterwards.
     ParserStateInfo* newStateInfo(const ParserStateInfo* predecessor,
-                                  cstring stateName, ValueMap* values, size_t index) {
+                                  cstring stateName, const ValueMap* values, size_t index) {
         if (stateName == IR::ParserState::accept ||
             stateName == IR::ParserState::reject)
             return nullptr;
         auto state = structure->get(stateName);
-        auto pi = new ParserStateInfo(stateName, parser, state, predecessor, values->clone(),
-                                      index);
+        auto pi = new ParserStateInfo(stateName, parser, state, predecessor, values, index);
         synthesizedParser->add(pi);
         return pi;
     }
@@ -676,7 +658,6 @@ class ParserSymbolicInterpreter {
     EvaluationStateResult evaluateState(ParserStateInfo* state,
                                         std::unordered_set<cstring> &newStates) {
         LOG1("Analyzing " << dbp(state->state));
-        auto valueMap = state->before->clone();
         IR::IndexedVector<IR::StatOrDecl> components;
         IR::ID newName;
         if (unroll) {
@@ -685,6 +666,8 @@ class ParserSymbolicInterpreter {
                 return EvaluationStateResult(nullptr, false);
             newStates.insert(newName);
         }
+        ++evaluated;
+        auto valueMap = state->before->clone();
         for (auto s : state->state->components) {
             auto* newComponent = executeStatement(state, s, valueMap);
             if (!newComponent)
@@ -756,16 +739,20 @@ class ParserSymbolicInterpreter {
             auto stateInfo = toRun.back();
             toRun.pop_back();
             LOG1("Symbolic evaluation of " << stateChain(stateInfo));
+            ++explored;
             // checking visited state, loop state, and the reachable states with needed header stack
             // operators.
-            if (visited.count(VisitedKey(stateInfo)) &&
+            VisitedKey key(stateInfo);
+            if (visited.count(key) &&
                 !stateInfo->scenarioStates.count(stateInfo->name) &&
-                !structure->reachableHSUsage(stateInfo->state->name, stateInfo))
+                !structure->reachableHSUsage(stateInfo->state->name, stateInfo)) {
+                ++skipped;
                 continue;
+            }
             auto iHSNames = structure->statesWithHeaderStacks.find(stateInfo->name);
             if (iHSNames != structure->statesWithHeaderStacks.end())
                 stateInfo->scenarioHS.insert(iHSNames->second.begin(), iHSNames->second.end());
-            visited.insert(VisitedKey(stateInfo));  // add to visited map
+            visited.insert(key);  // add to visited map
             stateInfo->scenarioStates.insert(stateInfo->name);  // add to loops detection
             bool infLoop = checkLoops(stateInfo);
             if (infLoop) {
@@ -797,6 +784,9 @@ class ParserSymbolicInterpreter {
             }
             toRun.insert(toRun.end(), nextStates.first->begin(), nextStates.first->end());
         }
+        LOG1("Parser " << parser->externalName() << ": explored " << explored << " states, "
+             << skipped << " already visited, " << evaluated << " evaluated, "
+             << newStates.size() << " generated");
 
         return synthesizedParser;
     }
@@ -805,6 +795,7 @@ class ParserSymbolicInterpreter {
 }  // namespace ParserStructureImpl
 
 bool ParserStructure::analyze(ReferenceMap* refMap, TypeMap* typeMap, bool unroll, bool& wasError) {
+    evaluateReachability();
     ParserStructureImpl::ParserSymbolicInterpreter psi(this, refMap, typeMap, unroll, wasError);
     result = psi.run();
     return psi.hasOutOfboundState;
@@ -814,17 +805,9 @@ bool ParserStructure::analyze(ReferenceMap* refMap, TypeMap* typeMap, bool unrol
 bool ParserStructure::reachableHSUsage(IR::ID id, const ParserStateInfo* state) const {
     if (!state->scenarioHS.size())
         return false;
-    CHECK_NULL(callGraph);
-    const IR::IDeclaration* declaration = parser->states.getDeclaration(id.name);
-    BUG_CHECK(declaration && declaration->is<IR::ParserState>(), "Invalid declaration %1%", id);
-    std::set<const IR::ParserState*> reachableStates;
-    callGraph->reachable(declaration->to<IR::ParserState>(), reachableStates);
-    std::set<cstring> reachebleHSoperators;
-    for (auto i : reachableStates) {
-        auto iHSNames = statesWithHeaderStacks.find(i->name);
-        if (iHSNames != statesWithHeaderStacks.end())
-            reachebleHSoperators.insert(iHSNames->second.begin(), iHSNames->second.end());
-    }
+    auto reachable = reachableHSOperators.find(id.name);
+    BUG_CHECK(reachable != reachableHSOperators.end(), "Invalid declaration %1%", id);
+    const std::set<cstring>& reachebleHSoperators = reachable->second;
     std::set<cstring> intersectionHSOperators;
     std::set_intersection(state->scenarioHS.begin(), state->scenarioHS.end(),
                             reachebleHSoperators.begin(), reachebleHSoperators.end(),
@@ -833,6 +816,23 @@ bool ParserStructure::reachableHSUsage(IR::ID id, const ParserStateInfo* state)
     return intersectionHSOperators.size() > 0;
 }
 
+/// evaluates the header stacks used by the states reachable from each state,
+/// which the symbolic execution checks for every path it explores.
+void ParserStructure::evaluateReachability() {
+    CHECK_NULL(callGraph);
+    reachableHSOperators.clear();
+    for (auto& s : stateMap) {
+        std::set<const IR::ParserState*> reachableStates;
+        callGraph->reachable(s.second, reachableStates);
+        auto& operators = reachableHSOperators[s.first];
+        for (auto i : reachableStates) {
+            auto iHSNames = statesWithHeaderStacks.find(i->name);
+            if (iHSNames != statesWithHeaderStacks.end())
+                operators.insert(iHSNames->second.begin(), iHSNames->second.end());
+        }
+    }
+}
+
 void ParserStructure::addStateHSUsage(const IR::ParserState* state,
                                       const IR::Expression* expression) {
     if (state == nullptr || expression == nullptr || !expression->type->is<IR::Type_Stack>())
@@ -51,6 +51,9 @@ class StackVariable {
     // Implements comparisons so that StateVariables can be used as map keys.
     bool operator==(const StackVariable& other) const;
 
+    /// Name of the variable; equal for equal StackVariables.
+    cstring toString() const { return variable->toString(); }
+
  private:
     const IR::Expression* variable;
 
@@ -74,7 +77,8 @@ struct ParserStateInfo {
     const IR::P4Parser*             parser;
     const IR::ParserState*          state;  // original state this is produced from
     const ParserStateInfo*          predecessor;     // how we got here in the symbolic evaluation
-    ValueMap*                       before;
+    // values on entry; this is the predecessor's 'after' map, shared by all its successors
+    const ValueMap*                 before;
     ValueMap*                       after;
     IR::ParserState*                newState;        // pointer to a new state
     size_t                          currentIndex;
@@ -83,7 +87,7 @@ struct ParserStateInfo {
     std::unordered_set<cstring>     scenarioStates;
     std::unordered_set<cstring>     scenarioHS;      // scenario header stack's operations
     ParserStateInfo(cstring name, const IR::P4Parser* parser, const IR::ParserState* state,
-                    const ParserStateInfo* predecessor, ValueMap* before, size_t index) :
+                    const ParserStateInfo* predecessor, const ValueMap* before, size_t index) :
             name(name), parser(parser), state(state), predecessor(predecessor),
             before(before), after(nullptr), newState(nullptr), currentIndex(index) {
         CHECK_NULL(parser); CHECK_NULL(state); CHECK_NULL(before);
@@ -137,6 +141,8 @@ class ParserStructure {
     StateCallGraph*        callGraph;
     std::map<cstring, std::set<cstring> > statesWithHeaderStacks;
     std::map<cstring, size_t>  callsIndexes;  // map for curent calls of state insite current one
+    /// header stacks used by the states reachable from each state
+    std::map<cstring, std::set<cstring> > reachableHSOperators;
     void setParser(const IR::P4Parser* parser) {
         CHECK_NULL(parser);
         callGraph = new StateCallGraph(parser->name);
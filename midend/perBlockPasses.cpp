@@ -0,0 +1,236 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "perBlockPasses.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
+#include <typeinfo>
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "ir/pass_profile.h"
+#include "lib/parallel.h"
+
+namespace P4 {
+
+namespace {
+
+bool isBlock(const IR::Node *node) {
+    return node->is<IR::P4Control>() || node->is<IR::P4Parser>();
+}
+
+cstring blockName(const IR::Node *node) {
+    return node->to<IR::IDeclaration>()->getName().name;
+}
+
+/// Collects the names declared and used by a part of the program.
+class CollectNames : public Inspector {
+ public:
+    std::set<cstring> declared, used;
+    void postorder(const IR::Declaration *decl) override { declared.insert(decl->name.name); }
+    void postorder(const IR::Type_Declaration *decl) override {
+        declared.insert(decl->name.name); }
+    void postorder(const IR::Path *path) override { used.insert(path->name.name); }
+};
+
+/// Renames declarations, and the paths that refer to them.
+class RenameNames : public Transform {
+    const std::map<cstring, cstring> &renames;
+    IR::ID rename(const IR::ID &id) const {
+        auto it = renames.find(id.name);
+        if (it == renames.end()) return id;
+        return IR::ID(id.srcInfo, it->second, id.originalName); }
+
+ public:
+    explicit RenameNames(const std::map<cstring, cstring> &renames) : renames(renames) {
+        setName("RenameNames"); }
+    const IR::Node *postorder(IR::Path *path) override {
+        if (!path->absolute) path->name = rename(path->name);
+        return path; }
+    const IR::Node *postorder(IR::Declaration *decl) override {
+        decl->name = rename(decl->name);
+        return decl; }
+    const IR::Node *postorder(IR::Type_Declaration *decl) override {
+        decl->name = rename(decl->name);
+        return decl; }
+};
+
+/// The passes run over one unit.
+class UnitPasses : public PassManager {
+ public:
+    UnitPasses(ReferenceMap *refMap, TypeMap *typeMap, const std::vector<Visitor *> &unit,
+               bool stopOnError) {
+        passes.push_back(new TypeChecking(refMap, typeMap));
+        for (auto *pass : unit)
+            if (pass) passes.push_back(pass);
+        setStopOnError(stopOnError);
+        setName("PerBlockPasses"); }
+};
+
+}  // namespace
+
+PerBlockPasses::PerBlockPasses(ReferenceMap *refMap, TypeMap *typeMap, PassList makePasses)
+        : refMap(refMap), typeMap(typeMap), makePasses(makePasses) {
+    CHECK_NULL(refMap); CHECK_NULL(typeMap);
+    for (auto *pass : makePasses(refMap, typeMap))
+        if (pass) passes.push_back(pass);
+    setName("PerBlockPasses");
+}
+
+bool PerBlockPasses::removePass(cstring name) {
+    if (!PassManager::removePass(name)) return false;
+    excluded.push_back(name);
+    return true;
+}
+
+const IR::Node *PerBlockPasses::apply_visitor(const IR::Node *node, const char *name) {
+    if (Util::parallelism() > 1) {
+        if (auto *program = node->to<IR::P4Program>()) {
+            if (auto *rv = apply_split(program)) {
+                running = false;
+                return rv; } } }
+    return PassManager::apply_visitor(node, name);
+}
+
+const IR::P4Program *PerBlockPasses::apply_split(const IR::P4Program *program) {
+    auto &objects = program->objects;
+    std::vector<size_t> blocks;
+    std::set<cstring> blockNames;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (isBlock(objects.at(i))) {
+            blocks.push_back(i);
+            blockNames.insert(blockName(objects.at(i))); } }
+    if (blocks.size() < 2) return nullptr;
+
+    // a unit only holds its block and the declarations preceding it, so none
+    // of them may refer to another block
+    std::vector<std::set<cstring>> declaredBefore(blocks.size());
+    for (size_t i = 0, b = 0; i <= blocks.back(); ++i) {
+        CollectNames names;
+        objects.at(i)->apply(names);
+        cstring self = isBlock(objects.at(i)) ? blockName(objects.at(i)) : cstring();
+        for (auto use : names.used) {
+            if (use != self && blockNames.count(use)) {
+                LOG2(name() << ": " << objects.at(i) << " refers to " << use <<
+                     ", running serially");
+                return nullptr; } }
+        if (i == blocks[b]) declaredBefore[b++] = names.declared; }
+
+    std::vector<const IR::P4Program *> units(blocks.size());
+    std::vector<PassManager *> managers(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        IR::Vector<IR::Node> unit;
+        for (size_t i = 0; i < blocks[b]; ++i)
+            if (!isBlock(objects.at(i))) unit.push_back(objects.at(i));
+        unit.push_back(objects.at(blocks[b]));
+        units[b] = new IR::P4Program(program->srcInfo, unit);
+        auto *unitRefMap = new ReferenceMap;
+        unitRefMap->setIsV1(refMap->isV1());
+        auto *unitTypeMap = new TypeMap;
+        auto *manager = new UnitPasses(unitRefMap, unitTypeMap,
+                                       makePasses(unitRefMap, unitTypeMap), stop_on_error);
+        if (!excluded.empty())
+            manager->removePasses(excluded);
+        managers[b] = manager; }
+
+    unsigned initialErrorCount = ::errorCount();
+    std::vector<const IR::P4Program *> results(blocks.size());
+    std::atomic<uint64_t> visited(0), changed(0);
+    Util::parallelFor(blocks.size(), [&](size_t b) {
+        uint64_t visited_before = PassProfile::nodes_visited;
+        uint64_t changed_before = PassProfile::nodes_changed;
+        if (auto *result = units[b]->apply(*managers[b]))
+            results[b] = result->to<IR::P4Program>();
+        visited += PassProfile::nodes_visited - visited_before;
+        changed += PassProfile::nodes_changed - changed_before;
+        PassProfile::nodes_visited = visited_before;
+        PassProfile::nodes_changed = changed_before; });
+    PassProfile::nodes_visited += visited;
+    PassProfile::nodes_changed += changed;
+    // the errors have been reported; running the passes again would not help
+    if (::errorCount() > initialErrorCount) return program;
+
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        auto *result = results[b];
+        if (!result || result->objects.size() != units[b]->objects.size()) {
+            LOG2(name() << ": passes added or removed top-level declarations, running serially");
+            return nullptr; }
+        auto *block = result->objects.back();
+        auto *before = objects.at(blocks[b]);
+        if (typeid(*block) != typeid(*before) || blockName(block) != blockName(before)) {
+            LOG2(name() << ": passes replaced " << before << ", running serially");
+            return nullptr; } }
+
+    // the declarations preceding a block are shared by the units of all the
+    // following blocks, which must have changed them in the same way
+    IR::Vector<IR::Node> merged;
+    CollectNames taken;
+    program->apply(taken);
+    for (size_t i = 0, b = 0, k = 0; i < objects.size(); ++i) {
+        if (b < blocks.size() && blocks[b] == i) {
+            merged.push_back(results[b++]->objects.back());
+            continue; }
+        if (i > blocks.back()) {
+            merged.push_back(objects.at(i));
+            continue; }
+        auto *obj = results.back()->objects.at(k);
+        for (size_t u = b; u + 1 < blocks.size(); ++u) {
+            auto *other = results[u]->objects.at(k);
+            if (other != obj && !other->equiv(*obj)) {
+                LOG2(name() << ": units changed " << objects.at(i) <<
+                     " differently, running serially");
+                return nullptr; } }
+        if (obj != objects.at(i)) obj->apply(taken);
+        merged.push_back(obj);
+        ++k; }
+
+    // each unit generated names unique within the unit; rename those that
+    // clash with the names of the program or of other units
+    std::vector<std::set<cstring>> fresh(blocks.size());
+    MinimalNameGenerator generator;
+    for (auto name : taken.declared) generator.usedName(name);
+    for (auto name : taken.used) generator.usedName(name);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        CollectNames names;
+        results[b]->objects.back()->apply(names);
+        for (auto name : names.declared) {
+            if (!declaredBefore[b].count(name)) {
+                fresh[b].insert(name);
+                generator.usedName(name); } } }
+    std::set<cstring> used;
+    used.insert(taken.declared.begin(), taken.declared.end());
+    used.insert(taken.used.begin(), taken.used.end());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        std::map<cstring, cstring> renames;
+        for (auto name : fresh[b]) {
+            if (used.count(name)) {
+                auto newName = generator.newName(name);
+                renames.emplace(name, newName);
+                name = newName; }
+            used.insert(name); }
+        if (!renames.empty()) {
+            RenameNames rename(renames);
+            merged[blocks[b]] = merged.at(blocks[b])->apply(rename); } }
+
+    if (merged == objects)
+        return program;
+    refMap->clear();
+    typeMap->clear();
+    return new IR::P4Program(program->srcInfo, merged);
+}
+
+}  // namespace P4
@@ -0,0 +1,73 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _MIDEND_PERBLOCKPASSES_H_
+#define _MIDEND_PERBLOCKPASSES_H_
+
+#include <functional>
+#include <vector>
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * Runs a list of passes that only look at and change one control or parser
+ * at a time.  When the compiler runs with more than one thread, the program
+ * is split into one unit per control and parser, holding the block and the
+ * top-level declarations that precede it, and the units run the passes
+ * concurrently, each with its own ReferenceMap and TypeMap.  The results are
+ * stitched back into one program; names generated for different units that
+ * clash are renamed.
+ *
+ * Otherwise, and when the program cannot be split (blocks that refer to
+ * each other), or the units change the declarations they share in different
+ * ways, the passes run over the whole program, as in a PassManager.
+ *
+ * Top-level declarations after the last control or parser (usually just the
+ * package instantiation) are not visited by the passes.
+ *
+ * @pre The passes returned by the factory only change the controls and
+ * parsers, and only need the declarations preceding them.
+ */
+class PerBlockPasses : public PassManager {
+ public:
+    /// Makes the passes to run, using the given maps.
+    typedef std::function<std::vector<Visitor *>(ReferenceMap *, TypeMap *)> PassList;
+
+ private:
+    ReferenceMap        *refMap;
+    TypeMap             *typeMap;
+    PassList            makePasses;
+    /// Passes removed from the list by removePasses.
+    std::vector<cstring> excluded;
+
+ protected:
+    bool listsPassesInline() const override { return true; }
+    bool removePass(cstring name) override;
+
+ public:
+    PerBlockPasses(ReferenceMap *refMap, TypeMap *typeMap, PassList makePasses);
+    const IR::Node *apply_visitor(const IR::Node *, const char * = 0) override;
+    /// Runs the passes over the units of @program.  @returns the resulting
+    /// program, or null if @program cannot be split.
+    const IR::P4Program *apply_split(const IR::P4Program *program);
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_PERBLOCKPASSES_H_ */
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "predication.h"
 #include "frontends/p4/cloner.h"
+#include "ir/pass_profile.h"
 namespace P4 {
 
 /// convert an expression into a string that uniqely identifies the lvalue referenced
@@ -43,6 +44,92 @@ static cstring predication_lvalue_name(const IR::Expression *exp) {
     return cstring();
 }
 
+namespace {
+
+/// Sums the costs of the operators of an expression.
+class ExpressionCost : public Inspector {
+    const PredicationCostModel* model;
+
+ public:
+    unsigned cost = 0;
+    explicit ExpressionCost(const PredicationCostModel* model) : model(model)
+    { visitDagOnce = false; }
+    bool preorder(const IR::Operation* operation) override {
+        auto index = operation->to<IR::ArrayIndex>();
+        if (!operation->is<IR::Member>() && !(index && index->right->is<IR::Constant>()))
+            cost += model->operation(operation);
+        return true;
+    }
+    bool preorder(const IR::MethodCallExpression* call) override {
+        cost += model->operation(call);
+        return true;
+    }
+};
+
+/// Expected costs per packet of the statements of an action.
+class ActionCost {
+    const PredicationCostModel* model;
+
+    unsigned cost(const IR::Expression* expression) const {
+        ExpressionCost counter(model);
+        expression->apply(counter);
+        return counter.cost;
+    }
+
+ public:
+    // As written, where each branch of an 'if' runs for half of the packets
+    double branchCost = 0;
+    // Once predicated, where all the statements run for every packet
+    double predicatedCost = 0;
+    bool possible = true;
+    bool hasIf = false;
+
+    explicit ActionCost(const PredicationCostModel* model) : model(model) { CHECK_NULL(model); }
+    /// Adds the costs of @statement, enclosed in @depth 'if' statements
+    /// and run for @share of the packets.
+    void add(const IR::StatOrDecl* statement, unsigned depth = 0, double share = 1) {
+        if (auto block = statement->to<IR::BlockStatement>()) {
+            for (auto s : block->components)
+                add(s, depth, share);
+        } else if (auto ifs = statement->to<IR::IfStatement>()) {
+            hasIf = true;
+            auto condition = cost(ifs->condition);
+            branchCost += share * (condition + model->branch());
+            predicatedCost += condition;
+            if (!ifs->condition->is<IR::PathExpression>())
+                predicatedCost += model->assignment();  // the alias of the condition
+            add(ifs->ifTrue, depth + 1, share / 2);
+            if (ifs->ifFalse != nullptr)
+                add(ifs->ifFalse, depth + 1, share / 2);
+        } else if (auto assign = statement->to<IR::AssignmentStatement>()) {
+            if (depth > 0 && predication_lvalue_name(assign->left).isNullOrEmpty())
+                possible = false;
+            auto right = cost(assign->right) + model->assignment();
+            branchCost += share * right;
+            predicatedCost += right + depth * model->select();
+        } else if (statement->is<IR::EmptyStatement>()) {
+        } else if (depth > 0) {
+            // Predication signals an error for these
+            possible = false;
+        } else if (auto call = statement->to<IR::MethodCallStatement>()) {
+            branchCost += cost(call->methodCall);
+            predicatedCost += cost(call->methodCall);
+        } else if (auto decl = statement->to<IR::Declaration_Variable>()) {
+            if (decl->initializer != nullptr) {
+                auto initializer = cost(decl->initializer) + model->assignment();
+                branchCost += initializer;
+                predicatedCost += initializer;
+            }
+        } else if (!statement->is<IR::Declaration>() &&
+                   !statement->is<IR::ReturnStatement>() &&
+                   !statement->is<IR::ExitStatement>()) {
+            possible = false;
+        }
+    }
+};
+
+}  // namespace
+
 const IR::Node* Predication::EmptyStatementRemover::postorder(IR::EmptyStatement*) {
     return nullptr;
 }
@@ -340,6 +427,34 @@ const IR::Node* Predication::preorder(IR::IfStatement* statement) {
 }
 
 const IR::Node* Predication::preorder(IR::P4Action* action) {
+    if (costModel != nullptr) {
+        static auto &predicated = PassProfile::counter("Predication.predicated");
+        static auto &kept = PassProfile::counter("Predication.kept");
+        ActionCost cost(costModel);
+        cost.add(action->body);
+        if (cost.hasIf) {
+            cstring name = action->name.name;
+            if (auto control = findContext<IR::P4Control>())
+                name = control->name.name + "." + name;
+            Decision decision = { cost.possible, cost.possible &&
+                                  cost.predicatedCost < cost.branchCost,
+                                  cost.branchCost, cost.predicatedCost };
+            decisions[name] = decision;
+            if (!decision.possible) {
+                LOG1(name << ": cannot be predicated, keeping its conditionals");
+            } else {
+                LOG1(name << ": costs " << decision.branchCost << " with conditionals, " <<
+                     decision.predicatedCost << " predicated, " <<
+                     (decision.predicated ? "predicating" : "keeping its conditionals"));
+            }
+            if (!decision.predicated) {
+                ++kept;
+                prune();
+                return action;
+            }
+            ++predicated;
+        }
+    }
     inside_action = true;
     return action;
 }
@@ -22,11 +22,30 @@ limitations under the License.
 
 namespace P4 {
 
+/**
+ * The costs, in instructions, that Predication uses to estimate the work an
+ * action does per packet.  Targets that support conditionals in actions
+ * override them to describe their instruction set.
+ */
+class PredicationCostModel {
+ public:
+    virtual ~PredicationCostModel() {}
+    /// Cost of the operator of @expression, without its operands.
+    /// Field accesses and constant array indexes are free.
+    virtual unsigned operation(const IR::Expression *) const { return 1; }
+    /// Cost of storing a value.
+    virtual unsigned assignment() const { return 1; }
+    /// Cost of a conditional branch, including the jump over the other side.
+    virtual unsigned branch() const { return 4; }
+    /// Cost of choosing between two values, as in 'c ? a : b'.
+    virtual unsigned select() const { return 1; }
+};
+
 /**
 This pass operates on action bodies.  It converts 'if' statements to
 '?:' expressions, if possible.  Otherwise this pass will signal an
-error.  This pass should be used only on architectures that do not
-support conditionals in actions.
+error.  Without a cost model, this pass should be used only on
+architectures that do not support conditionals in actions.
 For this to work all statements must be assignments or other ifs.
 if (e)
    a = f(b);
@@ -37,8 +56,28 @@ becomes (actual implementatation is slightly optimized):
     a = e ? f(b) : a;
     c = e ? c : f(d);
 }
+
+Given a cost model, the target supports conditionals in actions, and an
+action is only predicated if this lowers its expected cost per packet;
+the other actions are left unchanged, and no error is signalled.  Each
+branch of an 'if' is assumed to run for half of the packets; once
+predicated, all the assignments run for every packet, each choosing its
+value with one '?:' per enclosing 'if'.
 */
 class Predication final : public Transform {
+ public:
+    /// What was decided for an action containing 'if' statements.
+    struct Decision {
+        /// False if the action holds statements that cannot be predicated.
+        bool    possible;
+        bool    predicated;
+        /// Expected cost per packet of the action as written.
+        double  branchCost;
+        /// Cost per packet of the action once predicated.
+        double  predicatedCost;
+    };
+
+ private:
     /** Private Transformer only for Predication pass.
      *  Used to remove EmptyStatements and empty BlockStatements from the code.
      */
@@ -83,6 +122,9 @@ class Predication final : public Transform {
     NameGenerator* generator;
     // Used to remove empty statements and empty block statements that appear in the code
     EmptyStatementRemover remover;
+    const PredicationCostModel* costModel;
+    // Decisions for the actions with 'if' statements, when given a cost model
+    std::map<cstring, Decision> decisions;
     bool inside_action;
     // Used to indicate whether or not an ArrayIndex should be modified.
     bool modifyIndex = false;
@@ -121,9 +163,16 @@ class Predication final : public Transform {
     }
 
  public:
-    explicit Predication(NameGenerator* gen) :
-        generator(gen), inside_action(false), ifNestingLevel(0), depNestingLevel(0)
+    explicit Predication(NameGenerator* gen, const PredicationCostModel* costModel = nullptr) :
+        generator(gen), costModel(costModel), inside_action(false),
+        ifNestingLevel(0), depNestingLevel(0)
     { setName("Predication"); }
+    profile_t init_apply(const IR::Node* root) override {
+        decisions.clear();
+        return Transform::init_apply(root); }
+    /// @returns the decisions made for the actions with 'if' statements, by
+    /// action name, prefixed by the control's; only filled given a cost model.
+    const std::map<cstring, Decision>& getDecisions() const { return decisions; }
     const IR::Expression* clone(const IR::Expression* expression);
     const IR::Node* clone(const IR::AssignmentStatement* statement);
     const IR::Node* preorder(IR::IfStatement* statement) override;
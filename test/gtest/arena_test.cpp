@@ -0,0 +1,131 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "ir/visitor.h"
+#include "lib/arena.h"
+
+namespace Test {
+
+namespace {
+
+struct Counted {
+    static int live;
+    int value;
+    explicit Counted(int v) : value(v) { ++live; }
+    ~Counted() { --live; }
+};
+int Counted::live = 0;
+
+}  // namespace
+
+TEST(Arena, Allocate) {
+    Util::Arena arena(1024);
+    char *c = static_cast<char *>(arena.allocate(1, 1));
+    auto *d = static_cast<double *>(arena.allocate(sizeof(double), alignof(double)));
+    EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(d) % alignof(double));
+    EXPECT_NE(static_cast<void *>(c), static_cast<void *>(d));
+    // larger than a chunk
+    auto *big = static_cast<char *>(arena.allocate(4096));
+    big[0] = big[4095] = 1;
+    // the current chunk is still used after a large allocation
+    auto *after = static_cast<char *>(arena.allocate(1, 1));
+    EXPECT_LT(after - c, 1024);
+    EXPECT_EQ(1U + sizeof(double) + 4096 + 1, arena.bytes_used());
+
+    arena.release();
+    EXPECT_EQ(0U, arena.bytes_used());
+    for (int i = 0; i < 10000; ++i)
+        arena.allocate(16);
+    EXPECT_EQ(160000U, arena.bytes_used());
+}
+
+TEST(Arena, Make) {
+    Util::Arena arena;
+    auto *a = arena.make<Counted>(1);
+    auto *b = arena.make<Counted>(2);
+    EXPECT_EQ(1, a->value);
+    EXPECT_EQ(2, b->value);
+    EXPECT_EQ(2, Counted::live);
+    arena.release();
+    EXPECT_EQ(0, Counted::live);
+    arena.make<Counted>(3);
+    EXPECT_EQ(1, Counted::live);
+}
+
+TEST(Arena, Destroy) {
+    {
+        Util::Arena arena;
+        arena.make<Counted>(1);
+    }
+    EXPECT_EQ(0, Counted::live);
+}
+
+TEST(Arena, Containers) {
+    Util::Arena arena(256);
+    std::vector<int, Util::ArenaAllocator<int>> vec{Util::ArenaAllocator<int>(arena)};
+    for (int i = 0; i < 1000; ++i)
+        vec.push_back(i);
+    std::map<int, int, std::less<int>, Util::ArenaAllocator<std::pair<const int, int>>>
+        map{std::less<int>(), Util::ArenaAllocator<std::pair<const int, int>>(arena)};
+    for (int i = 0; i < 1000; ++i)
+        map[i] = vec[999 - i];
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(999 - i, map.at(i));
+}
+
+TEST(Arena, VisitorScratch) {
+    struct UseScratch : public Inspector {
+        int seen = -1;
+        bool preorder(const IR::Constant *c) override {
+            scratch().make<Counted>(c->asInt());
+            seen = Counted::live;
+            return true; }
+    };
+
+    auto *e = new IR::Add(new IR::Constant(1), new IR::Constant(2));
+    UseScratch use;
+    e->apply(use);
+    EXPECT_EQ(2, use.seen);
+    // all freed when the traversal finished
+    EXPECT_EQ(0, Counted::live);
+}
+
+TEST(Arena, NestedApplyKeepsScratch) {
+    struct UseScratch : public Inspector {
+        void make(int v) { scratch().make<Counted>(v); }
+    };
+
+    auto *c = new IR::Constant(1);
+    UseScratch use;
+    {
+        auto outer = use.init_apply(c);
+        use.make(1);
+        {
+            auto inner = use.init_apply(c);
+            use.make(2);
+        }
+        // the nested apply does not free what the outer one still uses
+        EXPECT_EQ(2, Counted::live);
+    }
+    EXPECT_EQ(0, Counted::live);
+}
+
+}  // namespace Test
@@ -0,0 +1,114 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "helpers.h"
+
+#include "frontends/common/batch.h"
+#include "frontends/common/options.h"
+
+using namespace P4;
+
+namespace Test {
+
+class Batch : public P4CTest {
+ protected:
+    std::string manifest;
+
+    void writeManifest(const std::string& text) {
+        char name[] = "/tmp/p4c-batch-XXXXXX";
+        int fd = mkstemp(name);
+        close(fd);
+        manifest = name;
+        std::ofstream(manifest) << text;
+    }
+    ~Batch() {
+        if (!manifest.empty()) unlink(manifest.c_str());
+    }
+};
+
+TEST_F(Batch, OneCompilationPerLine) {
+    writeManifest("# a comment\n\na.p4 -DX=1\n\"b c.p4\"\nfail.p4\n");
+    std::vector<std::vector<std::string>> calls;
+    std::vector<int> firstIds;
+    auto compile = [&](int argc, char* const argv[]) {
+        calls.emplace_back(argv, argv + argc);
+        firstIds.push_back(IR::Node::nodesCreated());
+        new IR::Path("x");  // not reused by the next compilation
+        return calls.back().back() == "fail.p4" ? 1 : 0;
+    };
+    const char* argv[] = { "p4test", "--batch", manifest.c_str(), "-I", "inc" };
+    EXPECT_EQ(runCompilations(5, const_cast<char* const*>(argv), compile), 1);
+
+    ASSERT_EQ(calls.size(), 3u);
+    EXPECT_EQ(calls[0], std::vector<std::string>({ "p4test", "-I", "inc", "a.p4", "-DX=1" }));
+    EXPECT_EQ(calls[1].back(), "b c.p4");
+    EXPECT_LT(firstIds[0], firstIds[1]);
+    EXPECT_LT(firstIds[1], firstIds[2]);
+}
+
+TEST_F(Batch, OptionsOfEachCompilation) {
+    writeManifest("a.p4\nb.p4 --nocpp\n");
+    std::vector<cstring> files;
+    std::vector<bool> cached, noCpp;
+    auto compile = [&](int argc, char* const argv[]) {
+        AutoCompileContext context(new P4CContextWithOptions<CompilerOptions>);
+        auto& options = P4CContextWithOptions<CompilerOptions>::get().options();
+        if (options.process(argc, argv) != nullptr)
+            options.setInputFile();
+        files.push_back(options.file);
+        cached.push_back(options.cacheSystemIncludes);
+        noCpp.push_back(options.doNotPreprocess);
+        return int(::errorCount());
+    };
+    const char* argv[] = { "p4test", "--batch", manifest.c_str() };
+    EXPECT_EQ(runCompilations(3, const_cast<char* const*>(argv), compile), 0);
+
+    EXPECT_EQ(files, std::vector<cstring>({ "a.p4", "b.p4" }));
+    EXPECT_EQ(cached, std::vector<bool>({ false, false }));
+    EXPECT_EQ(noCpp, std::vector<bool>({ false, true }));
+
+    // The include cache is used only when asked for.
+    cached.clear();
+    noCpp.clear();
+    const char* cachingArgv[] = { "p4test", "--cache-system-includes",
+                                  "--batch", manifest.c_str() };
+    EXPECT_EQ(runCompilations(4, const_cast<char* const*>(cachingArgv), compile), 0);
+    EXPECT_EQ(cached, std::vector<bool>({ true, true }));
+    EXPECT_EQ(noCpp, std::vector<bool>({ false, true }));
+}
+
+TEST_F(Batch, SingleCompilation) {
+    int calls = 0;
+    auto compile = [&](int argc, char* const[]) {
+        ++calls;
+        EXPECT_EQ(argc, 2);
+        return 3;
+    };
+    const char* argv[] = { "p4test", "a.p4" };
+    EXPECT_EQ(runCompilations(2, const_cast<char* const*>(argv), compile), 3);
+    EXPECT_EQ(calls, 1);
+}
+
+}  // namespace Test
@@ -14,6 +14,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "lib/cstring.h"
 
@@ -120,4 +124,41 @@ TEST(cstring, replace) {
     EXPECT_EQ(c.replace("i", ""), "Orgnal");
 }
 
+TEST(cstring, cache_size) {
+    cstring::cache_stats before, after;
+    size_t count;
+    size_t bytes = cstring::cache_size(before);
+    EXPECT_EQ(bytes, cstring::cache_size(count));
+    EXPECT_EQ(before.count, count);
+    EXPECT_LT(0u, before.shards);
+
+    for (int i = 0; i < 100; ++i)
+        cstring(std::string("cache_size_test_") + std::to_string(i));
+    cstring::cache_size(after);
+    EXPECT_EQ(before.count + 100, after.count);
+    EXPECT_LT(before.bytes, after.bytes);
+    EXPECT_LE(after.largest_shard, after.count);
+    EXPECT_LE(after.count, after.largest_shard * after.shards);
+}
+
+TEST(cstring, interning_from_threads) {
+    // equal strings are the same pointer, whichever thread or shard interned them
+    const int threads = 4, strings = 1000;
+    std::vector<std::vector<const char *>> interned(threads);
+    auto work = [&](int t) {
+        for (int i = 0; i < strings; ++i)
+            interned[t].push_back(cstring("thread_test_" + std::to_string(i)).c_str()); };
+#ifdef MULTITHREAD
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back(work, t);
+    for (auto &w : workers) w.join();
+#else
+    for (int t = 0; t < threads; ++t) work(t);
+#endif  // MULTITHREAD
+    for (int t = 1; t < threads; ++t)
+        EXPECT_EQ(interned[0], interned[t]);
+    EXPECT_EQ(cstring("thread_test_7").c_str(), interned[0][7]);
+}
+
 }  // namespace Test
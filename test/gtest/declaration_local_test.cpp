@@ -0,0 +1,90 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "ir/visitor.h"
+
+namespace Test {
+
+class DeclarationLocalTest : public P4CTest { };
+
+namespace {
+
+/// Appends the name of the last constant seen to each action, removes actions
+/// named 'drop' and duplicates actions named 'dup'.
+struct RenameActions : public Transform, public DeclarationLocal {
+    cstring suffix;
+    RenameActions *clone() const override { return new RenameActions(*this); }
+    const IR::Node *postorder(IR::Declaration_Constant *c) override {
+        suffix = c->name;
+        return c; }
+    const IR::Node *postorder(IR::P4Action *a) override {
+        if (a->name == "drop")
+            return nullptr;
+        if (a->name == "dup") {
+            auto *rv = new IR::Vector<IR::Node>();
+            rv->push_back(new IR::P4Action("dup1", a->parameters, a->body));
+            rv->push_back(new IR::P4Action("dup2", a->parameters, a->body));
+            return rv; }
+        a->name = IR::ID(a->name.name + "_" + suffix);
+        return a; }
+};
+
+const IR::P4Action *action(cstring name) {
+    return new IR::P4Action(name, new IR::ParameterList(), new IR::BlockStatement());
+}
+
+}  // namespace
+
+TEST_F(DeclarationLocalTest, MergesInOrder) {
+    IR::Vector<IR::Node> objects;
+    objects.push_back(new IR::Declaration_Constant("c", IR::Type_Bits::get(8),
+                                                   new IR::Constant(1)));
+    objects.push_back(action("a"));
+    objects.push_back(action("drop"));
+    objects.push_back(new IR::Type_Typedef("t", IR::Type_Bits::get(8)));
+    objects.push_back(action("dup"));
+    objects.push_back(action("b"));
+    auto *program = new IR::P4Program(objects);
+
+    RenameActions rename;
+    auto *result = rename.apply_parallel(program)->to<IR::P4Program>();
+    ASSERT_NE(nullptr, result);
+    std::vector<cstring> names;
+    for (auto *obj : result->objects)
+        names.push_back(obj->to<IR::IDeclaration>()->getName());
+    std::vector<cstring> expected = { "c", "a_c", "t", "dup1", "dup2", "b_c" };
+    EXPECT_EQ(expected, names);
+
+    // serial application gives the same program
+    EXPECT_TRUE(result->equiv(*program->apply(RenameActions())));
+}
+
+TEST_F(DeclarationLocalTest, UnchangedProgram) {
+    IR::Vector<IR::Node> objects;
+    objects.push_back(new IR::Type_Typedef("t", IR::Type_Bits::get(8)));
+    objects.push_back(action("a"));
+    auto *program = new IR::P4Program(objects);
+
+    struct Nothing : public Inspector, public DeclarationLocal {
+        Nothing *clone() const override { return new Nothing(*this); }
+    } nothing;
+    EXPECT_EQ(program, nothing.apply_parallel(program));
+}
+
+}  // namespace Test
@@ -0,0 +1,199 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "helpers.h"
+
+#include "frontends/common/parseInput.h"
+#include "frontends/common/resolveReferences/resolveReferences.h"
+#include "frontends/p4/createBuiltins.h"
+#include "frontends/p4/def_use.h"
+#include "frontends/p4/parserCallGraph.h"
+
+namespace Test {
+
+using namespace P4;
+
+namespace {
+
+const IR::Type_Header* header(cstring name) {
+    IR::IndexedVector<IR::StructField> fields;
+    fields.push_back(new IR::StructField("a", IR::Type_Bits::get(8)));
+    fields.push_back(new IR::StructField("b", IR::Type_Bits::get(16)));
+    return new IR::Type_Header(IR::ID(name), fields);
+}
+
+std::vector<cstring> names(const LocationSet* set) {
+    std::vector<cstring> result;
+    for (auto l : *set)
+        result.push_back(l->name);
+    return result;
+}
+
+}  // namespace
+
+TEST(DefUse, LocationsAreNumberedDensely) {
+    StorageFactory factory;
+    auto h = factory.create(header("h"), "h");
+    auto x = factory.create(IR::Type_Bits::get(32), "x");
+
+    LocationSet set;
+    set.add(x);
+    set.add(h);
+    // Iteration follows the creation order, not the insertion order.
+    EXPECT_EQ(names(&set), (std::vector<cstring>{ "h", "x" }));
+    EXPECT_EQ(names(set.canonicalize()),
+              (std::vector<cstring>{ "h.a", "h.b", "h.$valid", "x" }));
+    EXPECT_EQ(names(set.getField("b")), (std::vector<cstring>{ "h.b" }));
+    EXPECT_EQ(names(set.getValidField()), (std::vector<cstring>{ "h.$valid" }));
+}
+
+TEST(DefUse, JoinAndOverlap) {
+    StorageFactory factory;
+    auto h = factory.create(header("h"), "h");
+    auto x = factory.create(IR::Type_Bits::get(32), "x");
+
+    auto whole = (new LocationSet(h))->canonicalize();
+    auto field = (new LocationSet(h))->getField("a");
+    auto scalar = new LocationSet(x);
+    EXPECT_TRUE(whole->overlaps(field));
+    EXPECT_TRUE(field->overlaps(whole));
+    EXPECT_FALSE(whole->overlaps(scalar));
+    EXPECT_FALSE(whole->overlaps(LocationSet::empty));
+
+    auto joined = field->join(scalar);
+    EXPECT_EQ(names(joined), (std::vector<cstring>{ "h.a", "x" }));
+    EXPECT_EQ(joined->canonicalize(), joined);
+    EXPECT_EQ(LocationSet::empty->join(scalar), scalar);
+    EXPECT_EQ(scalar->join(LocationSet::empty), scalar);
+    EXPECT_TRUE(LocationSet::empty->isEmpty());
+}
+
+TEST(DefUse, HeaderStacks) {
+    StorageFactory factory;
+    auto stack = new IR::Type_Stack(header("h"), new IR::Constant(2));
+    auto s = new LocationSet(factory.create(stack, "s"));
+
+    EXPECT_EQ(names(s->getIndex(1)->canonicalize()),
+              (std::vector<cstring>{ "s[1].a", "s[1].b", "s[1].$valid" }));
+    EXPECT_EQ(names(s->getArrayLastIndex()), (std::vector<cstring>{ "s.$lastIndex" }));
+    // The last index is not part of the stack's canonical locations.
+    EXPECT_FALSE(s->canonicalize()->overlaps(s->getArrayLastIndex()));
+    auto stackLocation = *s->begin();
+    EXPECT_EQ(names(stackLocation->getValidBits()),
+              (std::vector<cstring>{ "s[0].$valid", "s[1].$valid" }));
+}
+
+TEST(DefUse, ProgramPointsAreInterned) {
+    auto control = new IR::EmptyStatement();
+    auto statement = new IR::EmptyStatement();
+    ProgramPointTrie trie;
+    ProgramPoint context(trie.beforeStart(), control);
+    ProgramPoint point(context, statement);
+
+    EXPECT_TRUE(point == ProgramPoint(ProgramPoint(trie.beforeStart(), control), statement));
+    EXPECT_EQ(point.hash(),
+              ProgramPoint(ProgramPoint(trie.beforeStart(), control), statement).hash());
+    EXPECT_FALSE(point == ProgramPoint(trie.beforeStart(), statement));
+    EXPECT_FALSE(point == context.after());
+    EXPECT_EQ(point.last(), statement);
+    EXPECT_EQ(point.getStack(), (std::vector<const IR::Node*>{ control, statement }));
+    EXPECT_EQ(context.after().last(), nullptr);
+    EXPECT_TRUE(ProgramPoint::beforeStart.isBeforeStart());
+    EXPECT_TRUE(trie.beforeStart() == ProgramPoint::beforeStart);
+    EXPECT_EQ(ProgramPoint::beforeStart.last(), nullptr);
+
+    ProgramPoints points(point);
+    points.add(ProgramPoint::beforeStart);
+    points.add(point);
+    EXPECT_EQ(points.size(), 2u);
+    EXPECT_TRUE(points.containsBeforeStart());
+    auto merged = points.merge(new ProgramPoints(context));
+    EXPECT_EQ(merged->size(), 3u);
+    EXPECT_TRUE(*merged->merge(&points) == *merged);
+    EXPECT_FALSE(ProgramPoints(point).containsBeforeStart());
+
+    // Each analysis has points of its own.
+    ProgramPointTrie other;
+    EXPECT_FALSE(ProgramPoint(other.beforeStart(), control) == context);
+}
+
+TEST(DefUse, JoinDefinitions) {
+    StorageFactory factory;
+    auto h = factory.create(header("h"), "h");
+    auto x = factory.create(IR::Type_Bits::get(32), "x");
+    auto a = (new LocationSet(h))->getField("a");
+
+    auto s1 = new IR::EmptyStatement();
+    auto s2 = new IR::EmptyStatement();
+    ProgramPointTrie trie;
+    ProgramPoint p1(trie.beforeStart(), s1), p2(trie.beforeStart(), s2);
+    auto left = (new Definitions())->writes(p1, new LocationSet(x));
+    left = left->writes(p1, a);
+    auto right = (new Definitions())->writes(p2, new LocationSet(h));
+
+    auto joined = left->joinDefinitions(right);
+    EXPECT_EQ(joined->getPoints(a)->size(), 2u);
+    EXPECT_EQ(joined->getPoints(new LocationSet(x))->size(), 1u);
+    EXPECT_EQ(joined->getPoints((new LocationSet(h))->getField("b"))->size(), 1u);
+    EXPECT_TRUE(*joined == *right->joinDefinitions(left));
+    EXPECT_FALSE(*joined == *left);
+}
+
+class P4CDefUse : public P4CTest { };
+
+TEST_F(P4CDefUse, ParserStatesInReversePostorder) {
+    std::string program = P4_SOURCE(R"(
+        parser p(in bit<8> x) {
+            state start { transition select (x) { 0: loop; default: done; } }
+            state done { transition accept; }
+            state loop { transition select (x) { 1: loop; 2: done; } }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    ReferenceMap refMap;
+    pgm = pgm->apply(CreateBuiltins());
+    pgm = pgm->apply(ResolveReferences(&refMap));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto parser = pgm->getDeclsByName("p")->single()->getNode()->to<IR::P4Parser>();
+    ASSERT_TRUE(parser != nullptr);
+
+    ParserStateGraph graph(&refMap, parser);
+    std::vector<cstring> order;
+    for (auto state : graph.reachableStates())
+        order.push_back(state->name);
+    EXPECT_EQ(order, (std::vector<cstring>{ "start", "loop", "reject", "done", "accept" }));
+    std::vector<cstring> next;
+    for (auto state : graph.successors(graph.reachableStates().at(1)))
+        next.push_back(state->name);
+    EXPECT_EQ(next, (std::vector<cstring>{ "loop", "done", "reject" }));
+
+    // The worklist yields the states in reverse postorder.
+    ParserStateGraph::Worklist worklist(graph);
+    worklist.add(graph.reachableStates().at(3));
+    worklist.add(graph.reachableStates().at(1));
+    worklist.add(graph.reachableStates().at(3));
+    EXPECT_EQ(worklist.pop()->name, "loop");
+    EXPECT_FALSE(worklist.empty());
+    EXPECT_EQ(worklist.pop()->name, "done");
+    EXPECT_TRUE(worklist.empty());
+}
+
+}  // namespace Test
@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "gtest/gtest.h"
+#include "ir/hash_cons.h"
 #include "ir/ir.h"
 #include "ir/visitor.h"
 #include "lib/exceptions.h"
@@ -70,3 +71,52 @@ TEST(IR, Equiv) {
     pr2->add("listb", list1);
     EXPECT_FALSE(pr1->equiv(*pr2));
 }
+
+TEST(IR, Hash) {
+    auto *t = IR::Type::Bits::get(16);
+    auto *a1 = new IR::Constant(t, 10);
+    auto *a2 = new IR::Constant(t, 10);
+    auto *c = new IR::Constant(t, 20);
+    auto *big1 = new IR::Constant(IR::Type::Bits::get(128), big_int(1) << 100);
+    auto *big2 = new IR::Constant(IR::Type::Bits::get(128), big_int(1) << 100);
+    auto *d1m = new IR::Member(new IR::PathExpression("d"), "m");
+    auto *d2m = new IR::Member(new IR::PathExpression("d"), "m");
+    auto *d1f = new IR::Member(new IR::PathExpression("d"), "f");
+
+    EXPECT_EQ(a1->hash(), a2->hash());
+    EXPECT_NE(a1->hash(), c->hash());
+    EXPECT_EQ(big1->hash(), big2->hash());
+    EXPECT_EQ(d1m->hash(), d2m->hash());
+    EXPECT_NE(d1m->hash(), d1f->hash());
+
+    auto *list1 = new IR::ListExpression({ a1, c, d1m });
+    auto *list2 = new IR::ListExpression({ a2, c, d2m });
+    auto *list3 = new IR::ListExpression({ a1, d1m, c });
+    EXPECT_EQ(list1->hash(), list2->hash());
+    EXPECT_NE(list1->hash(), list3->hash());
+
+    // declarations with the same name are equiv, whatever their declid
+    auto *v1 = new IR::Declaration_Variable("v", t);
+    auto *v2 = new IR::Declaration_Variable("v", t);
+    ASSERT_TRUE(v1->equiv(*v2));
+    EXPECT_EQ(v1->hash(), v2->hash());
+
+    // a clone does not inherit the cached hash of its original
+    auto *a3 = a1->clone();
+    a3->value = 20;
+    EXPECT_EQ(c->hash(), a3->hash());
+}
+
+TEST(IR, HashCons) {
+    IR::HashCons nodes;
+    auto *t = nodes.get(IR::Type::Bits::get(16));
+    auto *d1m = nodes.make<IR::Member>(nodes.make<IR::PathExpression>("d"), "m");
+    auto *d2m = nodes.make<IR::Member>(nodes.make<IR::PathExpression>("d"), "m");
+    auto *d1f = nodes.make<IR::Member>(nodes.make<IR::PathExpression>("d"), "f");
+    EXPECT_EQ(d1m, d2m);
+    EXPECT_NE(d1m, d1f);
+    EXPECT_EQ(d1m->expr, d1f->expr);
+    EXPECT_EQ(nodes.make<IR::Constant>(t, 1), nodes.make<IR::Constant>(t, 1));
+    EXPECT_EQ(5U, nodes.size());  // type, path, two members, constant
+    EXPECT_EQ(4U, nodes.hits());
+}
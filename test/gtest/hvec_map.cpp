@@ -0,0 +1,167 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc. 
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/hvec_map.h"
+#include "lib/ordered_map.h"
+
+// #define HVEC_MAP_BENCHMARK
+
+#ifdef HVEC_MAP_BENCHMARK
+    #include <chrono>
+    #include <iomanip>
+    #include <iostream>
+#endif
+
+namespace Test {
+
+TEST(hvec_map, map_equal) {
+    hvec_map<unsigned, unsigned> a;
+    hvec_map<unsigned, unsigned> b;
+
+    EXPECT_TRUE(a == b);
+
+    a[1] = 111;
+    a[2] = 222;
+    a[3] = 333;
+    b[1] = 111;
+    b[2] = 222;
+    b[3] = 333;
+    EXPECT_TRUE(a == b);
+
+    a.erase(2);
+    EXPECT_TRUE(a != b);
+    b.erase(2);
+    EXPECT_TRUE(a == b);
+
+    b.clear();
+    b[3] = 333;
+    b[1] = 111;
+    EXPECT_TRUE(a != b);  // same elements, different order
+}
+
+TEST(hvec_map, insert_emplace_erase) {
+    hvec_map<unsigned, unsigned> hm;
+    std::map<unsigned, unsigned> sm;
+
+    for (unsigned v : {0, 1, 2, 3, 4, 5, 6, 7, 8}) {
+        sm.emplace(v, 2 * v);
+        if (v % 2 == 0)
+            EXPECT_TRUE(hm.insert(std::make_pair(v, 2 * v)).second);
+        else
+            EXPECT_TRUE(hm.emplace(v, 2 * v).second); }
+    EXPECT_FALSE(hm.emplace(3, 0).second);
+    EXPECT_EQ(6U, hm.at(3));
+    EXPECT_TRUE(std::equal(hm.begin(), hm.end(), sm.begin(), sm.end()));
+
+    auto it = hm.erase(std::next(hm.begin(), 2));
+    EXPECT_EQ(3U, it->first);
+    sm.erase(std::next(sm.begin(), 2));
+    EXPECT_EQ(sm.size(), hm.size());
+    EXPECT_TRUE(std::equal(hm.begin(), hm.end(), sm.begin(), sm.end()));
+    EXPECT_TRUE(std::equal(hm.rbegin(), hm.rend(), sm.rbegin(), sm.rend()));
+    EXPECT_EQ(0U, hm.count(2));
+    EXPECT_EQ(hm.end(), hm.find(2));
+    EXPECT_EQ(0U, get(hm, 2));
+    EXPECT_EQ(16U, get(hm, 8));
+}
+
+TEST(hvec_map, matches_ordered_map) {
+    // random inserts and erases, so the tombstones are compacted repeatedly
+    hvec_map<int, int> hm;
+    ordered_map<int, int> om;
+    std::mt19937 rng(42);
+    for (int i = 0; i < 20000; ++i) {
+        int k = rng() % 1000;
+        if (rng() % 3 == 0) {
+            EXPECT_EQ(om.erase(k), hm.erase(k));
+        } else {
+            om[k] += i;
+            hm[k] += i; }
+        ASSERT_EQ(om.size(), hm.size()); }
+    EXPECT_TRUE(std::equal(hm.begin(), hm.end(), om.begin(), om.end()));
+
+    // erase while iterating does not invalidate the iterator
+    for (auto it = hm.begin(); it != hm.end();) {
+        if (it->first % 2)
+            it = hm.erase(it);
+        else
+            ++it; }
+    for (auto &el : hm)
+        EXPECT_EQ(0, el.first % 2);
+
+    auto copy = hm;
+    EXPECT_TRUE(copy == hm);
+    copy[1] = 1;
+    EXPECT_EQ(0U, hm.count(1));
+    hm = copy;
+    EXPECT_EQ(1, hm.at(1));
+}
+
+#ifdef HVEC_MAP_BENCHMARK
+
+namespace {
+
+struct bench_times { double insert = 0, lookup = 0, iterate = 0; };
+
+template<class MAP> bench_times bench(MAP &m, const std::vector<unsigned> &keys, unsigned &sum) {
+    typedef std::chrono::steady_clock clock;
+    typedef std::chrono::duration<double, std::milli> ms;
+    bench_times rv;
+    for (int rep = 0; rep < 5; ++rep) {
+        m.clear();
+        auto t0 = clock::now();
+        for (auto k : keys) m[k] = k;
+        auto t1 = clock::now();
+        for (auto k : keys) sum += m.find(k)->second;
+        auto t2 = clock::now();
+        for (auto &el : m) sum += el.second;
+        auto t3 = clock::now();
+        rv.insert += ms(t1 - t0).count();
+        rv.lookup += ms(t2 - t1).count();
+        rv.iterate += ms(t3 - t2).count(); }
+    return rv;
+}
+
+}  // namespace
+
+/// Not a test as such: compares insert, lookup and iteration times with
+/// ordered_map, on random keys.
+TEST(hvec_map, benchmark) {
+    std::vector<unsigned> keys;
+    std::mt19937 rng(1);
+    for (int i = 0; i < 50000; ++i)
+        keys.push_back(rng());
+    unsigned sum1 = 0, sum2 = 0;
+    ordered_map<unsigned, unsigned> om;
+    hvec_map<unsigned, unsigned> hm;
+    auto t_om = bench(om, keys, sum1);
+    auto t_hm = bench(hm, keys, sum2);
+    EXPECT_EQ(sum1, sum2);
+    std::cout << "             insert   lookup  iterate (ms)" << std::endl;
+    std::cout << "ordered_map " << std::setw(8) << t_om.insert << " " << std::setw(8)
+              << t_om.lookup << " " << std::setw(8) << t_om.iterate << std::endl;
+    std::cout << "hvec_map    " << std::setw(8) << t_hm.insert << " " << std::setw(8)
+              << t_hm.lookup << " " << std::setw(8) << t_hm.iterate << std::endl;
+}
+
+#endif  // HVEC_MAP_BENCHMARK
+
+}  // namespace Test
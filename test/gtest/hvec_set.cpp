@@ -0,0 +1,75 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc. 
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/hvec_set.h"
+#include "lib/ordered_set.h"
+
+namespace Test {
+
+TEST(hvec_set, insert_erase) {
+    hvec_set<int> s = { 3, 1, 2 };
+    EXPECT_EQ(3U, s.size());
+    EXPECT_FALSE(s.insert(1).second);
+    EXPECT_TRUE(s.insert(0).second);
+    std::vector<int> expected = { 3, 1, 2, 0 };
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), expected.begin(), expected.end()));
+    EXPECT_EQ(3, s.front());
+    EXPECT_EQ(0, s.back());
+
+    s.push_back(1);  // moves 1 to the end
+    expected = { 3, 2, 0, 1 };
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), expected.begin(), expected.end()));
+    EXPECT_EQ(1U, s.erase(2));
+    EXPECT_EQ(0U, s.erase(2));
+    EXPECT_EQ(0U, s.count(2));
+    EXPECT_EQ(s.end(), s.find(2));
+    expected = { 3, 0, 1 };
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), expected.begin(), expected.end()));
+}
+
+TEST(hvec_set, set_operators) {
+    hvec_set<int> a = { 1, 2, 3, 4 };
+    ordered_set<int> b = { 3, 4, 5 };
+    EXPECT_TRUE(intersects(a, b));
+    EXPECT_FALSE(contains(a, b));
+    a |= b;
+    EXPECT_TRUE(contains(a, b));
+    EXPECT_EQ(5U, a.size());
+    a -= std::vector<int>{ 1, 5 };
+    hvec_set<int> expected = { 2, 3, 4 };
+    EXPECT_TRUE(a == expected);
+    a &= b;
+    expected = { 3, 4 };
+    EXPECT_TRUE(a == expected);
+}
+
+TEST(hvec_set, matches_ordered_set) {
+    hvec_set<unsigned> hs;
+    ordered_set<unsigned> os;
+    for (unsigned i = 0; i < 10000; ++i) {
+        unsigned v = (i * 7919) % 503;
+        if (i % 3 == 0) {
+            EXPECT_EQ(os.erase(v), hs.erase(v));
+        } else {
+            EXPECT_EQ(os.insert(v).second, hs.insert(v).second); }
+        ASSERT_EQ(os.size(), hs.size()); }
+    EXPECT_TRUE(std::equal(hs.begin(), hs.end(), os.begin(), os.end()));
+}
+
+}  // namespace Test
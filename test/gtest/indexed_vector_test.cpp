@@ -0,0 +1,113 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "ir/visitor.h"
+
+namespace Test {
+
+class IndexedVectorTest : public P4CTest { };
+
+namespace {
+
+cstring name(int i) { return cstring("d" + std::to_string(i)); }
+
+IR::IndexedVector<IR::Declaration_ID> *make(int count) {
+    auto *rv = new IR::IndexedVector<IR::Declaration_ID>();
+    for (int i = 0; i < count; ++i)
+        rv->push_back(new IR::Declaration_ID(name(i)));
+    return rv;
+}
+
+std::vector<cstring> names(const IR::IndexedVector<IR::Declaration_ID> *vec) {
+    std::vector<cstring> rv;
+    for (auto *decl : *vec->getDeclarations())
+        rv.push_back(decl->getName());
+    return rv;
+}
+
+}  // namespace
+
+TEST_F(IndexedVectorTest, Lookup) {
+    auto *vec = make(1000);
+    for (int i = 0; i < 1000; ++i) {
+        auto *decl = vec->getDeclaration<IR::Declaration_ID>(name(i));
+        ASSERT_NE(nullptr, decl);
+        EXPECT_EQ(vec->at(i), decl); }
+    EXPECT_EQ(nullptr, vec->getDeclaration("d1000"));
+    EXPECT_TRUE(vec->removeByName("d500"));
+    EXPECT_FALSE(vec->removeByName("d500"));
+    EXPECT_EQ(nullptr, vec->getDeclaration("d500"));
+    EXPECT_NE(nullptr, vec->getDeclaration("d501"));
+    vec->validate();
+}
+
+TEST_F(IndexedVectorTest, CopiesAreIndependent) {
+    auto *vec = make(100);
+    auto *copy = vec->clone();
+    copy->removeByName("d10");
+    copy->push_back(new IR::Declaration_ID("extra"));
+    auto *renamed = new IR::Declaration_ID("renamed");
+    copy->replace(copy->begin(), renamed);
+
+    EXPECT_NE(nullptr, vec->getDeclaration("d10"));
+    EXPECT_NE(nullptr, vec->getDeclaration("d0"));
+    EXPECT_EQ(nullptr, vec->getDeclaration("extra"));
+    EXPECT_EQ(nullptr, vec->getDeclaration("renamed"));
+    EXPECT_EQ(nullptr, copy->getDeclaration("d10"));
+    EXPECT_EQ(nullptr, copy->getDeclaration("d0"));
+    EXPECT_NE(nullptr, copy->getDeclaration("extra"));
+    EXPECT_EQ(renamed, copy->getDeclaration("renamed"));
+    vec->validate();
+    copy->validate();
+}
+
+TEST_F(IndexedVectorTest, TransformClone) {
+    struct Rename : public Transform {
+        const IR::Node *postorder(IR::Declaration_ID *d) override {
+            if (d->name == "d7") d->name = IR::ID("seven");
+            return d; }
+    };
+    auto *vec = make(50);
+    auto *result = vec->apply(Rename())->to<IR::IndexedVector<IR::Declaration_ID>>();
+    ASSERT_NE(nullptr, result);
+    EXPECT_NE(vec, result);
+    EXPECT_NE(nullptr, result->getDeclaration("seven"));
+    EXPECT_EQ(nullptr, result->getDeclaration("d7"));
+    EXPECT_NE(nullptr, vec->getDeclaration("d7"));
+    result->validate();
+}
+
+TEST_F(IndexedVectorTest, DeclarationOrder) {
+    auto *vec = make(3);
+    vec->insert(vec->begin(), new IR::Declaration_ID("first"));
+    std::vector<cstring> expected = { "first", "d0", "d1", "d2" };
+    EXPECT_EQ(expected, names(vec));
+
+    // duplicates are reported, and skipped
+    EXPECT_EQ(0U, ::errorCount());
+    vec->push_back(new IR::Declaration_ID("d1"));
+    EXPECT_EQ(1U, ::errorCount());
+    EXPECT_EQ(5U, vec->size());
+    EXPECT_EQ(expected, names(vec));
+    EXPECT_EQ(vec->at(2), vec->getDeclaration("d1"));
+}
+
+}  // namespace Test
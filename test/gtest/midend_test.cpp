@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <map>
+#include <set>
+
 #include "gtest/gtest.h"
 #include "ir/ir.h"
 #include "helpers.h"
@@ -25,6 +28,8 @@ limitations under the License.
 #include "frontends/p4/typeChecking/typeChecker.h"
 #include "frontends/p4/typeMap.h"
 #include "midend/convertEnums.h"
+#include "midend/eliminateCommonSubexpressions.h"
+#include "midend/predication.h"
 #include "midend/replaceSelectRange.h"
 
 using namespace P4;
@@ -112,6 +117,162 @@ TEST_F(P4CMidend, getEnumMapping) {
     ASSERT_EQ(enumMap.size(), (unsigned long)1);
 }
 
+namespace {
+
+/// Runs EliminateCommonSubexpressions over @program; @returns the statements
+/// of the apply block of its control.
+const IR::IndexedVector<IR::StatOrDecl> *eliminateCommonSubexpressions(std::string program) {
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    if (pgm == nullptr || ::errorCount() != 0) return nullptr;
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(EliminateCommonSubexpressions(&refMap, &typeMap));
+    if (pgm == nullptr || ::errorCount() != 0) return nullptr;
+    for (auto *obj : pgm->objects)
+        if (auto *control = obj->to<IR::P4Control>())
+            return &control->body->components;
+    return nullptr;
+}
+
+}  // namespace
+
+TEST_F(P4CMidend, eliminateCommonSubexpressions) {
+    auto components = eliminateCommonSubexpressions(P4_SOURCE(R"(
+        control c(inout bit<8> a, in bit<8> b, out bit<8> x, out bit<8> y, out bit<8> z) {
+            apply {
+                x = (a & 8w0xf) + b;
+                y = (a & 8w0xf) + b;
+                a = 8w1;
+                z = (a & 8w0xf) + b;
+            }
+        }
+    )"));
+    ASSERT_TRUE(components != nullptr);
+    // the third computation reads another value of a
+    ASSERT_EQ(components->size(), 5u);
+    auto *temp = components->at(0)->to<IR::Declaration_Variable>();
+    ASSERT_TRUE(temp != nullptr && temp->initializer != nullptr);
+    EXPECT_TRUE(temp->initializer->is<IR::Add>());
+    for (size_t i : { 1, 2 }) {
+        auto *right = components->at(i)->to<IR::AssignmentStatement>()->right;
+        ASSERT_TRUE(right->is<IR::PathExpression>());
+        EXPECT_EQ(right->to<IR::PathExpression>()->path->name, temp->name); }
+    EXPECT_TRUE(components->at(4)->to<IR::AssignmentStatement>()->right->is<IR::Add>());
+}
+
+TEST_F(P4CMidend, eliminateCommonSubexpressionsKeepsCheapOrChanged) {
+    auto components = eliminateCommonSubexpressions(P4_SOURCE(R"(
+        control c(inout bit<8> a, in bit<8> b, out bit<8> x, out bit<8> y) {
+            action f() { a = b; }
+            apply {
+                x = a + b;
+                y = a + b;
+                x = (a & 8w0xf) + b;
+                f();
+                y = (a & 8w0xf) + b;
+            }
+        }
+    )"));
+    ASSERT_TRUE(components != nullptr);
+    // a + b is not worth a temporary; f may change a
+    EXPECT_EQ(components->size(), 5u);
+    for (auto *s : *components)
+        EXPECT_FALSE(s->is<IR::Declaration_Variable>());
+}
+
+namespace {
+
+class BranchCost : public PredicationCostModel {
+    unsigned cost;
+
+ public:
+    explicit BranchCost(unsigned cost) : cost(cost) {}
+    unsigned branch() const override { return cost; }
+};
+
+/// Runs Predication with a branch costing @branchCost over @program; fills
+/// @decisions, and @withIf with the names of the actions still holding ifs.
+void predicate(std::string program, unsigned branchCost,
+               std::map<cstring, Predication::Decision> &decisions,
+               std::set<cstring> &withIf) {
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    BranchCost    cost(branchCost);
+    Predication   predication(&refMap, &cost);
+    pgm = pgm->apply(TypeChecking(&refMap, &typeMap, true));
+    ASSERT_TRUE(pgm != nullptr);
+    pgm = pgm->apply(predication);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    decisions = predication.getDecisions();
+    forAllMatching<IR::P4Action>(pgm, [&](const IR::P4Action *action) {
+        forAllMatching<IR::IfStatement>(action->body, [&](const IR::IfStatement *) {
+            withIf.insert(action->name.name); }); });
+}
+
+const std::string predicationProgram = P4_SOURCE(R"(
+    extern void f();
+    control c(inout bit<8> x, inout bit<8> y) {
+        action small(bit<8> v) { if (v == 8w1) { x = 8w1; } else { y = 8w2; } }
+        action call(bit<8> v) { if (v == 8w1) { f(); } }
+        action plain() { x = 8w3; }
+        apply {}
+    }
+)");
+
+}  // namespace
+
+TEST_F(P4CMidend, predicationWhenCheaper) {
+    std::map<cstring, Predication::Decision> decisions;
+    std::set<cstring> withIf;
+    predicate(predicationProgram, 10, decisions, withIf);
+    // actions without ifs are not reported
+    ASSERT_EQ(decisions.size(), 2u);
+    auto &small = decisions.at("c.small");
+    EXPECT_TRUE(small.possible);
+    EXPECT_TRUE(small.predicated);
+    EXPECT_DOUBLE_EQ(small.branchCost, 12);  // 1 + 10 + (1 + 1) / 2
+    EXPECT_DOUBLE_EQ(small.predicatedCost, 6);  // 1 + 1 + 2 * (1 + 1)
+    // a call cannot be predicated, but the target supports conditionals
+    EXPECT_FALSE(decisions.at("c.call").possible);
+    EXPECT_FALSE(decisions.at("c.call").predicated);
+    EXPECT_EQ(withIf, std::set<cstring>{ "call" });
+}
+
+TEST_F(P4CMidend, predicationKeepsCheapBranches) {
+    std::map<cstring, Predication::Decision> decisions;
+    std::set<cstring> withIf;
+    predicate(predicationProgram, 1, decisions, withIf);
+    auto &small = decisions.at("c.small");
+    EXPECT_TRUE(small.possible);
+    EXPECT_FALSE(small.predicated);
+    EXPECT_DOUBLE_EQ(small.branchCost, 3);
+    EXPECT_EQ(withIf, (std::set<cstring>{ "call", "small" }));
+}
+
+TEST_F(P4CMidend, predicationDecisionsOfLastProgram) {
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    BranchCost    cost(10);
+    Predication   predication(&refMap, &cost);
+    for (auto source : { predicationProgram, std::string(P4_SOURCE(R"(
+            control d(inout bit<8> x) {
+                action plain() { x = 8w3; }
+                apply {}
+            }
+        )")) }) {
+        auto pgm = P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+        ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+        pgm = pgm->apply(TypeChecking(&refMap, &typeMap, true));
+        ASSERT_TRUE(pgm != nullptr);
+        pgm = pgm->apply(predication);
+        ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    }
+    // the decisions for the actions of the first program are gone
+    EXPECT_TRUE(predication.getDecisions().empty());
+}
+
 class CollectRangesAndMasks : public Inspector {
  public:
     std::vector<const IR::Range *> ranges;
@@ -0,0 +1,174 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "helpers.h"
+
+#include "frontends/common/parser_options.h"
+#include "frontends/parsers/parserDriver.h"
+
+using namespace P4;
+
+namespace Test {
+
+class ParserIncludeCache : public P4CTest { };
+
+namespace {
+
+/// Preprocessed text of a program including a system file.
+std::string preprocessed(std::string file, std::string body) {
+    std::string arch = std::string(p4includePath) + "/cache_test_arch.p4";
+    std::string text;
+    text += "# 1 \"" + file + "\"\n";
+    text += "// a program using the test architecture\n";
+    text += "# 1 \"" + arch + "\" 1\n";
+    text += "error { NoError }\n";
+    text += "extern packet_in {\n";
+    text += "    void extract<T>(out T hdr);\n";
+    text += "    T lookahead<T>();\n";
+    text += "}\n";
+    text += "header H { bit<8> f; }\n";
+    text += "parser P<T>(packet_in b, out T hdr);\n";
+    text += "package Top<T>(P<T> p);\n";
+    text += "# 3 \"" + file + "\" 2\n";
+    text += body;
+    return text;
+}
+
+/// Preprocessed text of a program including two system files, the second
+/// of which includes the first again and uses its types.
+std::string preprocessedTwoIncludes(std::string file, std::string body) {
+    std::string core = std::string(p4includePath) + "/cache_test_core.p4";
+    std::string model = std::string(p4includePath) + "/cache_test_model.p4";
+    std::string text;
+    text += "# 1 \"" + file + "\"\n";
+    text += "# 1 \"" + core + "\" 1\n";
+    text += "extern packet_in {\n";
+    text += "    void extract<T>(out T hdr);\n";
+    text += "}\n";
+    text += "# 2 \"" + file + "\" 2\n";
+    text += "# 1 \"" + model + "\" 1\n";
+    text += "# 1 \"" + core + "\" 1\n";
+    text += "# 2 \"" + model + "\" 2\n";
+    text += "parser Parser<H>(packet_in b, out H hdr);\n";
+    text += "package Switch<H>(Parser<H> p);\n";
+    text += "# 3 \"" + file + "\" 2\n";
+    text += body;
+    return text;
+}
+
+const IR::P4Program* parse(const std::string& text, cstring file, bool cache) {
+    std::istringstream in(text);
+    return cache ? P4ParserDriver::parseWithIncludeCache(in, file)
+                 : P4ParserDriver::parse(in, file);
+}
+
+const IR::Node* decl(const IR::P4Program* program, cstring name) {
+    return program->getDeclsByName(name)->single()->getNode();
+}
+
+}  // namespace
+
+TEST_F(ParserIncludeCache, SameAsPlainParse) {
+    auto text = preprocessed("a.p4", R"(
+error { Mine }
+parser p(packet_in b, out H h) {
+    state start {
+        b.extract(h);
+        transition select(b.lookahead<bit<8>>()) {
+            0: reject;
+            default: accept;
+        }
+    }
+}
+Top(p()) main;
+)");
+    auto plain = parse(text, "a.p4", false);
+    auto cached = parse(text, "a.p4", true);
+    ASSERT_TRUE(plain != nullptr && cached != nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+    EXPECT_TRUE(plain->equiv(*cached));
+
+    auto error = decl(cached, "error")->to<IR::Type_Error>();
+    ASSERT_TRUE(error != nullptr);
+    EXPECT_EQ(error->members.size(), 2u);
+
+    // Positions after the include are the same as without the cache.
+    auto plainParser = decl(plain, "p");
+    auto cachedParser = decl(cached, "p");
+    EXPECT_EQ(cachedParser->srcInfo.getSourceFile(), plainParser->srcInfo.getSourceFile());
+    EXPECT_EQ(cachedParser->srcInfo.toPosition().sourceLine,
+              plainParser->srcInfo.toPosition().sourceLine);
+    EXPECT_EQ(decl(cached, "H")->srcInfo.getSourceFile(),
+              cstring(p4includePath) + "/cache_test_arch.p4");
+}
+
+TEST_F(ParserIncludeCache, SharedBetweenPrograms) {
+    auto a = parse(preprocessed("a.p4", "error { Mine }\n"), "a.p4", true);
+    auto b = parse(preprocessed("b.p4", "header G { H h; }\n"), "b.p4", true);
+    ASSERT_TRUE(a != nullptr && b != nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+
+    // The declarations of the include are parsed once...
+    EXPECT_EQ(decl(a, "packet_in"), decl(b, "packet_in"));
+    EXPECT_EQ(decl(a, "Top"), decl(b, "Top"));
+    // ...but each program gets its own error declaration.
+    EXPECT_NE(decl(a, "error"), decl(b, "error"));
+    EXPECT_EQ(decl(a, "error")->to<IR::Type_Error>()->members.size(), 2u);
+    EXPECT_EQ(decl(b, "error")->to<IR::Type_Error>()->members.size(), 1u);
+}
+
+TEST_F(ParserIncludeCache, LaterIncludeUsesEarlierTypes) {
+    const char* body = R"(
+header H { bit<8> f; }
+parser p(packet_in b, out H h) { state start { b.extract(h); transition accept; } }
+Switch(p()) main;
+)";
+    auto text = preprocessedTwoIncludes("a.p4", body);
+    auto plain = parse(text, "a.p4", false);
+    auto cached = parse(text, "a.p4", true);
+    ASSERT_TRUE(plain != nullptr && cached != nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+    EXPECT_TRUE(plain->equiv(*cached));
+
+    auto other = parse(preprocessedTwoIncludes("b.p4", body), "b.p4", true);
+    ASSERT_TRUE(other != nullptr);
+    EXPECT_EQ(decl(cached, "Parser"), decl(other, "Parser"));
+}
+
+TEST_F(ParserIncludeCache, KeyedOnEarlierDeclarations) {
+    // The program declares a type the include uses before including it.
+    std::string arch = std::string(p4includePath) + "/cache_test_uses.p4";
+    auto program = [&](std::string file, std::string before) {
+        std::string text = "# 1 \"" + file + "\"\n" + before;
+        text += "# 1 \"" + arch + "\" 1\n";
+        text += "extern E { E(T t); }\n";
+        text += "# 2 \"" + file + "\" 2\n";
+        return text; };
+    auto typed = parse(program("a.p4", "typedef bit<8> T;\n"), "a.p4", true);
+    ASSERT_TRUE(typed != nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+    // With a constant of that name instead the include does not parse, rather
+    // than getting the declarations parsed after the typedef.
+    EXPECT_EQ(parse(program("b.p4", "const bit<8> T = 1;\n"), "b.p4", true), nullptr);
+    EXPECT_GT(::errorCount(), 0u);
+}
+
+}  // namespace Test
@@ -0,0 +1,148 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "helpers.h"
+
+#include "frontends/parsers/parserDriver.h"
+#include "lib/parallel.h"
+
+using namespace P4;
+
+namespace Test {
+
+class ParserIncludeUnits : public P4CTest {
+ protected:
+    void SetUp() override { Util::setParallelism(4); }
+    void TearDown() override { Util::setParallelism(1); }
+};
+
+namespace {
+
+/// Preprocessed text of @file, including @includes, as (name, text) pairs,
+/// between the lines of @body separated by '@'.
+std::string preprocessed(std::string file,
+                         std::vector<std::pair<std::string, std::string>> includes,
+                         std::string body) {
+    std::string text = "# 1 \"" + file + "\"\n";
+    unsigned line = 1;
+    std::istringstream lines(body);
+    std::string l;
+    auto include = includes.begin();
+    while (std::getline(lines, l)) {
+        if (l == "@" && include != includes.end()) {
+            text += "# 1 \"" + include->first + "\" 1\n";
+            text += include->second;
+            text += "# " + std::to_string(line + 1) + " \"" + file + "\" 2\n";
+            ++include;
+        } else {
+            text += l + "\n";
+        }
+        ++line;
+    }
+    return text;
+}
+
+const IR::P4Program* parse(const std::string& text, cstring file, bool units) {
+    std::istringstream in(text);
+    return units ? P4ParserDriver::parseIncludeUnits(in, file)
+                 : P4ParserDriver::parse(in, file);
+}
+
+const IR::Node* decl(const IR::P4Program* program, cstring name) {
+    return program->getDeclsByName(name)->single()->getNode();
+}
+
+const std::pair<std::string, std::string> arch = { "arch.p4",
+    "error { NoError }\n"
+    "extern packet_in {\n"
+    "    void extract<T>(out T hdr);\n"
+    "}\n"
+    "parser P<T>(packet_in b, out T hdr);\n"
+    "control C<T>(inout T hdr);\n"
+    "package Top<T>(P<T> p, C<T> c1, C<T> c2);\n" };
+
+const std::pair<std::string, std::string> headers = { "headers.p4",
+    "header H { bit<8> f; }\n"
+    "struct S { H h; }\n"
+    "error { Mine }\n" };
+
+}  // namespace
+
+TEST_F(ParserIncludeUnits, SameAsPlainParse) {
+    auto text = preprocessed("a.p4", {
+        arch, headers,
+        { "c1.p4", "control c1(inout S s) {\n  apply { s.h.f = 1; }\n}\n" },
+        { "c2.p4", "typedef bit<8> T;\ncontrol c2(inout S s) {\n"
+                   "  apply { T t = s.h.f; s.h.f = t + 1; }\n}\n" } }, R"(@
+@
+// the controls
+@
+@
+parser p(packet_in b, out S s) {
+    state start { b.extract(s.h); transition accept; }
+}
+Top(p(), c1(), c2()) main;
+)");
+    auto plain = parse(text, "a.p4", false);
+    auto units = parse(text, "a.p4", true);
+    ASSERT_TRUE(plain != nullptr && units != nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+    EXPECT_TRUE(plain->equiv(*units));
+    EXPECT_EQ(decl(units, "error")->to<IR::Type_Error>()->members.size(), 2u);
+
+    // The declarations keep their positions.
+    for (auto name : { "packet_in", "H", "c1", "T", "c2", "p", "main" }) {
+        auto plainDecl = decl(plain, name), unitDecl = decl(units, name);
+        EXPECT_EQ(unitDecl->srcInfo.getSourceFile(), plainDecl->srcInfo.getSourceFile()) << name;
+        EXPECT_EQ(unitDecl->srcInfo.toPosition().sourceLine,
+                  plainDecl->srcInfo.toPosition().sourceLine) << name;
+    }
+    EXPECT_EQ(decl(units, "c2")->srcInfo.getSourceFile(), "c2.p4");
+}
+
+TEST_F(ParserIncludeUnits, IncludeInsideDeclaration) {
+    auto text = preprocessed("b.p4", {
+        arch, { "actions.p4", "action a() {}\naction b() {}\n" } }, R"(@
+control c(inout bit<8> x) {
+@
+    table t { actions = { a; b; } }
+    apply { t.apply(); }
+}
+)");
+    auto plain = parse(text, "b.p4", false);
+    auto units = parse(text, "b.p4", true);
+    ASSERT_TRUE(plain != nullptr && units != nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+    EXPECT_TRUE(plain->equiv(*units));
+}
+
+TEST_F(ParserIncludeUnits, SyntaxErrorsAreReportedOnce) {
+    auto text = preprocessed("c.p4", { arch, { "bad.p4", "header H { bit<8> }\n" } }, "@\n@\n");
+    EXPECT_EQ(parse(text, "c.p4", true), nullptr);
+    auto errors = ::errorCount();
+    EXPECT_GT(errors, 0u);
+    EXPECT_EQ(parse(text, "c.p4", false), nullptr);
+    EXPECT_EQ(::errorCount(), 2 * errors);
+}
+
+}  // namespace Test
@@ -0,0 +1,98 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "ir/pass_manager.h"
+#include "ir/pass_profile.h"
+#include "ir/visitor.h"
+
+namespace Test {
+
+class PassProfileTest : public P4CTest { };
+
+namespace {
+
+struct CountConstants : public Inspector {
+    unsigned count = 0;
+    CountConstants() { setName("CountConstants"); }
+    void postorder(const IR::Constant *) override { ++count; }
+};
+
+/// Folds an addition of two constants, so it changes something only once.
+struct FoldAdd : public Transform {
+    FoldAdd() { setName("FoldAdd"); }
+    const IR::Node *postorder(IR::Add *a) override {
+        auto l = a->left->to<IR::Constant>();
+        auto r = a->right->to<IR::Constant>();
+        if (!l || !r) return a;
+        ++PassProfile::counter("folded");
+        return new IR::Constant(l->value + r->value);
+    }
+};
+
+}  // namespace
+
+TEST_F(PassProfileTest, RecordsPasses) {
+    PassProfile::enable(nullptr);
+    PassProfile::reset();
+
+    const IR::Expression *e = new IR::Add(new IR::Constant(1),
+                                          new IR::Add(new IR::Constant(2), new IR::Constant(3)));
+    CountConstants count;
+    PassManager passes({ &count, new PassRepeated({ new FoldAdd }) });
+    passes.setName("Passes");
+    e = e->apply(passes);
+
+    ASSERT_TRUE(e->is<IR::Constant>());
+    EXPECT_EQ(6, e->to<IR::Constant>()->asInt());
+
+    auto &records = PassProfile::records();
+    ASSERT_EQ(1U, records.count("Passes/CountConstants"));
+    auto &inspect = records.at("Passes/CountConstants");
+    EXPECT_EQ(1U, inspect.invocations);
+    EXPECT_LE(5U, inspect.nodes_visited);  // and their types
+    EXPECT_EQ(0U, inspect.nodes_changed);
+    EXPECT_EQ(0U, inspect.nodes_created);
+
+    // all iterations of the PassRepeated are aggregated in a single record
+    ASSERT_EQ(1U, records.count("Passes/PassRepeated/FoldAdd"));
+    auto &fold = records.at("Passes/PassRepeated/FoldAdd");
+    EXPECT_EQ(2U, fold.invocations);  // the second run changes nothing
+    EXPECT_LT(0U, fold.nodes_changed);
+    EXPECT_LT(0U, fold.nodes_created);
+    ASSERT_EQ(1U, fold.counters.count("folded"));
+    EXPECT_EQ(2U, fold.counters.at("folded"));
+    ASSERT_EQ(1U, records.count("Passes/PassRepeated"));
+    EXPECT_EQ(1U, records.at("Passes/PassRepeated").invocations);
+    ASSERT_EQ(1U, records.count("Passes"));
+    EXPECT_EQ(1U, records.at("Passes").invocations);
+
+    std::stringstream json;
+    PassProfile::write(json);
+    EXPECT_NE(std::string::npos, json.str().find("\"Passes/PassRepeated/FoldAdd\""));
+    EXPECT_NE(std::string::npos, json.str().find("\"gc_collections\""));
+
+    std::stringstream gc;
+    PassProfile::writeGCStats(gc);
+    EXPECT_EQ(0U, gc.str().find("GC: "));
+    PassProfile::reset();
+}
+
+}  // namespace Test
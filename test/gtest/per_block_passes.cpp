@@ -0,0 +1,102 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "helpers.h"
+
+#include "frontends/common/parseInput.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+#include "midend/perBlockPasses.h"
+
+using namespace P4;
+
+namespace Test {
+
+namespace {
+
+/// Adds a local variable with a generated name to each control.
+class AddTemp : public Transform {
+    ReferenceMap *refMap;
+
+ public:
+    explicit AddTemp(ReferenceMap *refMap) : refMap(refMap) {}
+    const IR::Node *postorder(IR::P4Control *control) override {
+        control->controlLocals.push_back(
+            new IR::Declaration_Variable(refMap->newName("tmp"), IR::Type_Bits::get(8)));
+        return control; }
+};
+
+PerBlockPasses::PassList addTemp() {
+    return [](ReferenceMap *refMap, TypeMap *) {
+        return std::vector<Visitor *>{ new AddTemp(refMap) }; };
+}
+
+}  // namespace
+
+class PerBlockPassesTest : public P4CTest { };
+
+TEST_F(PerBlockPassesTest, UnitsGetUniqueNames) {
+    std::string source = P4_SOURCE(R"(
+        const bit<8> K = 8w1;
+        control c1() { apply {} }
+        control c2() { apply {} }
+    )");
+    auto program = P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    PerBlockPasses split(&refMap, &typeMap, addTemp());
+    auto *result = split.apply_split(program);
+    ASSERT_TRUE(result != nullptr && ::errorCount() == 0);
+    ASSERT_EQ(result->objects.size(), 3u);
+    EXPECT_EQ(result->objects.at(0), program->objects.at(0));
+    std::vector<cstring> locals;
+    for (auto *obj : result->objects) {
+        if (auto *control = obj->to<IR::P4Control>()) {
+            ASSERT_EQ(control->controlLocals.size(), 1u);
+            locals.push_back(control->controlLocals.at(0)->getName().name); } }
+    EXPECT_EQ(locals, (std::vector<cstring>{ "tmp", "tmp_0" }));
+
+    // the same as running the passes over the whole program
+    ReferenceMap serialRefMap;
+    TypeMap serialTypeMap;
+    auto *serial = program->apply(TypeChecking(&serialRefMap, &serialTypeMap));
+    serial = serial->apply(AddTemp(&serialRefMap));
+    ASSERT_TRUE(serial != nullptr);
+    EXPECT_TRUE(result->equiv(*serial));
+}
+
+TEST_F(PerBlockPassesTest, DependentBlocksAreNotSplit) {
+    std::string source = P4_SOURCE(R"(
+        control c1() { apply {} }
+        control c2() { c1() inst; apply { inst.apply(); } }
+    )");
+    auto program = P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    PerBlockPasses split(&refMap, &typeMap, addTemp());
+    EXPECT_EQ(split.apply_split(program), nullptr);
+}
+
+}  // namespace Test
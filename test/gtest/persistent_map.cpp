@@ -0,0 +1,117 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/persistent_map.h"
+
+namespace Test {
+
+namespace {
+
+std::vector<unsigned> keys(const persistent_map<unsigned, unsigned> &m) {
+    std::vector<unsigned> rv;
+    for (auto &kv : m)
+        rv.push_back(kv.first);
+    return rv;
+}
+
+}  // namespace
+
+TEST(persistent_map, set_erase_find) {
+    persistent_map<unsigned, unsigned> m;
+    EXPECT_TRUE(m.empty());
+    for (unsigned i = 0; i < 100; ++i)
+        m.set((i * 37) % 100, i);
+    EXPECT_EQ(m.size(), 100u);
+    auto k = keys(m);
+    for (unsigned i = 0; i < 100; ++i)
+        EXPECT_EQ(k[i], i);
+
+    m.set(5, 500);
+    EXPECT_EQ(m.size(), 100u);
+    EXPECT_EQ(get(m, 5), 500u);
+    EXPECT_EQ(m.erase(5), 1u);
+    EXPECT_EQ(m.erase(5), 0u);
+    EXPECT_EQ(m.size(), 99u);
+    EXPECT_EQ(getref(m, 5), nullptr);
+    EXPECT_TRUE(m.find(5) == m.end());
+    EXPECT_EQ(m.lower_bound(5)->first, 6u);
+    EXPECT_EQ(m.upper_bound(6)->first, 7u);
+    EXPECT_TRUE(m.upper_bound(99) == m.end());
+}
+
+TEST(persistent_map, copies_are_independent) {
+    persistent_map<unsigned, unsigned> a = { {1, 10}, {2, 20}, {3, 30} };
+    auto b = a;
+    EXPECT_TRUE(a.shares(b));
+    auto it = a.begin();
+    b.set(2, 22);
+    b.erase(3);
+    a.set(4, 40);
+    EXPECT_FALSE(a.shares(b));
+    EXPECT_EQ(keys(a), (std::vector<unsigned>{ 1, 2, 3, 4 }));
+    EXPECT_EQ(keys(b), (std::vector<unsigned>{ 1, 2 }));
+    EXPECT_EQ(get(a, 2), 20u);
+    EXPECT_EQ(get(b, 2), 22u);
+    // iterators keep seeing the contents from when they were created
+    ++it;
+    EXPECT_EQ(it->second, 20u);
+    ++it;
+    ++it;
+    EXPECT_TRUE(it == a.end());
+}
+
+TEST(persistent_map, merge_visits_changed_entries) {
+    persistent_map<unsigned, unsigned> a;
+    for (unsigned i = 0; i < 1000; ++i)
+        a.set(i, i);
+    auto b = a;
+    a.set(10, 0);
+    b.set(20, 0);
+    b.erase(30);
+    b.set(2000, 0);
+
+    std::vector<unsigned> visited;
+    a.merge_from(b, [&](unsigned key, unsigned &value, const unsigned *other) {
+        visited.push_back(key);
+        if (other && *other == value) return false;
+        value = 1;
+        return true; });
+    // only the entries on the paths to the changes are visited; 2000 is
+    // only in b, so it is not merged into a
+    std::sort(visited.begin(), visited.end());
+    EXPECT_LT(visited.size(), 100u);
+    for (auto key : { 10u, 20u, 30u })
+        EXPECT_TRUE(std::binary_search(visited.begin(), visited.end(), key));
+    EXPECT_FALSE(std::binary_search(visited.begin(), visited.end(), 2000u));
+    EXPECT_EQ(a.size(), 1000u);
+    EXPECT_EQ(get(a, 10), 1u);
+    EXPECT_EQ(get(a, 20), 1u);
+    EXPECT_EQ(get(a, 30), 1u);
+    EXPECT_EQ(get(a, 40), 40u);
+
+    // merging a copy does not visit anything
+    auto c = a;
+    a.merge_from(c, [&](unsigned, unsigned &, const unsigned *) {
+        ADD_FAILURE();
+        return false; });
+    EXPECT_TRUE(a.shares(c));
+}
+
+}  // namespace Test
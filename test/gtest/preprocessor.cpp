@@ -0,0 +1,145 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "helpers.h"
+
+#include "frontends/common/preprocessor.h"
+#include "frontends/parsers/parserDriver.h"
+
+using namespace P4;
+
+namespace Test {
+
+class Preprocessor : public P4CTest { };
+
+namespace {
+
+std::string output(P4::Preprocessor& pp) {
+    std::string result, line;
+    while (pp.getLine(line))
+        result += line;
+    return result;
+}
+
+std::string preprocess(const std::string& text, cstring options = "") {
+    P4::Preprocessor pp;
+    pp.addOptions(options);
+    pp.openText("a.p4", text);
+    return output(pp);
+}
+
+/// A temporary directory, removed with the files added to it.
+class TempDir {
+    std::string dir;
+    std::vector<std::string> files;
+
+ public:
+    TempDir() {
+        char name[] = "/tmp/p4c-preprocessor-XXXXXX";
+        dir = mkdtemp(name);
+    }
+    void add(const std::string& file, const std::string& contents) {
+        files.push_back(dir + "/" + file);
+        std::ofstream(files.back()) << contents;
+    }
+    ~TempDir() {
+        for (auto& f : files) unlink(f.c_str());
+        rmdir(dir.c_str());
+    }
+    const std::string& path() const { return dir; }
+};
+
+}  // namespace
+
+TEST_F(Preprocessor, Macros) {
+    EXPECT_EQ(preprocess(R"(#define W 8
+#define ADD(a, b) ((a) + (b))
+#define STR(x) #x
+#define CAT(a, b) a ## b
+#define CALL(...) f(__VA_ARGS__)
+const bit<W> x = ADD(1,
+                     2);  // keeps comments
+const bit<8> CAT(y, z) = STR(a "b");
+CALL(1, 2) CALL() __LINE__ -W x-W Z
+)", "-DZ=3"),
+R"(# 1 "a.p4"
+)" "\n\n\n\n\n"
+R"(const bit<8> x = ((1) + (2));  // keeps comments
+
+const bit<8> yz = "a \"b\"";
+f(1, 2) f() 9 -8 x-8 3
+)");
+}
+
+TEST_F(Preprocessor, Conditionals) {
+    EXPECT_EQ(preprocess(R"(#if defined(A) && A > 2
+a
+#elif B
+b
+#else
+c
+#endif
+#ifndef A
+not a
+#endif
+)", " -DA=3 -D B -UB"), "# 1 \"a.p4\"\n\na\n\n\n\n\n\n\n\n\n");
+    EXPECT_EQ(::errorCount(), 0u);
+
+    preprocess("#if 1\n#error stop\n#endif\n");
+    EXPECT_EQ(::errorCount(), 1u);
+}
+
+TEST_F(Preprocessor, Includes) {
+    TempDir dir;
+    dir.add("arch.p4", "#pragma once\nextern E { E(); }\n");
+    dir.add("main.p4", "#include <arch.p4>\n#include \"arch.p4\"\nE() e;\n");
+    P4::Preprocessor pp;
+    pp.addIncludeDir(dir.path());
+    ASSERT_TRUE(pp.open(dir.path() + "/main.p4"));
+    auto arch = dir.path() + "/arch.p4";
+    auto main = dir.path() + "/main.p4";
+    EXPECT_EQ(output(pp), "# 1 \"" + main + "\"\n"
+                          "# 1 \"" + arch + "\" 1\n\nextern E { E(); }\n"
+                          "# 2 \"" + main + "\" 2\n\nE() e;\n");
+}
+
+TEST_F(Preprocessor, StreamsIntoParser) {
+    TempDir dir;
+    dir.add("arch.p4", "extern E {\n    E();\n}\n");
+    P4::Preprocessor pp;
+    pp.addIncludeDir(dir.path());
+    pp.openText("main.p4", "#include <arch.p4>\n#define NAME e\n\nE() NAME;\n");
+    auto program = P4ParserDriver::parse(pp.stream(), "main.p4");
+    ASSERT_TRUE(program != nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+
+    auto e = program->getDeclsByName("E")->single()->getNode();
+    EXPECT_EQ(e->srcInfo.getSourceFile(), cstring(dir.path() + "/arch.p4"));
+    auto inst = program->getDeclsByName("e")->single()->getNode();
+    EXPECT_EQ(inst->srcInfo.getSourceFile(), "main.p4");
+    EXPECT_EQ(inst->srcInfo.toPosition().sourceLine, 4u);
+}
+
+}  // namespace Test
@@ -43,4 +43,47 @@ TEST_F(P4C_IR, Transform) {
     EXPECT_EQ(e, n);
 }
 
+TEST_F(P4C_IR, TransformSharedNodes) {
+    struct Bump : public Transform {
+        unsigned visits = 0;
+        const IR::Node *postorder(IR::Constant *c) override {
+            ++visits;
+            return new IR::Constant(c->value + 1); }
+    };
+
+    // enough nodes to make the visitor's state tracker grow a few times
+    auto c = new IR::Constant(2);
+    const IR::Expression *e = c;
+    for (int i = 0; i < 2000; ++i)
+        e = new IR::Add(e, c);
+    Bump bump;
+    auto *n = e->apply(bump);
+    EXPECT_EQ(1U, bump.visits);
+    const IR::Expression *leaf = nullptr;
+    for (auto *add = n->to<IR::Add>(); add; add = add->left->to<IR::Add>()) {
+        if (!leaf) leaf = add->right;
+        EXPECT_EQ(leaf, add->right); }
+    ASSERT_TRUE(leaf && leaf->is<IR::Constant>());
+    EXPECT_EQ(3, leaf->to<IR::Constant>()->asInt());
+}
+
+TEST_F(P4C_IR, TransformRevisitVisited) {
+    struct Count : public Transform {
+        unsigned visits = 0;
+        const IR::Node *postorder(IR::Constant *c) override {
+            ++visits;
+            return c; }
+        const IR::Node *postorder(IR::Add *a) override {
+            // the enclosing Add is still being visited, and is not forgotten
+            revisit_visited();
+            return a; }
+    };
+
+    auto c = new IR::Constant(2);
+    const IR::Expression *e = new IR::Add(new IR::Add(c, c), c);
+    Count count;
+    EXPECT_EQ(e, e->apply(count));
+    EXPECT_EQ(2U, count.visits);
+}
+
 }  // namespace Test
@@ -0,0 +1,104 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "ir/pass_profile.h"
+#include "helpers.h"
+
+#include "frontends/common/parseInput.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/common/resolveReferences/resolveReferences.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+using namespace P4;
+
+namespace Test {
+
+class TypeCheckCalls : public P4CTest { };
+
+TEST_F(TypeCheckCalls, RepeatedCallsReuseSolutions) {
+    std::string source = P4_SOURCE(R"(
+        extern T id<T>(in T x);
+        extern bit<8> g(in bit<8> a);
+        control c(inout bit<8> x, inout bit<16> w) {
+            apply { x = id(x); x = id(x); w = id(w); x = g(8w1); x = g(8w2); }
+        }
+    )");
+    auto program = P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+
+    auto &calls = PassProfile::counter("TypeInference.methodCalls");
+    auto &reused = PassProfile::counter("TypeInference.methodCalls.reused");
+    uint64_t callsBefore = calls, reusedBefore = reused;
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    program = program->apply(TypeChecking(&refMap, &typeMap));
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    EXPECT_EQ(callsBefore + 5, calls);
+    // The second id(x) and g(2) reuse the solutions of id(x) and g(1).
+    EXPECT_EQ(reusedBefore + 2, reused);
+
+    // The reused solutions give the same types as solving each call.
+    std::vector<int> widths;
+    forAllMatching<IR::MethodCallExpression>(program, [&](const IR::MethodCallExpression *call) {
+        auto type = typeMap.getType(call);
+        ASSERT_TRUE(type != nullptr && type->is<IR::Type_Bits>()) << call;
+        widths.push_back(type->width_bits());
+        for (auto arg : *call->arguments)
+            EXPECT_EQ(type, typeMap.getType(arg->expression)) << call;
+    });
+    EXPECT_EQ(widths, (std::vector<int>{ 8, 8, 16, 8, 8 }));
+}
+
+TEST_F(TypeCheckCalls, RepeatedCallsWithLiteralsReuseSolutions) {
+    std::string source = P4_SOURCE(R"(
+        extern T max<T>(in T a, in T b);
+        extern bit<8> g(in bit<8> a);
+        control c(inout bit<8> x) {
+            apply { x = max(x, 1); x = max(x, 2); x = g(1); x = g(2); }
+        }
+    )");
+    auto program = P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+
+    auto &calls = PassProfile::counter("TypeInference.methodCalls");
+    auto &reused = PassProfile::counter("TypeInference.methodCalls.reused");
+    uint64_t callsBefore = calls, reusedBefore = reused;
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    // The literals get the types of the parameters, which changes the program.
+    PassManager inference({ new ResolveReferences(&refMap),
+                            new TypeInference(&refMap, &typeMap, false) });
+    program = program->apply(inference);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    EXPECT_EQ(callsBefore + 4, calls);
+    // The second calls bind their literals to the types solved for the first.
+    EXPECT_EQ(reusedBefore + 2, reused);
+
+    forAllMatching<IR::MethodCallExpression>(program, [&](const IR::MethodCallExpression *call) {
+        auto type = typeMap.getType(call);
+        ASSERT_TRUE(type != nullptr && type->is<IR::Type_Bits>()) << call;
+        EXPECT_EQ(type->width_bits(), 8) << call;
+        for (auto arg : *call->arguments)
+            EXPECT_EQ(type, typeMap.getType(arg->expression)) << call;
+    });
+}
+
+}  // namespace Test
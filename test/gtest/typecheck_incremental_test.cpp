@@ -0,0 +1,101 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "helpers.h"
+
+#include "frontends/common/parseInput.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/common/resolveReferences/resolveReferences.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+using namespace P4;
+
+namespace Test {
+
+class TypeCheckIncremental : public P4CTest { };
+
+namespace {
+
+/// Changes the constants in control c2.
+struct ChangeC2 : public Transform {
+    const IR::Node *postorder(IR::Constant *c) override {
+        auto control = findContext<IR::P4Control>();
+        if (control && control->name == "c2")
+            return new IR::Constant(c->type, 2);
+        return c; }
+};
+
+const IR::P4Control *control(const IR::P4Program *program, cstring name) {
+    return program->getDeclsByName(name)->single()->to<IR::P4Control>();
+}
+
+}  // namespace
+
+TEST_F(TypeCheckIncremental, ChangedSubtreeOnly) {
+    std::string source = P4_SOURCE(R"(
+        control c1(inout bit<8> x) { apply { x = x + 8w1; if (x == 8w3) { x = 8w0; } } }
+        control c2(inout bit<8> y) { apply { y = y + 8w1; if (y == 8w3) { y = 8w0; } } }
+    )");
+    auto program = P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    PassManager inference = {
+        new ResolveReferences(&refMap),
+        new TypeInference(&refMap, &typeMap, false),
+    };
+    program = program->apply(inference);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    auto c1 = control(program, "c1");
+    EXPECT_TRUE(typeMap.isChecked(c1));
+    EXPECT_TRUE(typeMap.isChecked(c1->body));
+
+    auto changed = program->apply(ChangeC2());
+    ASSERT_NE(program, changed);
+    auto c2 = control(changed, "c2");
+    EXPECT_FALSE(typeMap.isChecked(c2->body));
+    // typechecking a changed program must not change it
+    changed = changed->apply(TypeChecking(&refMap, &typeMap));
+    ASSERT_TRUE(changed != nullptr && ::errorCount() == 0);
+    EXPECT_EQ(c1, control(changed, "c1"));
+    EXPECT_TRUE(typeMap.isChecked(c2->body));
+
+    // the types are those found by typechecking from scratch
+    ReferenceMap freshRefMap;
+    TypeMap freshTypeMap;
+    changed->apply(TypeChecking(&freshRefMap, &freshTypeMap));
+    struct CompareTypes : public Inspector {
+        const TypeMap &incremental, &fresh;
+        unsigned count = 0;
+        CompareTypes(const TypeMap &incremental, const TypeMap &fresh)
+        : incremental(incremental), fresh(fresh) {}
+        void postorder(const IR::Expression *e) override {
+            auto type = fresh.getType(e);
+            if (!type) return;
+            ++count;
+            auto other = incremental.getType(e);
+            ASSERT_NE(nullptr, other) << e;
+            EXPECT_TRUE(type->equiv(*other)) << e; }
+    } compare(typeMap, freshTypeMap);
+    changed->apply(compare);
+    EXPECT_GT(compare.count, 0U);
+}
+
+}  // namespace Test
@@ -0,0 +1,64 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "ir/pass_profile.h"
+#include "frontends/p4/typeMap.h"
+
+using namespace P4;
+
+namespace Test {
+
+class TypeMapTest : public P4CTest { };
+
+namespace {
+
+const IR::Type_Tuple *tuple(std::initializer_list<int> widths) {
+    IR::Vector<IR::Type> components;
+    for (auto w : widths)
+        components.push_back(IR::Type_Bits::get(w));
+    return new IR::Type_Tuple(components);
+}
+
+}  // namespace
+
+TEST_F(TypeMapTest, Canonical) {
+    TypeMap typeMap;
+    auto &lookups = PassProfile::counter("TypeMap.getCanonical");
+    uint64_t before = lookups;
+
+    std::vector<const IR::Type *> canonical;
+    for (int i = 1; i <= 100; ++i)
+        canonical.push_back(typeMap.getCanonical(tuple({i, 8})));
+    for (int i = 1; i <= 100; ++i) {
+        EXPECT_EQ(canonical[i-1], typeMap.getCanonical(tuple({i, 8})));
+        EXPECT_NE(canonical[i-1], typeMap.getCanonical(tuple({8, i, 8}))); }
+    EXPECT_EQ(before + 300, lookups);
+
+    auto stack = new IR::Type_Stack(IR::Type_Bits::get(8), new IR::Constant(4));
+    auto canonStack = typeMap.getCanonical(stack);
+    EXPECT_EQ(canonStack, typeMap.getCanonical(
+        new IR::Type_Stack(IR::Type_Bits::get(8), new IR::Constant(4))));
+    EXPECT_NE(canonStack, typeMap.getCanonical(
+        new IR::Type_Stack(IR::Type_Bits::get(8), new IR::Constant(5))));
+    // a list and a tuple with the same components are different
+    auto list = new IR::Type_List(tuple({1, 8})->components);
+    EXPECT_EQ(list, typeMap.getCanonical(list));
+}
+
+}  // namespace Test
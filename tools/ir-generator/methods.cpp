@@ -107,6 +107,37 @@ const ordered_map<cstring, IrMethod::info_t> IrMethod::Generate = {
             buf << ";" << std::endl; }
         buf << cl->indent << "}";
         return buf.str(); } } },
+{ "compute_hash", { &NamedType::Size_t(), {}, CONST + IN_IMPL + OVERRIDE,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        std::stringstream buf;
+        buf << "{" << std::endl;
+        buf << cl->indent << cl->indent << "size_t h = ";
+        if (auto parent = cl->getParent())
+            buf << parent->qualified_name(cl->containedIn) << "::compute_hash();" << std::endl;
+        else
+            buf << "0;" << std::endl;
+        // A hand-written equiv may ignore some fields, so hash only what the
+        // base class does.  Fields are otherwise hashed the way equiv compares them.
+        bool userEquiv = cl->getUserMethods()
+            ->where([] (IrMethod *m) { return m->name == "equiv" && m->srcInfo.isValid(); })
+            ->any();
+        bool needed = false;
+        for (auto f : *cl->getFields()) {
+            if (userEquiv) break;
+            if (*f->type == NamedType::SourceInfo()) continue;  // FIXME -- deal with SourcInfo
+            needed = true;
+            buf << cl->indent << cl->indent << "h = Util::Hash::combine(h, ";
+            if (f->type->resolve(cl->containedIn) == nullptr) {
+                // This is not an IR pointer
+                buf << "hash_field(" << f->name << ")";
+            } else if (f->isInline) {
+                buf << f->name << ".hash()";
+            } else {
+                buf << "(" << f->name << " ? " << f->name << "->hash() : 0)"; }
+            buf << ");" << std::endl; }
+        buf << cl->indent << cl->indent << "return h;" << std::endl;
+        buf << cl->indent << "}";
+        return needed ? buf.str() : cstring(); } } },
 { "operator<<", { &ReferenceType::OstreamRef, { new IrField(&ReferenceType::OstreamRef, "out") },
   EXTEND + IN_IMPL + NOT_DEFAULT + INCL_NESTED + CLASSREF + FRIEND,
     [](IrClass *cl, Util::SourceInfo srcInfo, cstring body) -> cstring {
@@ -65,6 +65,11 @@ NamedType& NamedType::Int() {
     return nt;
 }
 
+NamedType& NamedType::Size_t() {
+    static NamedType nt("size_t");
+    return nt;
+}
+
 NamedType& NamedType::Void() {
     static NamedType nt("void");
     return nt;
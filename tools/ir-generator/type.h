@@ -90,6 +90,7 @@ class NamedType : public Type {
 
     static NamedType& Bool();
     static NamedType& Int();
+    static NamedType& Size_t();
     static NamedType& Void();
     static NamedType& Cstring();
     static NamedType& Ostream();